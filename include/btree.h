@@ -1,63 +1,97 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <memory>
-#include <set>
+#include <string_view>
+#include "./index.h"
 
 using namespace std;
 
-template<typename Key, typename Value>
-class BPlusTree {
+// Disk-resident B+Tree index (see Index). Every node is one page. Leaves are linked left to right through
+// `next_leaf`. Duplicate keys are allowed; entries are ordered by
+// (key, value) so every entry is unique and separators stay exact.
+//
+// Node page layout:
+//   [uint8 is_leaf][uint8 pad][uint16 count][int32 next_leaf | child0]
+//   [uint16 offset[count]] [entries...]
+// Leaf entry:     [uint16 key_len][key][int64 value]
+// Internal entry: [uint16 key_len][key][int64 value][int32 right_child]
+//
+// Meta page, which stays put when the root splits:
+//   [int32 root][int32 pad][uint64 changed_lsn]
+// Pages a merge frees go back to the tree's segment.
+//
+// Concurrency is by latch crabbing from the meta page down. Readers hold
+// shared latches, at most two at a time, and move along the leaf chain
+// left to right. Writers take exclusive latches and release the ancestors
+// of any node a change cannot propagate through; callers serialize writers.
+class BPlusTree : public Index {
 private:
-    static const int ORDER = 4;
+    struct Entry {
+        string key;
+        int64_t value;
+        int child; // right child of a separator; unused in leaves
+    };
 
     struct Node {
-        vector<Key> keys;
         bool is_leaf;
-        Node* parent;
-
-        Node(bool leaf = false): is_leaf(leaf), parent(nullptr){}
-        virtual ~Node() = default;
+        int link; // next_leaf for leaves, child0 for internal nodes
+        vector<Entry> entries;
     };
 
-    struct InternalNode: public Node {
-        vector<Node*> children;
-
-        InternalNode() : Node(false){}
+    struct SplitResult {
+        bool split;
+        Entry separator; // separator.child is the new right node
+    };
 
-        ~InternalNode() {
-            for(auto child : children) {
-                delete child;
-            }
-        }
+    // One exclusively latched node on a writer's path from the root.
+    struct PathNode {
+        PageGuard guard;
+        Node node;
+        size_t pos; // child followed; unused in the leaf
     };
 
-    struct LeafNode: public Node {
-        vector<Value> values;
-        LeafNode* next;
+    static int get_root(const PageGuard& meta);
+    static void set_root(PageGuard& meta, int root_page_id);
 
-        LeafNode() : Node(true), next(nullptr) {}
-    };
+    static Node read_node(const char* page);
+    static void write_node(PageGuard& guard, const Node& node);
+    int allocate_node(const Node& node);
 
-    Node* root;
-    LeafNode* leftmost_leaf;
+    static size_t entry_size(const Node& node, const Entry& entry);
+    static size_t node_size(const Node& node);
+    static int compare(string_view a_key, int64_t a_value, string_view b_key, int64_t b_value);
+    static size_t child_index(const Node& node, const string& key, int64_t value);
+    static size_t split_point(const Node& node);
+    static bool insert_safe(const Node& node);
+    static bool remove_safe(const Node& node, bool is_root);
 
-    LeafNode* find_leaf(const Key& key);
-    void insert_in_leaf(LeafNode* leaf, const Key& key, const Value& value);
-    void insert_in_parent(Node* left, const Key& key, Node* right);
-    Node* split_leaf(LeafNode* leaf);
-    Node* split_internal(InternalNode* Node);
-    void remove_from_leaf(LeafNode* leaf, const Key& key, const Value& value);
-    void merge_or_redistribute(Node* node);
+    void latch_path(const string& key, int64_t value, bool for_insert, PageGuard& meta, vector<PathNode>& path);
+    SplitResult store_or_split(PageGuard& guard, Node& node);
+    vector<Entry> store_or_split_all(PageGuard& guard, Node& node);
+    vector<Entry> insert_sorted(int page_id, const Entry* first, const Entry* last);
+    void rebalance_child(PathNode& parent, PathNode& child);
+
+    PageGuard find_leaf(const string& key, int64_t value);
+    void collect(const string& start_key, const string* end_key, bool exact, vector<int64_t>& out);
 
 public:
-    BPlusTree();
-    ~BPlusTree();
-
-    void insert(const Key& key, const Value& value);
-    void remove(const Key& key, const Value& value);
-    vector<Value> search(const Key& key);
-    vector<Value> range_search(const Key& start_key, const Key& end_key);
-    bool empty() const {return root == nullptr; }   
-};
\ No newline at end of file
+    // Allocates a meta page and an empty root leaf in `segment_id`; returns
+    // the meta page id.
+    static int create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id);
+
+    BPlusTree(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, int meta_page_id);
+
+    IndexType type() const override { return IndexType::BTREE; }
+
+    void insert(const string& key, int64_t value) override;
+    // Inserts many entries in one pass: every node on the way is loaded and
+    // written once, and nodes that overflow are cut into as many packed
+    // pages as needed. Into an empty tree this builds the tree bottom-up.
+    void bulk_insert(const vector<pair<string, int64_t>>& entries) override;
+    bool remove(const string& key, int64_t value) override;
+    vector<int64_t> search(const string& key) override;
+    vector<int64_t> range_search(const string& start_key, const string& end_key) override;
+    vector<int64_t> range_search_from(const string& start_key) override;
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include "./disk_manager.h"
+#include "./log_manager.h"
+#include "./read_ahead.h"
+#include <cstdint>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+const size_t DEFAULT_POOL_SIZE = 256; // Number of frames (1 MB with 4 KB pages)
+
+// A frame in the buffer pool. `data` always holds PAGE_SIZE bytes.
+// `latch` guards the contents: readers hold it shared, a thread changing the
+// page holds it exclusively. It is only ever held by threads that have the
+// page pinned (see PageGuard).
+struct Page {
+    int page_id;
+    int pin_count;
+    bool is_dirty;
+    bool ref_bit; // CLOCK reference bit, set on every access
+    bool loading; // being read from disk outside the pool latch
+    bool load_failed;
+    uint64_t lsn; // newest log record applied since the page was read
+    vector<char> data;
+    shared_mutex latch;
+
+    Page()
+        : page_id(-1), pin_count(0), is_dirty(false), ref_bit(false), loading(false), load_failed(false), lsn(0),
+          data(PAGE_SIZE, 0) {}
+};
+
+// The page table, pins and replacement are guarded by one pool latch. Page
+// reads on a miss happen outside it, so threads missing on different pages
+// wait for the disk in parallel; fetches of a page being read wait for it.
+class BufferPoolManager {
+private:
+    mutex latch;
+    condition_variable load_done;
+    DiskManager& disk;
+    LogManager& log;
+    vector<Page> frames;
+    unordered_map<int, int> page_table; // page_id -> frame index
+    vector<int> free_frames;
+    size_t clock_hand;
+    unique_ptr<ReadAhead> read_ahead; // pread mode only; mmap relies on madvise
+
+    size_t hits;
+    size_t misses;
+
+    int find_victim_frame();
+    bool write_back(Page& frame);
+    void drop_failed_pin(int frame_id);
+
+public:
+    BufferPoolManager(DiskManager& dm, LogManager& lm, size_t pool_size = DEFAULT_POOL_SIZE);
+    ~BufferPoolManager();
+
+    // Pins the page and returns its frame. Throws if the page is not on disk
+    // or every frame is pinned.
+    Page* fetch_page(int page_id);
+    // Extends the file by one zeroed page and returns it pinned.
+    Page* new_page(int& page_id);
+    bool unpin_page(int page_id, bool is_dirty);
+    // Writes fully built pages straight to the end of the file, bypassing
+    // the pool, and returns the first new page id. The pages are not synced
+    // (see sync_pages) and nothing about them is logged.
+    int append_pages(const char* data, int count);
+    void sync_pages();
+    // Tells the OS how the next page misses will be spread over the file.
+    void advise(AccessPattern pattern) { disk.advise(pattern); }
+    // Starts reading a page that will be fetched soon, if it is not resident
+    // (see ReadAhead). Does nothing for pages past the end of the file.
+    void prefetch(int page_id);
+
+    bool flush_page(int page_id);
+    bool flush_all_pages();
+    // Writes every dirty page, syncs the data file and empties the log.
+    // Only valid while no other thread is modifying pages; concurrent
+    // readers are fine.
+    void checkpoint();
+
+    LogManager& get_log_manager() { return log; }
+
+    int get_num_pages();
+    size_t get_pool_size() const { return frames.size(); }
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+};
+
+enum class LatchMode {
+    NONE,       // pinned only; the holder latches the page itself (see latch())
+    SHARED,
+    EXCLUSIVE
+};
+
+// Pins a page for the lifetime of the guard and unpins it on scope exit,
+// so early returns and exceptions never leak pins. The page latch is taken
+// in the given mode after pinning and released before unpinning. A thread
+// must not latch a page it already holds: build guards for a new page only
+// after releasing the old one.
+class PageGuard {
+private:
+    BufferPoolManager* bpm;
+    Page* page;
+    bool dirty;
+    LatchMode mode;
+
+    void lock() {
+        if (mode == LatchMode::SHARED) page->latch.lock_shared();
+        else if (mode == LatchMode::EXCLUSIVE) page->latch.lock();
+    }
+
+public:
+    PageGuard() : bpm(nullptr), page(nullptr), dirty(false), mode(LatchMode::NONE) {}
+    PageGuard(BufferPoolManager& pool, int page_id, LatchMode latch_mode = LatchMode::EXCLUSIVE)
+        : bpm(&pool), page(pool.fetch_page(page_id)), dirty(false), mode(latch_mode) {
+        lock();
+    }
+    PageGuard(BufferPoolManager& pool, Page* pinned, LatchMode latch_mode = LatchMode::EXCLUSIVE)
+        : bpm(&pool), page(pinned), dirty(false), mode(latch_mode) {
+        lock();
+    }
+    ~PageGuard() { release(); }
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard& operator=(const PageGuard&) = delete;
+
+    PageGuard(PageGuard&& other) noexcept : bpm(other.bpm), page(other.page), dirty(other.dirty), mode(other.mode) {
+        other.page = nullptr;
+    }
+
+    PageGuard& operator=(PageGuard&& other) noexcept {
+        if (this != &other) {
+            release();
+            bpm = other.bpm;
+            page = other.page;
+            dirty = other.dirty;
+            mode = other.mode;
+            other.page = nullptr;
+        }
+        return *this;
+    }
+
+    void release() {
+        if (page) {
+            if (mode == LatchMode::SHARED) page->latch.unlock_shared();
+            else if (mode == LatchMode::EXCLUSIVE) page->latch.unlock();
+            bpm->unpin_page(page->page_id, dirty);
+            page = nullptr;
+            dirty = false;
+        }
+    }
+
+    bool valid() const { return page != nullptr; }
+    int page_id() const { return page->page_id; }
+    char* data() { return page->data.data(); }
+    const char* data() const { return page->data.data(); }
+    shared_mutex& latch() { return page->latch; }
+    void mark_dirty() { dirty = true; }
+    // Records that the page now reflects log record `lsn`; the page will not
+    // be written to disk before the log is durable up to there.
+    void set_lsn(uint64_t lsn) {
+        if (lsn > page->lsn) page->lsn = lsn;
+        dirty = true;
+    }
+    // Logs bytes [offset, offset + len) of the page as they are now. Used
+    // for pages without a record layout (header, free-space map). Returns
+    // the record's LSN.
+    uint64_t log_write(size_t offset, size_t len);
+};
@@ -1,34 +1,86 @@
 #pragma once
 
+#include <map>
+#include <shared_mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include "./record_manager.h"
 #include "./index_manager.h"
+#include "./column_store.h"
+#include "./types.h"
+#include "./row_layout.h"
 
+// How a table's rows are stored: as heap records (see RecordManager) or
+// column by column (see ColumnTable).
+enum class TableStorage { ROW, COLUMN };
+
+// Catalog entry for a table: SCHEMA|name|segment|col1:TYPE,col2:TYPE,...
+// Column tables append |COLUMN:<meta page>.
 struct TableSchema {
     std::string table_name;
-    std::vector<std::string> columns;
+    int segment_id = -1; // segment holding the table's pages
+    std::vector<Column> columns;
+    TableStorage storage = TableStorage::ROW;
+    int column_meta_page = -1; // COLUMN storage: the ColumnTable's meta page
+
+    int column_index(const std::string& column_name) const; // -1 if absent
+    RowLayout layout() const { return RowLayout(columns); }
 
     std::string serialize() const;
     static TableSchema deserialize(const std::string& record_str);
 };
 
+// Catalog entry for an index declared with CREATE INDEX:
+//   INDEX|table|column|meta_page|segment|name|unique|type
+// Entries written before hash indexes existed have no type and are B+Trees.
+struct IndexInfo {
+    std::string table_name;
+    std::string column_name;
+    int meta_page_id = -1;
+    int segment_id = 0;
+    std::string index_name;
+    bool unique = false;
+    IndexType type = IndexType::BTREE;
+
+    std::string serialize() const;
+    static IndexInfo deserialize(const std::string& record_str);
+};
+
 class CatalogManager {
 private:
     RecordManager& record_manager;
     IndexManager& index_manager;
+    ColumnStore& column_store;
+    // Readers look schemas up while the writer creates and drops tables.
+    std::shared_mutex cache_latch;
     std::unordered_map<std::string, TableSchema> schema_cache;
+    std::map<std::string, IndexInfo> index_cache; // by index name
 
     void load_catalog();
+    bool add_index(IndexInfo info, const std::vector<std::pair<std::string, int64_t>>& entries);
 
 public:
-    CatalogManager(RecordManager& rm, IndexManager& im);
+    CatalogManager(RecordManager& rm, IndexManager& im, ColumnStore& cs);
 
-    bool create_table(const std::string& table_name, const std::vector<std::string>& columns);
+    bool create_table(const std::string& table_name, const std::vector<Column>& columns,
+                      TableStorage storage = TableStorage::ROW);
     bool drop_table(const std::string& table_name);
+    // Builds the index described by `info` (name, table, column, unique,
+    // type) from `entries` and records it. The index is only published once it is
+    // complete, so readers never plan with a half-built index. Fails if
+    // the name is taken or the column already has an index.
+    bool create_index(const IndexInfo& info, const std::vector<std::pair<std::string, int64_t>>& entries);
+    bool drop_index(const std::string& index_name);
+    bool has_index(const std::string& index_name);
+    // Replaces an index with a new, empty one (see TableManager::rebuild_indexes).
+    void recreate_index(const std::string& table_name, const std::string& column_name);
+    // The indexes declared on a table, ordered by name.
+    std::vector<IndexInfo> get_indexes(const std::string& table_name);
 
     TableSchema get_schema(const std::string& table_name);
+    bool has_table(const std::string& table_name);
     std::vector<std::string> list_tables();
 
     // New helper
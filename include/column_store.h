@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "./buffer_pool_manager.h"
+#include "./free_space_map.h"
+#include "./transaction_manager.h"
+#include "./types.h"
+
+using namespace std;
+
+// Column pages: [uint32 null_count][uint32 reserved][null bitmap][values].
+// null_count is never lower than the number of NULLs on the page, so a
+// page with 0 has none and its bitmap is skipped.
+const int COLUMN_PAGE_HEADER_SIZE = 8;
+// Directory pages: [int32 next][int32 count][int32 page_id[...]]
+const int COLUMN_DIRECTORY_HEADER_SIZE = 8;
+const int COLUMN_DIRECTORY_ENTRIES = (PAGE_SIZE - COLUMN_DIRECTORY_HEADER_SIZE) / 4;
+// Dictionary pages: [int32 next][uint16 used][uint16 pad][data]
+const int COLUMN_DICTIONARY_HEADER_SIZE = 8;
+
+// A table stored column by column (CREATE TABLE ... WITH (storage =
+// column)). Every column, plus the hidden xmin and xmax version columns,
+// is a chain of pages holding fixed-width values: row r is value
+// r % capacity on page r / capacity. VARCHAR columns hold uint32 codes
+// into a per-column dictionary of distinct strings, so equal strings are
+// stored once and compared as integers.
+//
+// Meta page:
+//   [uint64 row_count][uint32 chain_count][uint32 reserved]
+//   per chain: [uint8 type][3 pad][int32 directory_first][int32 dictionary_first][int32 reserved]
+// The directory of a chain lists its pages in row order; the dictionary
+// is a byte stream of [uint16 len][bytes] entries spread over a chain of
+// pages, code k being the k-th entry.
+//
+// Rows are only appended. Deleting a row stamps its xmax (see
+// TransactionManager); the row stays on its page, so row numbers (the
+// record ids of a column table) never change. Every page change is
+// logged, and row_count is written last, so after a crash the table holds
+// exactly the rows whose append reached the log.
+//
+// One writer at a time (the caller serializes them); readers may run
+// alongside it. `latch` guards the in-memory page lists, dictionaries and
+// row count; page contents are guarded by their page latches.
+class ColumnTable {
+private:
+    struct Chain {
+        TypeId type;
+        size_t width;           // bytes per value
+        size_t capacity;        // values per page
+        vector<int> pages;      // in row order
+        int directory_last = INVALID_PAGE_ID;
+        int directory_count = 0; // entries on directory_last
+        // VARCHAR only
+        deque<string> dictionary;
+        unordered_map<string_view, uint32_t> codes; // views into `dictionary`
+        int dictionary_last = INVALID_PAGE_ID;
+        int dictionary_used = 0; // data bytes on dictionary_last
+    };
+
+    BufferPoolManager& buffer_pool;
+    FreeSpaceMap& free_space_map;
+    int segment_id;
+    int meta_page_id;
+    mutable shared_mutex latch;
+    vector<Chain> chains; // schema columns, then xmin and xmax
+    uint64_t rows = 0;
+
+    void load_chain(Chain& chain, int directory_first, int dictionary_first);
+    void add_data_page(Chain& chain);
+    void append_dictionary(Chain& chain, const string& value);
+    uint32_t encode(Chain& chain, const string& value);
+    void write_values(Chain& chain, uint64_t first, size_t n, const char* values, const vector<uint8_t>& nulls);
+    int data_page(const Chain& chain, uint64_t row) const;
+
+public:
+    // Allocates the meta page and empty chains of a new table in
+    // `segment_id`; returns the meta page id. Throws invalid_argument if
+    // the table has too many columns for one meta page.
+    static int create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, const vector<Column>& columns);
+    // Bytes per stored value of the type; VARCHAR values are dictionary codes.
+    static size_t value_width(TypeId type);
+    // Values per page of a chain of `width`-byte values.
+    static size_t page_capacity(size_t width);
+
+    ColumnTable(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, int meta_page_id);
+
+    // Chain numbers of the version columns; schema columns come first.
+    size_t xmin_column() const { return chains.size() - 2; }
+    size_t xmax_column() const { return chains.size() - 1; }
+    // Rows appended so far, deleted ones included.
+    uint64_t row_count() const;
+
+    // Appends rows (values in schema order, of the column types) inserted
+    // by `txn`; returns the row number of the first one.
+    uint64_t append(const vector<vector<Value>>& values, TxnId txn);
+    // Marks the row deleted by `txn`. Returns false if it does not exist or
+    // was deleted already.
+    bool remove(uint64_t row, TxnId txn);
+    // The row's values (only the flagged `columns`, the rest NULL) if the
+    // snapshot sees it.
+    bool read_row(uint64_t row, const Snapshot& snapshot, vector<Value>& values, const vector<bool>* columns = nullptr) const;
+
+    // Copies the values of rows [first, first + n) of a chain, all below
+    // row_count(), into `values` (n * width bytes; dictionary codes for
+    // VARCHAR) and sets bit i % 64 of nulls[i / 64] for every NULL.
+    void read(size_t chain, uint64_t first, size_t n, char* values, uint64_t* nulls) const;
+
+    // Dictionary access for scans: the caller holds read_lock(). Codes
+    // read by read() are always below dictionary_size().
+    shared_lock<shared_mutex> read_lock() const { return shared_lock<shared_mutex>(latch); }
+    size_t dictionary_size(size_t column) const { return chains[column].dictionary.size(); }
+    const string& dictionary_entry(size_t column, uint32_t code) const { return chains[column].dictionary[code]; }
+    // Whether `value` has a code, i.e. occurs in some row of the column.
+    bool find_code(size_t column, const string& value, uint32_t& code) const;
+};
+
+// Owns the ColumnTables of the database, opening each on first use. The
+// catalog creates and drops them; their pages belong to the table's
+// segment and are freed with it.
+class ColumnStore {
+private:
+    BufferPoolManager& buffer_pool;
+    FreeSpaceMap& free_space_map;
+    mutex latch;
+    unordered_map<int, shared_ptr<ColumnTable>> tables; // by meta page id
+
+public:
+    ColumnStore(BufferPoolManager& bpm, FreeSpaceMap& fsm);
+
+    // Returns the meta page id of the new table.
+    int create_table(int segment_id, const vector<Column>& columns);
+    shared_ptr<ColumnTable> open_table(int segment_id, int meta_page_id);
+    // Forgets the table; scans still running keep their reference.
+    void drop_table(int meta_page_id);
+};
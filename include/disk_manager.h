@@ -1,25 +1,75 @@
 #pragma once
 #include<string>
-#include<fstream>
 #include<vector>
+#include<cstddef>
+#include<atomic>
+#include<shared_mutex>
 
 using namespace std;
 
 const int PAGE_SIZE = 4096;
+// The mmap mode extends the file and its mapping this many pages at a time.
+const int MMAP_GROW_PAGES = 2048;
+
+enum class DiskMode {
+    PREAD,  // positioned reads/writes on the descriptor
+    MMAP    // pages are copied to and from a shared mapping of the file
+};
+
+// How the pages are about to be read; passed on to the kernel as a
+// readahead hint (madvise in mmap mode, posix_fadvise otherwise).
+enum class AccessPattern {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM
+};
 
 class DiskManager{
 private:
-    fstream db_file;
+    int fd;
     string file_name;
+    atomic<int> num_pages;
+    DiskMode mode;
+    // MMAP mode: the file's first `mapped_pages` pages. Copies hold
+    // `map_latch` shared; growing the mapping (which may move it) holds it
+    // exclusively.
+    shared_mutex map_latch;
+    char* mapping;
+    int mapped_pages;
+
+    bool grow_mapping(int min_pages);
+    bool ensure_mapped(int min_pages);
 
 public:
-    DiskManager(const std::string& filename);
+    DiskManager(const std::string& filename, DiskMode disk_mode = DiskMode::PREAD);
     ~DiskManager();
 
-    bool write_page(int page_id, const vector<char>& data);
-    vector<char> read_page(int page_id);
+    // LIMBODB_DISK_MODE=mmap selects MMAP; anything else is PREAD.
+    static DiskMode mode_from_environment();
+
+    // Page I/O uses positioned reads/writes on one descriptor; callers own
+    // the PAGE_SIZE buffer. Writes are not synced; durability comes from the
+    // write-ahead log and flush() at checkpoints. Reads may run on several
+    // threads at once and alongside a write; writes and appends are issued
+    // by one thread at a time (the buffer pool holds its latch).
+    // In MMAP mode the same calls are plain copies from and to the mapping,
+    // so a page the OS already caches is read without a system call. Pages
+    // only reach the mapping through write_page, which the buffer pool
+    // calls after the log is flushed, so the WAL rule still holds.
+    bool write_page(int page_id, const char* data);
+    bool read_page(int page_id, char* data);
+    // Reads the page with pread in any mode, without checking it against
+    // the page count. Safe to call from other threads (see ReadAhead).
+    bool pread_page(int page_id, char* data) const;
+    // Forces every written page to stable storage (msync in MMAP mode, then
+    // fdatasync).
     void flush();
+    void advise(AccessPattern pattern);
 
+    DiskMode get_mode() const { return mode; }
     int get_num_pages();
     int allocate_page();
-};
\ No newline at end of file
+    // Writes `count` consecutive pages past the end of the file with one
+    // sequential write and returns the first page id, or -1 on failure.
+    int append_pages(const char* data, int count);
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include "./buffer_pool_manager.h"
+#include "./header_page.h"
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// FSM page layout:
+//   [int32 next_fsm_page][uint8 category[N]][int32 segment[N]]
+const int FSM_PAGE_HEADER_SIZE = 4;
+const int FSM_ENTRIES_PER_PAGE = 816; // keeps the segment array 4-byte aligned
+const int FSM_CATEGORY_BYTES = 16; // one category step = 16 free bytes
+const uint8_t FSM_MAX_CATEGORY = 255;
+
+// Segment ids recorded per page. Every table owns one segment (its id is
+// kept in the catalog), and so does every index; the catalog itself lives
+// in CATALOG_SEGMENT. The header and FSM pages belong to NO_SEGMENT, and
+// pages released by DROP TABLE or DROP INDEX sit in FREE_SEGMENT until a
+// segment reuses them.
+const int FREE_SEGMENT = -1;
+const int NO_SEGMENT = 0;
+const int CATALOG_SEGMENT = 1;
+const int FIRST_TABLE_SEGMENT = 2;
+
+// Free-space map: for every page, one byte recording how much room is left
+// on it and the segment that owns it, stored in a chain of dedicated FSM
+// pages anchored in the database header. The whole map is cached in memory
+// with, per segment, its ordered page list (what a scan walks) and an
+// ordered index of (category, page_id) so finding room is O(log n).
+// Every public call holds `latch` (public calls nest, hence recursive), so
+// readers may look up segments while a writer changes the map.
+class FreeSpaceMap {
+private:
+    BufferPoolManager& buffer_pool;
+    mutable recursive_mutex latch;
+    vector<int> fsm_pages;               // FSM page k covers pages [k*N, (k+1)*N)
+    vector<uint8_t> categories;          // cached category for every covered page
+    vector<int> segments;                // cached owning segment for every covered page
+    unordered_map<int, set<pair<uint8_t, int>>> candidates; // per segment, pages with category > 0
+    unordered_map<int, set<int>> segment_pages;
+
+    void load();
+    void ensure_coverage(int page_id);
+    void set_category(int page_id, uint8_t category);
+    void write_entry(int page_id, bool segment_changed);
+
+public:
+    FreeSpaceMap(BufferPoolManager& bpm);
+
+    // Returns a page of `segment_id` that is guaranteed to have at least
+    // `required_bytes` free according to the map, or INVALID_PAGE_ID.
+    int find_page(int segment_id, int required_bytes);
+    // Records the current free space of a heap page.
+    void update(int page_id, int free_bytes);
+
+    // Records which segment a page belongs to.
+    void set_segment(int page_id, int segment_id);
+    int get_segment(int page_id) const;
+    // Pages of a segment in ascending page order.
+    vector<int> get_segment_pages(int segment_id) const;
+
+    // Hands out a new segment id (persisted in the database header).
+    int allocate_segment();
+    // Moves every page of the segment to FREE_SEGMENT.
+    void release_segment(int segment_id);
+    // Moves one page of a segment to FREE_SEGMENT.
+    void release_page(int page_id);
+    // A page released by some dropped segment, or INVALID_PAGE_ID. It stays
+    // in FREE_SEGMENT until the caller assigns it with set_segment().
+    int take_free_page();
+    // A released page if there is one, else a new page at the end of the
+    // file, assigned to the segment in one step so concurrent callers never
+    // get the same page. The page's contents are whatever it held before.
+    int allocate_page(int segment_id);
+
+    static uint8_t to_category(int free_bytes);
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include "./table_manager.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+const chrono::milliseconds GC_INTERVAL(1000);
+const size_t GC_BATCH_PAGES = 64;  // pages looked at per hold of the writer latch
+
+// Removes deleted row versions in the background. Every GC_INTERVAL it
+// takes the writer latch and runs TableManager::collect_garbage on batches
+// of GC_BATCH_PAGES pages, letting writers in between batches, until no
+// queued page has a version left that nobody can see.
+class GarbageCollector {
+private:
+    TableManager& tables;
+    chrono::milliseconds interval;
+
+    mutex latch;
+    condition_variable wake;
+    atomic<bool> stopping;
+    thread worker;
+
+    void run();
+
+public:
+    GarbageCollector(TableManager& tm, chrono::milliseconds period = GC_INTERVAL);
+    ~GarbageCollector();
+
+    GarbageCollector(const GarbageCollector&) = delete;
+    GarbageCollector& operator=(const GarbageCollector&) = delete;
+};
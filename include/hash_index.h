@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "./index.h"
+
+using namespace std;
+
+// Disk-resident extendible hash index (see Index). It answers equality
+// lookups only, touching the meta page, one directory page and one bucket
+// page (plus overflow pages for keys with very many duplicates).
+//
+// Meta page:
+//   [int32 global_depth][int32 directory_page_count][uint64 changed_lsn]
+//   [int32 directory_page[...]]
+// The directory has 2^global_depth slots, 1024 to a directory page; slot
+// (hash mod 2^global_depth) holds the bucket page for that hash. A bucket
+// with local depth d is shared by every slot whose low d bits match.
+//
+// Bucket page (overflow pages use the same layout; local_depth is unused):
+//   [uint16 local_depth][uint16 count][uint16 used][uint16 pad]
+//   [int32 next_overflow] [entries...]
+// Entry: [uint32 hash][uint16 key_len][key][int64 value]
+//
+// A full bucket splits in two by the next hash bit, doubling the directory
+// when its local depth reaches the global depth. Entries whose hashes
+// cannot be told apart (the same key repeated, or the directory at its
+// largest) go to overflow pages chained behind the bucket. Buckets are
+// never merged; their pages return to the free-space map when the index
+// is dropped or rebuilt.
+//
+// Readers hold the meta page shared for the whole lookup. A writer holds
+// it shared while it only changes one bucket and exclusively while it
+// splits a bucket, grows the directory or adds an overflow page.
+class HashIndex : public Index {
+private:
+    struct Entry {
+        uint32_t hash;
+        string key;
+        int64_t value;
+    };
+
+    static uint32_t hash_key(string_view key);
+    static size_t entry_size(size_t key_size);
+
+    static int global_depth(const PageGuard& meta);
+    int directory_page(const PageGuard& meta, uint32_t slot) const;
+    int bucket_for(const PageGuard& meta, uint32_t hash);
+    void set_slot(const PageGuard& meta, uint32_t slot, int bucket_page_id);
+    void grow_directory(PageGuard& meta);
+
+    static void init_page(PageGuard& guard, int local_depth);
+    static bool append(PageGuard& guard, const Entry& entry);
+    bool append_to_bucket(PageGuard& bucket, const Entry& entry);
+    void append_overflow(PageGuard& bucket, const Entry& entry);
+    vector<Entry> read_chain(PageGuard& bucket);
+    void split(PageGuard& meta, PageGuard& bucket, uint32_t hash);
+    void insert_exclusive(PageGuard& meta, const Entry& entry);
+
+public:
+    // Allocates a meta page, a directory page and one empty bucket in
+    // `segment_id`; returns the meta page id.
+    static int create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id);
+
+    HashIndex(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, int meta_page_id);
+
+    IndexType type() const override { return IndexType::HASH; }
+
+    void insert(const string& key, int64_t value) override;
+    void bulk_insert(const vector<pair<string, int64_t>>& entries) override;
+    bool remove(const string& key, int64_t value) override;
+    vector<int64_t> search(const string& key) override;
+};
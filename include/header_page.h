@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Page 0 of every database file holds database-wide metadata. Older files
+// have an all-zero page 0, which is how an uninitialized header is detected.
+const int HEADER_PAGE_ID = 0;
+const int INVALID_PAGE_ID = -1;
+const uint32_t DB_FORMAT_VERSION = 9;
+
+struct DatabaseHeader {
+    char magic[8];
+    uint32_t format_version;
+    int32_t fsm_first_page;   // head of the free-space map page chain
+    int32_t next_segment_id;  // next id handed out to a new table
+    uint64_t next_transaction_id; // next id handed out to a write transaction
+
+    bool is_initialized() const {
+        return memcmp(magic, "LIMBODB", 8) == 0;
+    }
+
+    void initialize() {
+        memset(this, 0, sizeof(DatabaseHeader));
+        memcpy(magic, "LIMBODB", 8);
+        format_version = DB_FORMAT_VERSION;
+        fsm_first_page = INVALID_PAGE_ID;
+        next_segment_id = 2; // FIRST_TABLE_SEGMENT
+        next_transaction_id = 1;
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./buffer_pool_manager.h"
+#include "./free_space_map.h"
+
+using namespace std;
+
+// Keys longer than this are stored truncated. Truncation preserves order, so
+// search/range_search still return every matching value, plus possibly some
+// whose key only shares the prefix; callers re-check the real value.
+const int INDEX_MAX_KEY_SIZE = 256;
+
+enum class IndexType { BTREE, HASH };
+
+string index_type_to_string(IndexType type);
+IndexType string_to_index_type(const string& name);
+
+// A disk-resident index mapping string keys to int64 values (encoded record
+// ids). Duplicate keys are allowed. Every index is anchored by a meta page,
+// so its identity never changes as it grows, and all of its pages belong to
+// the index's own segment in the free-space map.
+//
+// Index pages are not logged. Instead, the first change after a checkpoint
+// durably stamps the meta page's changed_lsn (bytes 8..15) with the log's
+// start LSN. After a crash, an index stamped with the start of the log being
+// replayed may be torn and is rebuilt from the table; every other index is
+// exactly as checkpointed.
+//
+// Callers serialize writers; readers may run alongside them.
+class Index {
+protected:
+    BufferPoolManager& buffer_pool;
+    FreeSpaceMap& free_space_map;
+    int segment_id;
+    int meta_page_id;
+
+    int allocate_page();
+    // Whether the meta page already carries the current log's start LSN.
+    bool change_noted(const PageGuard& meta) const;
+    // Called with the meta page exclusively latched before changing anything.
+    void note_change(PageGuard& meta);
+
+public:
+    Index(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, int meta_page_id);
+    virtual ~Index() = default;
+
+    int get_meta_page_id() const { return meta_page_id; }
+    int get_segment_id() const { return segment_id; }
+    // Whether the index changed while the log starting at `lsn` was written.
+    bool changed_since(uint64_t lsn);
+
+    virtual IndexType type() const = 0;
+    // Whether keys are kept in order, i.e. range_search is supported.
+    bool ordered() const { return type() == IndexType::BTREE; }
+
+    virtual void insert(const string& key, int64_t value) = 0;
+    virtual void bulk_insert(const vector<pair<string, int64_t>>& entries) = 0;
+    virtual bool remove(const string& key, int64_t value) = 0;
+    virtual vector<int64_t> search(const string& key) = 0;
+    // Ordered indexes only; the others throw logic_error.
+    virtual vector<int64_t> range_search(const string& start_key, const string& end_key);
+    // Every entry with key >= start_key; "" starts at the smallest key.
+    virtual vector<int64_t> range_search_from(const string& start_key);
+
+    static string truncate_key(const string& key);
+};
@@ -2,28 +2,71 @@
 
 #include <string>
 #include <unordered_map>
-#include <map>
-#include <vector>
+#include <memory>
 #include <set>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "./buffer_pool_manager.h"
+#include "./free_space_map.h"
+#include "./index.h"
 
 using namespace std;
 
 class IndexManager {
 private:
-    // table -> column -> key -> set<record_id>
-    unordered_map<string, unordered_map<string, map<string, set<int>>>> indexes;
+    BufferPoolManager& buffer_pool;
+    FreeSpaceMap& free_space_map;
+    // Start of the log replayed by recovery, 0 after a clean shutdown.
+    uint64_t stale_lsn;
+    // Held shared while an index is used and exclusively while indexes are
+    // added or dropped; the indexes latch their own pages.
+    shared_mutex latch;
+    // table -> column -> disk-resident B+Tree or hash index
+    unordered_map<string, unordered_map<string, unique_ptr<Index>>> indexes;
+    // (table, column) of opened indexes that changed in the replayed log.
+    set<pair<string, string>> stale;
 
-    bool column_exists(const string& table_name, const string& column_name);
+    // Callers hold `latch`.
+    Index* find_index(const string& table_name, const string& column_name);
+    unique_ptr<Index> make_index(IndexType type, int segment_id, int meta_page_id);
 
 public:
-    IndexManager() = default;
+    // `stale_lsn` is the first LSN of the log recovery replayed, or 0 if
+    // there was nothing to replay.
+    IndexManager(BufferPoolManager& bpm, FreeSpaceMap& fsm, uint64_t stale_lsn = 0);
 
-    bool create_index(const string& table_name, const string& column_name);
+    // Builds a new index in a segment of its own, loaded with `entries`
+    // ((key, record_id) pairs in any order). The caller records
+    // get_index_page() and get_index_segment() in the catalog so the index
+    // can be reopened with open_index() after restart. Callers serialize
+    // index creation.
+    bool create_index(const string& table_name, const string& column_name,
+                      const vector<pair<string, int64_t>>& entries = {}, IndexType type = IndexType::BTREE);
+    // Reopens a persisted index. One the crash may have left half written
+    // is opened anyway and listed by stale_indexes().
+    bool open_index(const string& table_name, const string& column_name, int meta_page_id, int segment_id,
+                    IndexType type = IndexType::BTREE);
+    // Drops the index and gives its pages back to the free-space map.
     bool drop_index(const string& table_name, const string& column_name);
+    bool has_index(const string& table_name, const string& column_name);
+    // Whether the column has an index that serves range searches.
+    bool has_ordered_index(const string& table_name, const string& column_name);
+    int get_index_page(const string& table_name, const string& column_name);
+    int get_index_segment(const string& table_name, const string& column_name);
+    // Opened indexes that must be rebuilt from their tables.
+    vector<pair<string, string>> stale_indexes();
 
-    bool insert_entry(const string& table_name, const string& column_name, const string& key, int record_id);
-    bool delete_entry(const string& table_name, const string& column_name, const string& key, int record_id);
+    bool insert_entry(const string& table_name, const string& column_name, const string& key, int64_t record_id);
+    // (key, record_id) pairs in any order, inserted in one batch (see
+    // BPlusTree::bulk_insert and HashIndex::bulk_insert).
+    bool insert_entries(const string& table_name, const string& column_name, const vector<pair<string, int64_t>>& entries);
+    bool delete_entry(const string& table_name, const string& column_name, const string& key, int64_t record_id);
 
-    vector<int> search(const string& table_name, const string& column_name, const string& key);
-    vector<int> range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key);
+    // Results may include records whose key only shares a long prefix with
+    // the one searched for (see INDEX_MAX_KEY_SIZE); callers re-check values.
+    vector<int64_t> search(const string& table_name, const string& column_name, const string& key);
+    // Ordered indexes only (see has_ordered_index).
+    vector<int64_t> range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key);
+    vector<int64_t> range_search_from(const string& table_name, const string& column_name, const string& start_key);
 };
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+using namespace std;
+
+// Log file layout:
+//   [char magic[8]][uint64 start_lsn] followed by records
+// Record layout:
+//   [uint32 size][uint32 checksum][uint64 lsn][uint8 type][uint8 pad]
+//   [uint16 slot_id][int32 page_id][uint16 offset][uint16 data_len][data]
+// `checksum` covers everything after itself, so a torn write at the tail of
+// the log is detected and cut off when the log is opened.
+const int LOG_FILE_HEADER_SIZE = 16;
+const uint32_t LOG_RECORD_HEADER_SIZE = 28;
+const size_t LOG_BUFFER_SIZE = 1 << 20;             // appends past this wake the flusher
+const size_t LOG_CHECKPOINT_SIZE = 16 * (1 << 20);  // log size that triggers a checkpoint
+
+enum class LogRecordType : uint8_t {
+    HEAP_INIT = 1,    // page_id: format an empty heap page
+    HEAP_INSERT = 2,  // page_id, slot_id, data: store a record in a slot
+    HEAP_DELETE = 3,  // page_id, slot_id: invalidate a slot
+    HEAP_UPDATE = 4,  // page_id, slot_id, data: overwrite a record in place
+    PAGE_WRITE = 5,   // page_id, offset, data: raw bytes (header and FSM pages)
+    HEAP_COMPACT = 6, // page_id, data[0]: defragment the page, trimming dead slots if set
+    HEAP_STAMP = 7,   // page_id, slot_id, data: set the xmax of a row version
+};
+
+struct LogRecord {
+    uint64_t lsn = 0;
+    LogRecordType type = LogRecordType::PAGE_WRITE;
+    int32_t page_id = -1;
+    uint16_t slot_id = 0;
+    uint16_t offset = 0;
+    vector<char> data;
+};
+
+// Sequential write-ahead log with group commit. Appends only go to an
+// in-memory buffer; a background thread writes the buffer out and syncs it
+// once for every commit waiting at that moment, so concurrent commits share
+// a single fdatasync. Pages must not reach the data file before the log
+// records describing them (the buffer pool calls flush() with the page LSN).
+class LogManager {
+private:
+    string file_name;
+    int fd;
+
+    mutex latch;
+    condition_variable flush_needed;
+    condition_variable flush_done;
+    thread flusher;
+    bool stopping;
+
+    vector<char> buffer;        // appended but not yet written
+    atomic<uint64_t> start_lsn; // first lsn of the current log file
+    uint64_t next_lsn;
+    uint64_t buffered_lsn;      // last lsn in `buffer`
+    uint64_t flush_requested;   // highest lsn some caller waits for
+    uint64_t flushed_lsn;       // everything up to here is durable
+    size_t file_size;
+
+    size_t commit_count;
+    size_t sync_count;
+
+    static thread_local uint64_t last_appended_lsn;
+
+    void open_log();
+    void write_file_header(int file, uint64_t start_lsn);
+    void flush_loop();
+
+public:
+    LogManager(const string& filename);
+    ~LogManager();
+
+    LogManager(const LogManager&) = delete;
+    LogManager& operator=(const LogManager&) = delete;
+
+    // Assigns the record its LSN and buffers it.
+    uint64_t append(LogRecord& record);
+    // Blocks until every record up to `lsn` is on stable storage.
+    void flush(uint64_t lsn);
+    // Makes everything the calling thread appended durable.
+    void commit();
+
+    // Records that survived the last run, in LSN order (used by recovery).
+    vector<LogRecord> read_records();
+    // Drops every record once the data file holds all of their effects.
+    // LSNs keep increasing across truncations so page LSNs stay comparable.
+    void truncate();
+    // Changes with every truncation, so it tells apart the stretches of
+    // log between checkpoints.
+    uint64_t get_start_lsn() const { return start_lsn; }
+
+    bool needs_checkpoint();
+    uint64_t get_flushed_lsn();
+    size_t get_commit_count() const { return commit_count; }
+    size_t get_sync_count() const { return sync_count; }
+};
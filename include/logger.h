@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+enum class LogLevel : int {
+    TRACE = 0, // per page / per record; hot paths
+    DEBUG = 1, // lifecycle and structural changes
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4,
+    OFF = 5,
+};
+
+// One bit per subsystem, so whole components can be compiled out or
+// muted at runtime.
+enum class LogComponent : uint32_t {
+    DISK = 1u << 0,
+    BUFFER_POOL = 1u << 1,
+    WAL = 1u << 2,
+    RECOVERY = 1u << 3,
+    FSM = 1u << 4,
+    RECORD = 1u << 5,
+    INDEX = 1u << 6,
+    BTREE = 1u << 7,
+    CATALOG = 1u << 8,
+    TABLE = 1u << 9,
+    QUERY = 1u << 10,
+    TXN = 1u << 11,
+    HASH = 1u << 12,
+    COLUMN = 1u << 13,
+};
+
+// Compile-time filter, set by CMake (LIMBO_LOG_LEVEL, LIMBO_LOG_COMPONENTS).
+// Statements below the level or outside the mask compile to nothing,
+// including the formatting of their arguments.
+#ifndef LIMBO_LOG_MIN_LEVEL
+#define LIMBO_LOG_MIN_LEVEL 1 // DEBUG
+#endif
+#ifndef LIMBO_LOG_COMPONENTS
+#define LIMBO_LOG_COMPONENTS 0xFFFFFFFFu
+#endif
+
+// Process-wide log sink. Lines are formatted by the caller and appended to
+// an in-memory buffer; the buffer reaches the output (stderr by default)
+// when it fills up, on ERROR, on flush() and at exit. In asynchronous mode
+// a background thread does the writing, so callers never block on I/O.
+class Logger {
+private:
+    atomic<int> level;
+    atomic<uint32_t> components;
+
+    mutex latch;       // guards the buffer and the writer state
+    mutex write_latch; // serializes writes to fd, keeping lines in order
+    condition_variable flush_needed;
+    string buffer;
+    int fd;
+    bool owns_fd;
+    bool async;
+    bool stopping;
+    thread writer;
+
+    Logger();
+    void write_out(const string& data);
+    void writer_loop();
+    void stop_writer();
+
+public:
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& instance();
+
+    // Runtime filter; only statements compiled in can be enabled.
+    bool enabled(LogLevel message_level, LogComponent component) const {
+        return static_cast<int>(message_level) >= level.load(memory_order_relaxed) &&
+               (static_cast<uint32_t>(component) & components.load(memory_order_relaxed)) != 0;
+    }
+    void set_level(LogLevel new_level) { level.store(static_cast<int>(new_level)); }
+    void set_components(uint32_t mask) { components.store(mask); }
+
+    // Appends to `path` instead of writing to stderr. Throws runtime_error.
+    void set_output(const string& path);
+    void set_async(bool enable);
+
+    // LIMBODB_LOG_LEVEL (TRACE..OFF), LIMBODB_LOG_FILE and
+    // LIMBODB_LOG_ASYNC=1.
+    void configure_from_environment();
+
+    void write(LogLevel message_level, LogComponent component, const string& message);
+    void flush();
+
+    static const char* level_name(LogLevel level);
+    static const char* component_name(LogComponent component);
+    // "TRACE", "debug", ... ; returns false on an unknown name.
+    static bool parse_level(const string& name, LogLevel& out);
+};
+
+#define LIMBO_LOG(log_level, log_component, msg)                                                  \
+    do {                                                                                          \
+        if constexpr (static_cast<int>(log_level) >= LIMBO_LOG_MIN_LEVEL &&                       \
+                      (static_cast<uint32_t>(log_component) & (LIMBO_LOG_COMPONENTS)) != 0) {     \
+            if (Logger::instance().enabled(log_level, log_component)) {                           \
+                std::ostringstream limbo_log_stream;                                              \
+                limbo_log_stream << msg;                                                          \
+                Logger::instance().write(log_level, log_component, limbo_log_stream.str());       \
+            }                                                                                     \
+        }                                                                                         \
+    } while (0)
+
+#define LOG_TRACE(component, msg) LIMBO_LOG(LogLevel::TRACE, LogComponent::component, msg)
+#define LOG_DEBUG(component, msg) LIMBO_LOG(LogLevel::DEBUG, LogComponent::component, msg)
+#define LOG_INFO(component, msg) LIMBO_LOG(LogLevel::INFO, LogComponent::component, msg)
+#define LOG_WARN(component, msg) LIMBO_LOG(LogLevel::WARN, LogComponent::component, msg)
+#define LOG_ERROR(component, msg) LIMBO_LOG(LogLevel::ERROR, LogComponent::component, msg)
@@ -0,0 +1,170 @@
+#ifndef AST_H
+#define AST_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../index.h"
+#include "../types.h"
+#include "./expression.h"
+
+enum class StatementType {
+    CREATE_TABLE,
+    DROP_TABLE,
+    CREATE_INDEX,
+    DROP_INDEX,
+    INSERT,
+    DELETE,
+    UPDATE,
+    SELECT,
+    PREPARE,
+    EXECUTE,
+    DEALLOCATE,
+    COPY,
+    VACUUM,
+};
+
+// Root of every parsed statement. Statements hold names and literals only;
+// tables and columns are resolved when the statement is executed, so one
+// parsed statement can be cached and run many times.
+struct Statement {
+    StatementType type;
+    int parameter_count = 0; // highest $n used
+
+    explicit Statement(StatementType statement_type) : type(statement_type) {}
+    virtual ~Statement() = default;
+};
+
+// CREATE TABLE name '(' column_def, ... ')' [WITH '(' storage '=' (row | column) ')']
+struct CreateTableStatement : Statement {
+    std::string table;
+    std::vector<Column> columns;
+    TableStorage storage = TableStorage::ROW;
+
+    CreateTableStatement() : Statement(StatementType::CREATE_TABLE) {}
+};
+
+struct DropTableStatement : Statement {
+    std::string table;
+
+    DropTableStatement() : Statement(StatementType::DROP_TABLE) {}
+};
+
+// CREATE [UNIQUE] INDEX name ON table [USING BTREE | HASH] '(' column ')'
+struct CreateIndexStatement : Statement {
+    std::string name;
+    std::string table;
+    std::string column;
+    bool unique = false;
+    IndexType type = IndexType::BTREE;
+
+    CreateIndexStatement() : Statement(StatementType::CREATE_INDEX) {}
+};
+
+struct DropIndexStatement : Statement {
+    std::string name;
+
+    DropIndexStatement() : Statement(StatementType::DROP_INDEX) {}
+};
+
+struct InsertStatement : Statement {
+    std::string table;
+    std::vector<std::string> columns; // empty: every column in schema order
+    std::vector<std::vector<Literal>> rows;
+
+    InsertStatement() : Statement(StatementType::INSERT) {}
+};
+
+struct DeleteStatement : Statement {
+    std::string table;
+    std::unique_ptr<Expr> where; // null without WHERE
+
+    DeleteStatement() : Statement(StatementType::DELETE) {}
+};
+
+struct UpdateStatement : Statement {
+    std::string table;
+    std::vector<std::pair<std::string, Literal>> assignments;
+    std::unique_ptr<Expr> where;
+
+    UpdateStatement() : Statement(StatementType::UPDATE) {}
+};
+
+// One entry of a SELECT list: a column, or an aggregate of a column
+// (COUNT(*) has none).
+struct SelectItem {
+    std::string column;
+    bool aggregate = false;
+    AggregateFunction function = AggregateFunction::COUNT;
+
+    // The output column name: the column, or e.g. "SUM(price)".
+    std::string name() const { return aggregate ? aggregate_name(function, column) : column; }
+};
+
+// SELECT ... FROM table [JOIN join_table ON join_left = join_right] ...;
+// columns may be written "table.column".
+struct SelectStatement : Statement {
+    std::string table;
+    std::string join_table; // empty without JOIN
+    std::string join_left;  // the ON columns as written
+    std::string join_right;
+    std::vector<SelectItem> items; // empty for SELECT *
+    std::unique_ptr<Expr> where;
+    std::vector<std::string> group_by;
+    // Tests the grouped rows; its columns are group columns or aggregate
+    // names, the aggregates being listed in having_aggregates.
+    std::unique_ptr<Expr> having;
+    std::vector<SelectItem> having_aggregates;
+
+    bool aggregates() const {
+        if (!group_by.empty() || having) return true;
+        for (const SelectItem& item : items) {
+            if (item.aggregate) return true;
+        }
+        return false;
+    }
+
+    SelectStatement() : Statement(StatementType::SELECT) {}
+};
+
+// PREPARE name AS statement. The body is kept as text and parsed through
+// the statement cache, so equal bodies share one parsed statement.
+struct PrepareStatement : Statement {
+    std::string name;
+    std::string body;
+
+    PrepareStatement() : Statement(StatementType::PREPARE) {}
+};
+
+// EXECUTE name [(value, ...)]; the values become $1, $2, ...
+struct ExecuteStatement : Statement {
+    std::string name;
+    std::vector<Literal> arguments;
+
+    ExecuteStatement() : Statement(StatementType::EXECUTE) {}
+};
+
+struct DeallocateStatement : Statement {
+    std::string name;
+
+    DeallocateStatement() : Statement(StatementType::DEALLOCATE) {}
+};
+
+// COPY name [(column, ...)] FROM 'file.csv' [WITH HEADER]
+struct CopyStatement : Statement {
+    std::string table;
+    std::vector<std::string> columns; // as for INSERT
+    std::string path;
+    bool header = false; // skip the first line
+
+    CopyStatement() : Statement(StatementType::COPY) {}
+};
+
+struct VacuumStatement : Statement {
+    std::string table; // empty: every table
+
+    VacuumStatement() : Statement(StatementType::VACUUM) {}
+};
+
+#endif // AST_H
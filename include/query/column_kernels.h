@@ -0,0 +1,33 @@
+#ifndef COLUMN_KERNELS_H
+#define COLUMN_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "../transaction_manager.h"
+#include "./expression.h"
+
+// Filter kernels over the value vectors of a ColumnScan batch. Each one
+// tests n values and writes a selection mask: bit i % 64 of mask[i / 64]
+// is set if value i passes, and the bits past n are clear. The kernels
+// run on AVX2 or SSE4.2 when the CPU has them and fall back to plain
+// loops otherwise; the choice is made once, at the first call.
+// LIMBODB_SIMD=avx2|sse4|scalar caps it, e.g. to compare the variants.
+enum class SimdLevel { SCALAR, SSE4, AVX2 };
+
+SimdLevel simd_level();
+const char* simd_level_name(SimdLevel level);
+
+inline size_t mask_words(size_t n) { return (n + 63) / 64; }
+
+// `values[i] op operand`. Doubles follow Value::compare: NaN is neither
+// less nor greater than anything, so it is "equal" to every value.
+void compare_int32(const int32_t* values, size_t n, CompareOp op, int32_t operand, uint64_t* mask);
+void compare_int64(const int64_t* values, size_t n, CompareOp op, int64_t operand, uint64_t* mask);
+void compare_double(const double* values, size_t n, CompareOp op, double operand, uint64_t* mask);
+void compare_uint8(const uint8_t* values, size_t n, CompareOp op, uint8_t operand, uint64_t* mask);
+// `matches[codes[i]] != 0`: a predicate precomputed per dictionary code.
+void lookup_codes(const uint32_t* codes, size_t n, const int32_t* matches, uint64_t* mask);
+// The versions a snapshot with this horizon sees (see Snapshot::sees).
+void visible_versions(const TxnId* xmin, const TxnId* xmax, size_t n, TxnId horizon, uint64_t* mask);
+
+#endif // COLUMN_KERNELS_H
@@ -0,0 +1,32 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "./expression.h"
+
+// Reads the rows of a CSV file for COPY. Fields are separated by commas
+// and may be enclosed in double quotes, inside which commas and line breaks
+// are literal and "" is a quote. Each field becomes a Literal: an empty or
+// NULL unquoted field is NULL, quoted fields are strings, anything else is
+// parsed like an unquoted SQL literal.
+class CsvReader {
+public:
+    // Throws std::runtime_error if the file cannot be opened.
+    explicit CsvReader(const std::string& path);
+
+    // False at end of file. Throws std::invalid_argument on an unterminated
+    // quoted field.
+    bool next_row(std::vector<Literal>& row);
+    // Line on which the last row returned started (1-based).
+    size_t row_line() const { return start_line; }
+
+private:
+    std::ifstream in;
+    std::vector<char> buffer;
+    size_t line = 0;
+    size_t start_line = 0;
+};
+
+#endif // CSV_READER_H
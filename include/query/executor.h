@@ -0,0 +1,453 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../catalog_manager.h"
+#include "../index_manager.h"
+#include "../record_iterator.h"
+#include "../row_layout.h"
+#include "../spill_file.h"
+#include "../types.h"
+
+// One row flowing between operators.
+struct Tuple {
+    std::vector<Value> values;
+    int64_t record_id = -1; // heap location (row number in column tables) for rows read from a table, else -1
+};
+
+// Volcano-style pull operator. open() prepares it, every next() produces
+// one tuple until it returns false, close() releases what open() acquired.
+// Rows are produced on demand, so a pipeline holds only the tuples in
+// flight no matter how large its input is.
+class Operator {
+public:
+    virtual ~Operator() = default;
+
+    virtual void open() = 0;
+    virtual bool next(Tuple& out) = 0;
+    virtual void close() = 0;
+
+    virtual const std::vector<Column>& output_columns() const = 0;
+};
+
+// Leaf operator: reads the rows of a table's heap segment that its snapshot
+// sees, decoding each one as it is pulled. Only the page under the cursor
+// is pinned.
+// Scans given a column mask decode only those columns (the rest are NULL),
+// so overflow pages of unused columns are never read.
+class SeqScan : public Operator {
+private:
+    RecordManager& record_manager;
+    TableSchema schema;
+    RowLayout layout;
+    std::shared_ptr<const Snapshot> snapshot;
+    std::vector<bool> columns; // empty: every column
+    std::unique_ptr<RecordIterator> iterator;
+
+public:
+    SeqScan(RecordManager& rm, const TableSchema& table_schema, std::shared_ptr<const Snapshot> read_snapshot,
+            std::vector<bool> used_columns = {});
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return schema.columns; }
+};
+
+// One lookup done by an IndexScan. Bounds are inclusive index keys (see
+// Value::index_key); an empty column means a direct record_id lookup.
+struct IndexProbe {
+    std::string column;
+    std::string low_key;    // "" starts at the smallest key
+    std::string high_key;
+    bool has_high = false;  // false: no upper bound
+    bool exact = false;     // match low_key only
+    int64_t record_id = -1; // record_id lookups
+};
+
+// Leaf operator: runs its probes against the table's indexes when opened,
+// then fetches and decodes the matching rows in heap order, each row once.
+// Indexes hold an entry for every version until it is garbage collected,
+// so versions the snapshot does not see are skipped. Probes may
+// over-approximate (truncated keys, strict bounds), so plans always put a
+// Filter on top.
+class IndexScan : public Operator {
+private:
+    RecordManager& record_manager;
+    IndexManager& index_manager;
+    TableSchema schema;
+    RowLayout layout;
+    std::shared_ptr<const Snapshot> snapshot;
+    std::vector<IndexProbe> probes;
+    std::vector<bool> columns;
+    std::vector<int64_t> record_ids;
+    size_t cursor = 0;
+    std::vector<char> row;
+
+public:
+    IndexScan(RecordManager& rm, IndexManager& im, const TableSchema& table_schema,
+              std::shared_ptr<const Snapshot> read_snapshot, std::vector<IndexProbe> index_probes,
+              std::vector<bool> used_columns = {});
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return schema.columns; }
+};
+
+struct Expr;
+enum class CompareOp;
+
+// Pages per morsel, the unit of work of a ParallelScan.
+const size_t MORSEL_PAGES = 32;
+// Morsels a ParallelScan may finish ahead of its consumer.
+const size_t PARALLEL_SCAN_WINDOW = 64;
+
+// Threads a ParallelScan starts: LIMBODB_SCAN_THREADS if set, else one per
+// hardware thread.
+size_t parallel_scan_threads();
+
+// Leaf operator for large tables: a SeqScan with its filter pushed down,
+// run by worker threads. The segment's pages are cut into morsels of
+// MORSEL_PAGES pages that workers claim in page order; a worker decodes
+// and filters the rows of its morsel into a batch. next() returns the
+// batches in morsel order, so the rows come out exactly as
+// Filter(SeqScan) would produce them. At most PARALLEL_SCAN_WINDOW
+// finished morsels wait for the consumer. Every worker reads as of the
+// scan's snapshot, so writers may change the table while the scan is
+// open. The predicate is borrowed and may be null.
+class ParallelScan : public Operator {
+private:
+    struct Morsel {
+        std::vector<Tuple> rows;
+        bool done = false;
+    };
+
+    RecordManager& record_manager;
+    TableSchema schema;
+    RowLayout layout;
+    std::shared_ptr<const Snapshot> snapshot;
+    std::vector<bool> columns;
+    const Expr* predicate;
+    size_t thread_count;
+
+    std::vector<int> pages;
+    std::vector<Morsel> morsels;
+    size_t next_morsel = 0;  // next morsel a worker claims
+    size_t current = 0;      // morsel next() is returning rows from
+    bool current_ready = false;
+    size_t row = 0;
+
+    std::mutex latch;
+    std::condition_variable morsel_done;
+    std::condition_variable window_moved;
+    bool stopping = false;
+    std::exception_ptr failure;
+    std::vector<std::thread> workers;
+
+    void worker_loop();
+    void scan_morsel(size_t index, std::vector<Tuple>& out);
+
+public:
+    ParallelScan(RecordManager& rm, const TableSchema& table_schema, std::shared_ptr<const Snapshot> read_snapshot,
+                 const Expr* where, size_t threads, std::vector<bool> used_columns = {});
+    ~ParallelScan() override { close(); }
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return schema.columns; }
+};
+
+// Rows a ColumnScan reads and filters at a time.
+const size_t COLUMN_SCAN_BATCH = 2048;
+
+// Leaf operator for tables stored by column (see ColumnTable). Rows are
+// read COLUMN_SCAN_BATCH at a time, copying out of their pages only the
+// columns the plan uses plus the version columns. Visibility and the
+// predicate are evaluated over the whole batch with the filter kernels
+// (see column_kernels.h), giving a selection mask; only the selected rows
+// become tuples. The predicate is applied exactly, so plans need no Filter
+// on top. VARCHAR equality compares dictionary codes; other VARCHAR tests
+// are worked out once per dictionary entry. Rows appended after open()
+// are not read. The predicate is borrowed and may be null.
+class ColumnScan : public Operator {
+private:
+    std::shared_ptr<ColumnTable> table;
+    TableSchema schema;
+    std::shared_ptr<const Snapshot> snapshot;
+    const Expr* predicate;
+    std::vector<bool> columns; // read; the predicate's columns included
+    bool has_strings = false;  // a VARCHAR column is read
+
+    uint64_t row_count = 0; // rows in the table at open()
+    uint64_t next_row = 0;
+    uint64_t batch_first = 0;
+    size_t batch_rows = 0;
+    size_t cursor = 0;
+    std::vector<std::vector<char>> values;    // per column, the batch's values
+    std::vector<std::vector<uint64_t>> nulls; // per column, the batch's NULLs
+    std::vector<TxnId> xmin;
+    std::vector<TxnId> xmax;
+    std::vector<int64_t> row_numbers;         // operand of record_id tests
+    std::vector<uint64_t> selected;
+    // Per VARCHAR leaf of the predicate, whether each dictionary code matches.
+    std::unordered_map<const Expr*, std::vector<int32_t>> match_tables;
+
+    bool load_batch();
+    void evaluate(const Expr& expr, uint64_t* mask);
+    void compare(const Expr& expr, CompareOp op, const Value& operand, uint64_t* mask);
+    const std::vector<int32_t>& match_table(const Expr& expr);
+
+public:
+    ColumnScan(std::shared_ptr<ColumnTable> column_table, const TableSchema& table_schema,
+               std::shared_ptr<const Snapshot> read_snapshot, const Expr* where, std::vector<bool> used_columns = {});
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return schema.columns; }
+};
+
+// Passes on the child's tuples that satisfy the predicate. The predicate
+// is borrowed and must outlive the operator.
+class Filter : public Operator {
+private:
+    std::unique_ptr<Operator> child;
+    const Expr* predicate;
+
+public:
+    Filter(std::unique_ptr<Operator> input, const Expr* where);
+
+    void open() override { child->open(); }
+    bool next(Tuple& out) override;
+    void close() override { child->close(); }
+
+    const std::vector<Column>& output_columns() const override { return child->output_columns(); }
+};
+
+enum class AggregateFunction { COUNT, SUM, AVG, MIN, MAX };
+
+// "COUNT(*)", "SUM(price)": the output column name of an aggregate; an
+// empty column is COUNT(*).
+std::string aggregate_name(AggregateFunction function, const std::string& column);
+
+// One aggregate computed by a HashAggregate.
+struct AggregateSpec {
+    AggregateFunction function = AggregateFunction::COUNT;
+    int column = -1; // input column; -1 for COUNT(*)
+};
+
+// Rows a HashAggregate worker takes from the child at a time.
+const size_t AGGREGATE_BATCH_ROWS = 1024;
+
+// Groups the child's tuples by the `group_by` columns and computes the
+// aggregates of every group. Output tuples hold the group columns, then
+// one column per aggregate (see aggregate_name), one tuple per group
+// ordered by the group columns, NULLs first; without group columns there
+// is exactly one tuple, even for no input. Aggregates skip NULLs, except COUNT(*); SUM,
+// AVG, MIN and MAX of no values are NULL. Integer sums are BIGINT and
+// throw std::invalid_argument when they overflow; AVG is a DOUBLE summed
+// in doubles.
+//
+// open() does the work: `threads` workers take turns pulling
+// AGGREGATE_BATCH_ROWS tuples from the child and fold them into hash
+// tables of their own, which are merged once the child is exhausted; the
+// child is closed then. Every scan operator may be pulled from any thread
+// as long as calls do not overlap.
+class HashAggregate : public Operator {
+private:
+    struct State {
+        int64_t count = 0;
+        int64_t int_sum = 0;
+        double double_sum = 0;
+        Value extreme; // MIN or MAX so far
+    };
+    struct Group {
+        std::vector<Value> keys;
+        std::vector<State> states;
+    };
+    struct HashTable {
+        std::unordered_map<std::string, size_t> index; // group_key -> position in groups
+        std::vector<Group> groups;
+    };
+
+    std::unique_ptr<Operator> child;
+    std::vector<int> group_by;
+    std::vector<AggregateSpec> aggregates;
+    size_t thread_count;
+    std::vector<Column> columns;
+    std::vector<Tuple> results;
+    size_t cursor = 0;
+
+    // Encodes the group columns so that equal groups have equal keys and
+    // keys sort in output order.
+    void group_key(const Tuple& tuple, std::string& key) const;
+    void accumulate(HashTable& table, const Tuple& tuple, std::string& key) const;
+    void merge(HashTable& into, HashTable& from) const;
+    void combine(size_t aggregate, State& into, const State& from) const;
+    Value result(size_t aggregate, const State& state) const;
+
+public:
+    // Throws std::invalid_argument for SUM or AVG of a non-numeric column.
+    HashAggregate(std::unique_ptr<Operator> input, std::vector<int> group_columns, std::vector<AggregateSpec> specs,
+                  size_t threads);
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return columns; }
+};
+
+// Join keys: two non-NULL values of joinable columns (both numeric, or of
+// one type) are equal iff their keys are. Numbers compare as doubles if
+// either column is DOUBLE (`as_double`), else as 64-bit integers.
+bool joinable(TypeId left, TypeId right);
+std::string join_key(const Value& value, bool as_double);
+
+// Bytes of build-side tuples a HashJoin keeps in memory before it spills:
+// LIMBODB_JOIN_MEMORY_MB megabytes, 64 by default.
+size_t join_memory_budget();
+// Partitions of a HashJoin that spilled, and how many times a partition
+// still over the budget may be partitioned again.
+const size_t HASH_JOIN_PARTITIONS = 32;
+const int HASH_JOIN_MAX_DEPTH = 4;
+
+// Inner equi-join: tuples of `left` and `right` whose key columns hold
+// equal, non-NULL values (see join_key). Output tuples are the left
+// tuple's values followed by the right one's, named by `joined_columns`.
+//
+// open() reads the build side (the right one, or the left if
+// `build_left`) into a hash table; next() streams the other, probe side
+// through it. A build side over `memory_budget` bytes spills: both sides
+// are hash partitioned into HASH_JOIN_PARTITIONS runs of a SpillFile, and
+// the partitions are joined one at a time, each build partition in memory.
+// A build partition still over the budget is partitioned again with the
+// next hash seed, up to HASH_JOIN_MAX_DEPTH levels; one that cannot be
+// split (a single key, or the last level) is joined in budget-sized
+// chunks, each against the whole probe partition. The hash table thus
+// never holds much more than `memory_budget` bytes.
+class HashJoin : public Operator {
+private:
+    // Spilled runs to join: build tuples, and the probe tuples that hash alike.
+    struct Partition {
+        std::shared_ptr<SpillFile> file;
+        size_t run = 0; // build run; the probe run is run + HASH_JOIN_PARTITIONS
+        int depth = 0;  // partitioning level; its hash seed
+    };
+
+    std::unique_ptr<Operator> build;
+    std::unique_ptr<Operator> probe;
+    int build_key;
+    int probe_key;
+    bool build_left;
+    size_t memory_budget;
+    bool as_double;
+    std::vector<Column> columns;
+
+    std::unordered_map<std::string, std::vector<Tuple>> table; // build tuples by join key
+    bool spilled = false;
+    std::vector<Partition> pending; // joined from the back
+    Partition active;
+    std::unique_ptr<SpillFile::Reader> build_run; // rest of `active` while it is joined in chunks
+    std::unique_ptr<SpillFile::Reader> probe_run;
+    Tuple current; // probe tuple being joined
+    const std::vector<Tuple>* matches = nullptr;
+    size_t cursor = 0;
+    std::string entry;
+
+    static size_t partition_of(const std::string& key, int depth);
+    void spill_tuple(SpillFile& file, size_t first_run, const Tuple& tuple, const std::string& key, int depth);
+    bool load_chunk();
+    void repartition();
+    bool load_partition();
+    bool next_probe();
+
+public:
+    HashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, int left_key, int right_key,
+             bool build_left, size_t memory_budget, std::vector<Column> joined_columns);
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return columns; }
+};
+
+// Inner equi-join that looks the key of every `outer` tuple up in the
+// inner table's index on its `inner_key` column (IndexManager::search) and
+// joins it with the inner rows found that the snapshot sees and
+// `inner_predicate` (bound to the inner table, may be null) accepts. Output
+// tuples are the left tuple's values followed by the right one's; the
+// outer side is the left one if `outer_left`. A non-empty `inner_columns`
+// mask limits the inner columns decoded; it must include the key and the
+// predicate's columns.
+class IndexNestedLoopJoin : public Operator {
+private:
+    std::unique_ptr<Operator> outer;
+    RecordManager& record_manager;
+    IndexManager& index_manager;
+    TableSchema inner_schema;
+    RowLayout layout;
+    std::shared_ptr<const Snapshot> snapshot;
+    int outer_key;
+    int inner_key;
+    const Expr* inner_predicate;
+    std::vector<bool> inner_columns;
+    bool outer_left;
+    bool as_double;
+    std::vector<Column> columns;
+
+    Tuple current; // outer tuple being joined
+    std::string current_key;
+    std::vector<int64_t> record_ids;
+    size_t cursor = 0;
+    std::vector<char> row;
+    Tuple inner;
+
+    void probe_index(const Value& key);
+
+public:
+    IndexNestedLoopJoin(std::unique_ptr<Operator> outer_input, RecordManager& rm, IndexManager& im,
+                        const TableSchema& inner_table, std::shared_ptr<const Snapshot> read_snapshot, int outer_column,
+                        int inner_column, const Expr* predicate, std::vector<bool> used_columns, bool outer_is_left,
+                        std::vector<Column> joined_columns);
+
+    void open() override;
+    bool next(Tuple& out) override;
+    void close() override;
+
+    const std::vector<Column>& output_columns() const override { return columns; }
+};
+
+// Keeps the listed columns of the child's tuples, in the listed order.
+class Projection : public Operator {
+private:
+    std::unique_ptr<Operator> child;
+    std::vector<int> column_indexes;
+    std::vector<Column> columns;
+    Tuple input;
+
+public:
+    Projection(std::unique_ptr<Operator> input_operator, std::vector<int> indexes);
+
+    void open() override { child->open(); }
+    bool next(Tuple& out) override;
+    void close() override { child->close(); }
+
+    const std::vector<Column>& output_columns() const override { return columns; }
+};
+
+#endif // EXECUTOR_H
@@ -0,0 +1,62 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../catalog_manager.h"
+#include "../types.h"
+#include "./executor.h"
+
+// Pseudo-column holding a row's heap location; usable in any WHERE clause
+// unless the table has a real column of that name.
+const char* const RECORD_ID_COLUMN = "record_id";
+
+// A literal as written in a statement, or a $n parameter of a prepared
+// statement. It gets its type only when bound to a column.
+struct Literal {
+    std::string text;   // without quotes
+    bool quoted = false;
+    int parameter = 0;  // n of $n; 0 for a constant
+
+    // Typed value for the column, taking $n from `parameters` (which are
+    // constants). Throws std::invalid_argument like Value::parse.
+    Value bind(const Column& column, const std::vector<Literal>& parameters) const;
+    std::string to_string() const;
+};
+
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+// Boolean WHERE-clause predicate. The parser fills in column names and
+// literals; bind() resolves them against a table, producing the tree that
+// is planned and evaluated. AND/OR nodes combine two children. Any
+// comparison involving NULL is false.
+struct Expr {
+    enum class Kind { COMPARE, BETWEEN, IN, AND, OR };
+
+    Kind kind = Kind::COMPARE;
+
+    // COMPARE, BETWEEN and IN
+    std::string column;
+    CompareOp op = CompareOp::EQ;
+    std::vector<Literal> literals; // COMPARE: operand, BETWEEN: low and high, IN: list
+    int column_index = -1;         // bound: -1 is the record_id pseudo-column
+    std::vector<Value> values;     // bound: literals typed for the column
+
+    // AND and OR
+    std::unique_ptr<Expr> left;
+    std::unique_ptr<Expr> right;
+
+    // Throws std::invalid_argument on an unknown column or a literal that
+    // does not fit its column.
+    std::unique_ptr<Expr> bind(const TableSchema& schema, const std::vector<Literal>& parameters) const;
+    // Unbound copy with every column name replaced by rename(name).
+    std::unique_ptr<Expr> rename(const std::function<std::string(const std::string&)>& name) const;
+    bool evaluate(const Tuple& tuple) const;
+    // Marks the table columns a bound predicate reads.
+    void mark_columns(std::vector<bool>& columns) const;
+    std::string to_string() const;
+};
+
+#endif // EXPRESSION_H
@@ -0,0 +1,29 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <vector>
+
+enum class TokenType {
+    IDENTIFIER, // names and keywords; keywords are matched case-insensitively
+    NUMBER,
+    STRING,     // 'quoted', text holds the contents without quotes
+    PARAMETER,  // $n placeholder of a prepared statement, text holds n
+    SYMBOL,     // ( ) , ; * = <> != < <= > >=
+    END,
+};
+
+struct Token {
+    TokenType type;
+    std::string text;
+    size_t position; // offset in the query, for error messages
+
+    bool is_keyword(const char* keyword) const;
+    bool is_symbol(const char* symbol) const;
+};
+
+// Splits a SQL string into tokens; the last token is always END. Throws
+// std::invalid_argument on an unterminated string or unexpected character.
+std::vector<Token> tokenize(const std::string& sql);
+
+#endif // LEXER_H
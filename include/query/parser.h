@@ -0,0 +1,80 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "./ast.h"
+#include "./lexer.h"
+
+// Recursive-descent parser for LimboDB's SQL. One Parser parses one
+// statement; an optional trailing ';' is accepted. Errors are thrown as
+// std::invalid_argument naming what was expected and what was found.
+//
+//   statement := CREATE TABLE name '(' column_def, ... ')' [WITH '(' STORAGE '=' (ROW | COLUMN) ')']
+//              | DROP TABLE name
+//              | CREATE [UNIQUE] INDEX name ON name [USING (BTREE | HASH)] '(' column ')'
+//              | DROP INDEX name
+//              | INSERT INTO name ['(' column, ... ')'] VALUES '(' literal, ... ')', ...
+//              | COPY name ['(' column, ... ')'] FROM 'path' [WITH HEADER]
+//              | DELETE FROM name [WHERE or_expr]
+//              | UPDATE name SET column '=' literal, ... [WHERE or_expr]
+//              | SELECT ('*' | select_item, ...) FROM name [[INNER] JOIN name ON column '=' column]
+//                  [WHERE or_expr] [GROUP BY column, ...] [HAVING or_expr]
+//              | VACUUM [name]
+//              | PREPARE name AS statement
+//              | EXECUTE name ['(' literal, ... ')']
+//              | DEALLOCATE [PREPARE] name
+//   or_expr   := and_expr (OR and_expr)*
+//   and_expr  := primary (AND primary)*
+//   primary   := '(' or_expr ')' | column op literal
+//              | column BETWEEN literal AND literal | column IN '(' literal, ... ')'
+//                (in HAVING, aggregate may stand for column)
+//   select_item := column | aggregate
+//   aggregate := COUNT '(' '*' ')' | (COUNT | SUM | AVG | MIN | MAX) '(' column ')'
+//   literal   := number | 'string' | identifier (NULL, TRUE, ...) | $n
+class Parser {
+private:
+    std::string sql;
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    int parameter_count = 0;
+    SelectStatement* having = nullptr; // while parsing its HAVING clause
+
+    const Token& peek() const { return tokens[pos]; }
+    [[noreturn]] void fail(const std::string& expected) const;
+    bool accept_keyword(const char* keyword);
+    void expect_keyword(const char* keyword);
+    void expect_symbol(const char* symbol);
+    std::string expect_identifier(const char* what);
+    Literal parse_literal();
+    std::vector<Literal> parse_literal_list();
+    std::vector<std::string> parse_column_list();
+    SelectItem parse_select_item();
+
+    std::unique_ptr<Statement> parse_create_table();
+    std::unique_ptr<Statement> parse_drop_table();
+    std::unique_ptr<Statement> parse_create_index(bool unique);
+    std::unique_ptr<Statement> parse_drop_index();
+    std::unique_ptr<Statement> parse_insert();
+    std::unique_ptr<Statement> parse_copy();
+    std::unique_ptr<Statement> parse_delete();
+    std::unique_ptr<Statement> parse_update();
+    std::unique_ptr<Statement> parse_select();
+    std::unique_ptr<Statement> parse_vacuum();
+    std::unique_ptr<Statement> parse_prepare();
+    std::unique_ptr<Statement> parse_execute();
+    std::unique_ptr<Statement> parse_deallocate();
+
+    std::unique_ptr<Expr> parse_where();
+    std::unique_ptr<Expr> parse_or();
+    std::unique_ptr<Expr> parse_and();
+    std::unique_ptr<Expr> parse_primary();
+
+public:
+    explicit Parser(const std::string& query);
+
+    std::unique_ptr<Statement> parse_statement();
+};
+
+#endif // PARSER_H
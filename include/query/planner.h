@@ -0,0 +1,49 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <memory>
+#include "../catalog_manager.h"
+#include "../index_manager.h"
+#include "../record_manager.h"
+#include "./executor.h"
+#include "./expression.h"
+
+// Chooses the access path for a single-table WHERE clause. A comparison
+// with an indexed column (=, <, <=, >, >=, BETWEEN, IN) or `record_id =`
+// can drive an IndexScan; AND uses its most selective such child, OR needs
+// both sides to be indexable. Anything else is a SeqScan. The predicate
+// (borrowed by the plan) is always re-checked by a Filter on top; a null
+// predicate plans a plain SeqScan. Tables of PARALLEL_SCAN_MIN_PAGES pages
+// or more are scanned by a ParallelScan instead, with the predicate
+// evaluated by its workers, when more than one scan thread is available.
+// Tables stored by column are always read by a ColumnScan, which applies
+// the predicate itself.
+// A non-empty `columns` mask limits the columns the scan decodes; it must
+// include every column the predicate reads. The plan reads the table as of
+// `snapshot` and keeps it open until the plan is destroyed.
+const size_t PARALLEL_SCAN_MIN_PAGES = 2 * MORSEL_PAGES;
+
+// Threads worth reading `schema`'s table with: parallel_scan_threads() for
+// tables of PARALLEL_SCAN_MIN_PAGES pages or more, 1 for smaller ones,
+// where starting workers costs more than it saves.
+size_t scan_threads(RecordManager& rm, const TableSchema& schema);
+
+std::unique_ptr<Operator> plan_scan(RecordManager& rm, IndexManager& im, ColumnStore& cs, const TableSchema& schema,
+                                    std::shared_ptr<const Snapshot> snapshot, const Expr* predicate,
+                                    const std::vector<bool>& columns = {});
+
+// Plans `left JOIN right ON left.columns[left_key] = right.columns[right_key]`
+// reading both tables as of `snapshot`; `*_predicate` and `*_columns` are
+// what plan_scan takes for each table, and the masks must include the key
+// columns. If one side is a row table with an index on its key column it
+// becomes the inner side of an IndexNestedLoopJoin (the right one if both
+// qualify); otherwise a HashJoin builds on the side with fewer pages.
+// Output columns are named "table.column", left ones first. Throws
+// std::invalid_argument if the key columns cannot be compared.
+std::unique_ptr<Operator> plan_join(RecordManager& rm, IndexManager& im, ColumnStore& cs, const TableSchema& left,
+                                    const TableSchema& right, int left_key, int right_key,
+                                    std::shared_ptr<const Snapshot> snapshot, const Expr* left_predicate,
+                                    const Expr* right_predicate, const std::vector<bool>& left_columns = {},
+                                    const std::vector<bool>& right_columns = {});
+
+#endif // PLANNER_H
@@ -1,13 +1,21 @@
 #ifndef QUERY_PARSER_H
 #define QUERY_PARSER_H
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "../catalog_manager.h"
 #include "../table_manager.h"
 #include "../index_manager.h"
 #include "../record_manager.h"
+#include "./ast.h"
+#include "./statement_cache.h"
 
+// Runs SQL statements. Statement text is parsed once into an AST (see
+// Parser) and kept in a StatementCache; each execution binds the AST to
+// the current catalog, plans it and runs it. A QueryParser serves one
+// session; several sessions on their own threads may share the managers.
 class QueryParser {
 public:
     QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im);
@@ -21,21 +29,63 @@ private:
     CatalogManager& catalog_manager;
     TableManager& table_manager;
     IndexManager& index_manager;
+    StatementCache statement_cache;
+    // PREPARE name -> parsed body
+    std::unordered_map<std::string, std::shared_ptr<const Statement>> prepared_statements;
 
-    // Parse and execute different types of queries
-    bool parse_create_table(const std::string& query);
-    bool parse_drop_table(const std::string& query);
-    bool parse_insert(const std::string& query);
-    bool parse_delete(const std::string& query);
-    bool parse_update(const std::string& query);
-    bool parse_select(const std::string& query);
-    bool parse_print_table(const std::string& query);
+    // `parameters` supply $1, $2, ... of a prepared statement. Statements
+    // that change the database hold the table manager's write latch.
+    bool execute(const Statement& statement, const std::vector<Literal>& parameters);
+    static bool changes_database(StatementType type);
 
+    bool execute_create_table(const CreateTableStatement& statement);
+    bool execute_drop_table(const DropTableStatement& statement);
+    bool execute_create_index(const CreateIndexStatement& statement);
+    bool execute_drop_index(const DropIndexStatement& statement);
+    bool execute_insert(const InsertStatement& statement, const std::vector<Literal>& parameters);
+    bool execute_copy(const CopyStatement& statement);
+    bool execute_delete(const DeleteStatement& statement, const std::vector<Literal>& parameters);
+    bool execute_update(const UpdateStatement& statement, const std::vector<Literal>& parameters);
+    // What a SELECT reads: one table, or the join of two. A join's columns
+    // are named "table.column"; its WHERE is split into the conjuncts one
+    // table can test by itself, which that table's scan applies, and the
+    // rest, tested on the joined rows.
+    struct SelectSource {
+        TableSchema schema;          // columns the plan produces
+        std::unique_ptr<Expr> where; // bound to schema; a join's remaining conjuncts
+        bool join = false;
+        TableSchema left;            // the table, or the join's tables
+        TableSchema right;
+        int left_key = -1;           // ON columns, in left and in right
+        int right_key = -1;
+        std::unique_ptr<Expr> left_where; // bound to left / right
+        std::unique_ptr<Expr> right_where;
 
-    // Utility parsing helpers
-    static void trim(std::string& s);
-    static std::vector<std::string> split(const std::string& s, char delimiter);
+        // Position of a column written as "column" or "table.column" (a bare
+        // column of a join must belong to one table only; throws
+        // std::invalid_argument otherwise); -1 if there is none.
+        int find_column(const std::string& name) const;
+    };
 
+    bool execute_select(const SelectStatement& statement, const std::vector<Literal>& parameters);
+    bool execute_aggregate(const SelectStatement& statement, const SelectSource& source,
+                           const std::vector<Literal>& parameters);
+    SelectSource open_source(const SelectStatement& statement, const std::vector<Literal>& parameters);
+    // Reads the source; a non-empty `used` mask (over schema) lists the
+    // columns needed besides those of `where`.
+    std::unique_ptr<Operator> plan_source(const SelectSource& source, const std::vector<bool>& used);
+    bool execute_vacuum(const VacuumStatement& statement);
+    bool execute_prepare(const PrepareStatement& statement);
+    bool execute_execute(const ExecuteStatement& statement);
+    bool execute_deallocate(const DeallocateStatement& statement);
+
+    TableSchema get_table(const std::string& table_name);
+    // Schema position of each listed column (all columns when `columns` is
+    // empty); throws std::invalid_argument for an unknown column.
+    std::vector<int> target_columns(const TableSchema& schema, const std::vector<std::string>& columns);
+    // A full row with `literals` bound to the target columns and NULL elsewhere.
+    std::vector<Value> bind_row(const TableSchema& schema, const std::vector<int>& targets,
+                                const std::vector<Literal>& literals, const std::vector<Literal>& parameters);
 };
 
 #endif // QUERY_PARSER_H
@@ -0,0 +1,38 @@
+#ifndef STATEMENT_CACHE_H
+#define STATEMENT_CACHE_H
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "./ast.h"
+
+const size_t STATEMENT_CACHE_SIZE = 256;
+
+// LRU cache of parsed statements keyed by their exact text, so a statement
+// sent again (or a prepared one run again) is not re-tokenized or
+// re-parsed. Entries are shared: a statement evicted while a prepared
+// name or a running execution still holds it stays alive until released.
+class StatementCache {
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Statement>>;
+
+    size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> lookup;
+    size_t hits = 0;
+    size_t misses = 0;
+
+public:
+    explicit StatementCache(size_t max_entries = STATEMENT_CACHE_SIZE);
+
+    // Returns the parsed statement for `sql`, parsing it on a miss. Parse
+    // errors are thrown (std::invalid_argument) and not cached.
+    std::shared_ptr<const Statement> get(const std::string& sql);
+
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+};
+
+#endif // STATEMENT_CACHE_H
@@ -0,0 +1,65 @@
+#pragma once
+#include "./disk_manager.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+const int READ_AHEAD_THREADS = 4;
+const size_t READ_AHEAD_MAX_PAGES = 64;  // page images staged at once
+
+// Reads pages on a small pool of I/O threads before they are needed. The
+// buffer pool requests pages that are about to be fetched and, on a miss,
+// takes the staged image instead of reading the page itself.
+//
+// A requested page is not resident, and only resident pages are ever
+// written, so a staged image stays current until it is taken.
+class ReadAhead {
+private:
+    struct Request {
+        vector<char> data;
+        bool started = false;
+        bool done = false;
+        bool ok = false;
+    };
+
+    DiskManager& disk;
+
+    mutex latch;
+    condition_variable work_ready;
+    condition_variable read_done;
+    bool stopping;
+    deque<int> queue;                               // not yet started
+    unordered_map<int, unique_ptr<Request>> requests; // queued, in flight or staged
+    vector<thread> workers;
+
+    size_t reads;
+    size_t used;
+
+    void worker_loop();
+
+public:
+    ReadAhead(DiskManager& dm, int threads = READ_AHEAD_THREADS);
+    ~ReadAhead();
+
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Queues a read of the page unless it is already requested. When the
+    // staging area is full, a staged page nobody took is dropped to make
+    // room; if every slot is still being read the request is ignored.
+    void request(int page_id);
+    // Copies the staged image of the page into `data`, waiting for a read in
+    // flight. Returns false if the page was not requested, its read failed or
+    // had not started yet (the request is withdrawn); the caller then reads
+    // the page itself.
+    bool take(int page_id, char* data);
+
+    size_t get_reads() const { return reads; }
+    size_t get_used() const { return used; }
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <iostream>
 
 struct RecordID {
@@ -20,16 +21,23 @@ public:
         return page_id >= 0 && slot_id >= 0;
     }
 
-    int encode() const {
-        return (page_id << 16) | slot_id;
+    // Page id in the upper bits, slot id in the low 16. Page ids are full
+    // 32-bit values, so an encoded id needs 48 bits.
+    int64_t encode() const {
+        return (static_cast<int64_t>(page_id) << 16) | slot_id;
     }
 
-    static RecordID decode(int record_id) {
-        int page_id = record_id >> 16;
-        int slot_id = record_id & 0xFFFF;
+    static RecordID decode(int64_t record_id) {
+        int page_id = static_cast<int>(record_id >> 16);
+        int slot_id = static_cast<int>(record_id & 0xFFFF);
         return RecordID(page_id, slot_id);
     }
 
+    // True if record_id is the encoding of some valid RecordID.
+    static bool in_range(int64_t record_id) {
+        return record_id >= 0 && (record_id >> 16) <= INT32_MAX;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const RecordID& rid) {
         os << "[Page: " << rid.page_id << ", Slot: " << rid.slot_id << "]";
         return os;
@@ -1,21 +1,39 @@
+#pragma once
 #include<iostream>
-#include"disk_manager.h"
+#include"buffer_pool_manager.h"
 #include"record_manager.h"
+#include <shared_mutex>
 #include <tuple>
 
 using namespace std;
 
+// Pages of the segment requested ahead of the cursor (see
+// BufferPoolManager::prefetch).
+const size_t READ_AHEAD_PAGES = 16;
+
 class RecordIterator {
 private:
-    DiskManager& disk;
+    BufferPoolManager& buffer_pool;
+    vector<int> pages;      // the segment's pages, in page order
+    size_t page_index;
+    size_t prefetch_index;  // pages before this one have been requested
     int current_page_id;
     int current_slot_id;
-    std::vector<char> page;
+    const Snapshot* snapshot;
+    // The current page stays pinned while the cursor is on it. It is only
+    // latched (shared) inside next(), so a caller may change the segment
+    // between calls; the cursor re-reads the slot array every time.
+    PageGuard page;
 
+    bool load_page(size_t index);
     void load_next_valid_record();
+    bool yields(const char* data, uint16_t slot_count) const;
 
 public:
-    RecordIterator(DiskManager& disk_manager);
+    // Iterates the live records of one segment. With a snapshot (table
+    // segments only) it yields the rows of the versions the snapshot sees,
+    // without their version headers; the snapshot must outlive the iterator.
+    RecordIterator(RecordManager& rm, int segment_id, const Snapshot* snapshot = nullptr);
 
     bool has_next() const;
 
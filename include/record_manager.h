@@ -1,17 +1,40 @@
 #pragma once
-#include "./disk_manager.h"
+#include "./buffer_pool_manager.h"
+#include "./free_space_map.h"
+#include "./transaction_manager.h"
 #include<unordered_map>
 #include <cstdint>
 #include <vector>
 #include <string>
 #include<cstring>
 #include "record_id.h"
+#include "./row_layout.h"
 
 using namespace std;
 
-const int HEADER_SIZE = 4; // Size of the header in each page (2 bytes for slot count, 2 bytes for free offset)
+// Heap page header: [uint16 slot_count][uint16 free_offset][uint64 page_lsn]
+const int HEADER_SIZE = 12;
+const int PAGE_LSN_OFFSET = 4;
 const int SLOT_SIZE = 4; // Size of each slot in the header
 const uint16_t INVALID_SLOT = 0xFFFF; // Invalid slot value
+const int BULK_WRITE_PAGES = 256; // pages per sequential write of a bulk load
+
+// Overflow page: [int32 next_page][uint16 used][uint16 pad][data]
+const int OVERFLOW_HEADER_SIZE = 8;
+const int OVERFLOW_DATA_SIZE = PAGE_SIZE - OVERFLOW_HEADER_SIZE;
+// Rows encoded larger than this move their longest VARCHAR values, if
+// longer than OVERFLOW_MIN_VALUE, to overflow pages.
+const size_t ROW_INLINE_LIMIT = PAGE_SIZE / 4;
+const size_t OVERFLOW_MIN_VALUE = 128;
+
+// What one VACUUM pass over a segment did.
+struct VacuumStats {
+    size_t pages = 0;           // pages examined
+    size_t compacted = 0;       // pages defragmented
+    size_t released = 0;        // empty pages handed back for reuse
+    size_t bytes_reclaimed = 0; // space turned from garbage into usable free space
+    size_t versions_removed = 0; // dead row versions collected first
+};
 
 struct Record{
     vector<char> data;
@@ -41,23 +64,114 @@ struct Record{
 
 class RecordManager{
 private:
-    DiskManager& disk;
+    BufferPoolManager& buffer_pool;
+    FreeSpaceMap free_space_map;
+    TransactionManager transactions;
     int next_page_id;
 
-    int find_free_page();
+    int find_free_page(int segment_id, int required_bytes);
+    void log_heap_change(PageGuard& guard, LogRecordType type, uint16_t slot_id, const char* data, size_t size);
+    void compact(PageGuard& guard, bool trim_slots);
+    OverflowPointer store_overflow(int segment_id, const string& value);
+    string read_overflow(const OverflowPointer& pointer);
     // pair<int, int> decode_record_id(int record_id);
     // int encode_record_id(int page_id, int slot_id);
 
 public:
-    RecordManager(DiskManager& dm);
+    RecordManager(BufferPoolManager& bpm);
+
+    BufferPoolManager& get_buffer_pool() {
+        return buffer_pool;
+    }
+
+    TransactionManager& get_transactions() {
+        return transactions;
+    }
 
-    DiskManager& get_disk() {
-        return disk;
+    FreeSpaceMap& get_free_space_map() {
+        return free_space_map;
     }
 
-    int insert_record(const Record& record);
-    Record get_record(int record_id);
-    void delete_record(int record_id);
-    int update_record(int record_id, const Record& record);
-    
+    // Bytes still available for record data plus slot entries on a heap page,
+    // counting the garbage left by deletes and shrinking updates that
+    // compact_page() would recover.
+    static int page_free_space(const char* page);
+    // The unfragmented part of page_free_space(), between the slot array and
+    // the record data.
+    static int contiguous_free_space(const char* page);
+    // First dead slot, or slot_count if every slot is in use.
+    static uint16_t find_free_slot(const char* page);
+
+    // Heap page changes, shared by the write path and log redo.
+    static void init_heap_page(char* page);
+    static void insert_into_page(char* page, uint16_t slot_id, const char* data, uint16_t size);
+    static void delete_from_page(char* page, uint16_t slot_id);
+    static void update_in_page(char* page, uint16_t slot_id, const char* data, uint16_t size);
+    static void stamp_in_page(char* page, uint16_t slot_id, TxnId xmax);
+    // Moves the live records together at the end of the page; slot ids do
+    // not change. With `trim_slots`, dead slots at the end of the slot
+    // array are dropped as well.
+    static void compact_page(char* page, bool trim_slots);
+    static uint64_t get_page_lsn(const char* page);
+    static void set_page_lsn(char* page, uint64_t lsn);
+
+    // Overflow pages of a segment are kept in a segment of their own, so
+    // scans never see them and dropping the segment frees them too.
+    static int overflow_segment(int segment_id) { return -segment_id - 1; }
+
+    // Segments group the heap pages of one table (or of the catalog).
+    int create_segment();
+    void drop_segment(int segment_id);
+    vector<int> get_segment_pages(int segment_id) const;
+
+    int64_t insert_record(int segment_id, const Record& record);
+    // Packs the records into fresh pages in memory and appends them to the
+    // file in large sequential writes, without per-row log records. The
+    // pages are synced before the free-space map (which is logged) adds
+    // them to the segment, so a crash leaves either the whole batch or
+    // only unreferenced pages. Returns the record ids in input order.
+    vector<int64_t> bulk_insert(int segment_id, const vector<Record>& records);
+    // True if record_id names a live record of the segment; never throws.
+    bool has_record(int segment_id, int64_t record_id);
+    void delete_record(int64_t record_id);
+
+    // Table rows are versions (see TransactionManager); catalog records
+    // have no version header.
+    //
+    // Prefixes an encoded row with the header of a version inserted by the
+    // running write transaction.
+    Record new_version(const vector<char>& row);
+    // Marks the version deleted by the running write transaction. Returns
+    // false if some transaction already deleted it.
+    bool delete_version(int64_t record_id);
+    // Copies the row of a version of the segment into `row`, without its
+    // header, if the snapshot sees it; returns false otherwise (also for
+    // empty slots and pages of other segments).
+    bool get_record(int segment_id, int64_t record_id, const Snapshot& snapshot, vector<char>& row);
+    // Versions on one page of the segment that were deleted at or before
+    // `horizon`, with their headers. `pending` is set to the oldest later
+    // deletion left on the page, or 0 if there is none.
+    vector<Record> expired_versions(int segment_id, int page_id, TxnId horizon, TxnId& pending);
+
+    // Encodes a row for the segment, moving the longest VARCHAR values to
+    // chains of overflow pages while the row exceeds ROW_INLINE_LIMIT.
+    vector<char> encode_row(int segment_id, const RowLayout& layout, const vector<Value>& values);
+    // Decodes a stored row, reading out-of-line values from their overflow
+    // pages. With `columns`, only the flagged columns are decoded and the
+    // rest are left NULL, so unused overflow values are never read.
+    vector<Value> decode_row(const RowLayout& layout, const char* row, const vector<bool>* columns = nullptr);
+    // Releases the overflow pages of a row that is being deleted or replaced.
+    void free_overflow(const RowLayout& layout, const char* row);
+
+    // Compacts every fragmented page of the segment and releases the pages
+    // left without live records. Record ids do not change, so indexes stay
+    // valid; the work is committed in small batches and the table can be
+    // used in between.
+    VacuumStats vacuum_segment(int segment_id);
+
+    // Ends a statement: waits until its log records are durable (group
+    // commit), publishes its write transaction and checkpoints once the
+    // log has grown large.
+    void commit();
+
 };
\ No newline at end of file
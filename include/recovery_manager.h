@@ -0,0 +1,27 @@
+#pragma once
+#include "./buffer_pool_manager.h"
+#include "./log_manager.h"
+#include <cstddef>
+
+using namespace std;
+
+// Redo-only recovery. Every heap change is logged before its page can reach
+// disk, so replaying the log brings the data file to the state of the last
+// logged change. Heap records are applied only when the page LSN shows the
+// page is older than the record; raw page writes and page initialization
+// are idempotent and always applied. Index pages are not logged; callers
+// rebuild indexes when recover() reports that records were replayed.
+class RecoveryManager {
+private:
+    BufferPoolManager& buffer_pool;
+    LogManager& log;
+
+    void redo(const LogRecord& record);
+
+public:
+    RecoveryManager(BufferPoolManager& bpm, LogManager& lm);
+
+    // Replays the log and checkpoints. Returns the number of log records
+    // found, which is 0 after a clean shutdown.
+    size_t recover();
+};
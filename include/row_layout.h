@@ -0,0 +1,59 @@
+#pragma once
+#include "./types.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// A VARCHAR value kept outside its row in a chain of overflow pages (see
+// RecordManager::encode_row); the row holds this pointer in its place.
+struct OverflowPointer {
+    int32_t first_page = -1;
+    uint32_t length = 0;
+};
+
+const size_t OVERFLOW_POINTER_SIZE = 8;
+const uint16_t VAR_EXTERNAL_FLAG = 0x8000; // set in var_end for out-of-line values
+
+// Binary row format for one table schema:
+//   [null bitmap: 1 bit per column]
+//   [fixed-width columns, in schema order, at fixed offsets]
+//   [uint16 var_end[k]: end offset of the k-th variable-length column]
+//   [variable-length data]
+// Every column is reachable in O(1): fixed columns by their offset, the
+// k-th VARCHAR between var_end[k-1] (or the start of the data) and
+// var_end[k]. NULL columns keep their fixed slot zeroed and have empty
+// variable-length data. A var_end with VAR_EXTERNAL_FLAG set marks a value
+// whose data is an OverflowPointer rather than the string itself.
+class RowLayout {
+private:
+    vector<Column> columns;
+    vector<uint16_t> offsets;   // fixed columns: byte offset; VARCHARs: index into var_end
+    size_t null_bytes;
+    size_t var_array_offset;
+    size_t var_count;
+    size_t var_data_offset;
+
+    uint16_t var_end(const char* row, size_t var_index) const;
+    pair<uint16_t, uint16_t> var_range(const char* row, size_t column_index) const;
+
+public:
+    explicit RowLayout(const vector<Column>& cols);
+
+    size_t column_count() const { return columns.size(); }
+    const Column& column(size_t i) const { return columns[i]; }
+
+    // Throws invalid_argument if the values do not match the schema.
+    // VARCHAR columns with a valid pointer in `external` are stored as
+    // that pointer instead of their value.
+    vector<char> encode(const vector<Value>& values, const vector<OverflowPointer>* external = nullptr) const;
+    bool is_null(const char* row, size_t column_index) const;
+    bool is_external(const char* row, size_t column_index) const;
+    OverflowPointer overflow_pointer(const char* row, size_t column_index) const;
+    // Throws logic_error for an out-of-line value, which only the record
+    // manager can read (RecordManager::decode_row).
+    Value get(const char* row, size_t column_index) const;
+    vector<Value> decode(const char* row) const;
+    vector<Value> decode(const vector<char>& row) const { return decode(row.data()); }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "./disk_manager.h"
+
+using namespace std;
+
+// Scratch pages for operators whose state outgrows their memory budget
+// (see HashJoin). The pages live in a temporary file in the working
+// directory that is unlinked as soon as it is created, so they bypass the
+// buffer pool and the WAL and vanish with the process, crash or not.
+//
+// A SpillFile holds `run_count` runs: streams of entries (byte strings of
+// any length) appended in PAGE_SIZE pages and read back in append order.
+// One thread at a time.
+class SpillFile {
+private:
+    struct Run {
+        vector<int> pages;
+        string tail;      // bytes not on a page yet
+        size_t bytes = 0; // length of the stream, tail included
+    };
+
+    int fd = -1;
+    int page_count = 0;
+    vector<Run> runs;
+
+    void write_page(Run& run, const char* data);
+
+public:
+    // Throws runtime_error if the file cannot be created.
+    explicit SpillFile(size_t run_count);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    void append(size_t run, const string& entry);
+    // Writes out the last, partial page of every run. Call it after the last
+    // append and before reading.
+    void finish();
+    int pages() const { return page_count; }
+
+    class Reader {
+    private:
+        const SpillFile& file;
+        const Run& run;
+        size_t page = 0;      // next page to read
+        size_t remaining = 0; // stream bytes on the pages not read yet
+        string buffer;        // read from the pages, not returned yet from `offset` on
+        size_t offset = 0;
+
+        bool fill(size_t bytes);
+
+    public:
+        Reader(const SpillFile& spill, size_t run);
+        // The next entry of the run; false at its end.
+        bool next(string& entry);
+    };
+};
@@ -3,7 +3,15 @@
 #include "./catalog_manager.h"
 #include "./record_manager.h"
 #include "./index_manager.h"
+#include "./column_store.h"
+#include "./types.h"
+#include "./query/executor.h"
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -13,14 +21,101 @@ private:
     CatalogManager& catalog;
     RecordManager& record_mgr;
     IndexManager& index_mgr;
+    ColumnStore& column_store;
+    mutex writer;
+    // Per heap table, the pages holding deleted versions, each with the oldest
+    // deleting transaction not collected yet (0: unknown, look at the page).
+    // Guarded by the writer latch.
+    map<string, map<int, TxnId>> garbage_pages;
+
+    bool remove_row(const TableSchema& schema, int64_t record_id);
+    void replace_row(const TableSchema& schema, const vector<int>& indexed, int64_t record_id, const vector<Value>& new_values);
+    vector<char> read_row(const TableSchema& schema, int64_t record_id);
+    // The table's ColumnTable; COLUMN storage only.
+    shared_ptr<ColumnTable> column_table(const TableSchema& schema);
+    size_t collect_table(const TableSchema& schema, map<int, TxnId>& pages, TxnId horizon, size_t& max_pages);
+
+    // Schema positions of the columns with a declared index; only those
+    // are maintained on writes.
+    vector<int> indexed_columns(const TableSchema& schema);
+    void index_row(const TableSchema& schema, const vector<int>& indexed, const vector<Value>& values, int64_t record_id);
+    void unindex_row(const TableSchema& schema, const vector<int>& indexed, const vector<Value>& values, int64_t record_id);
+    // (key, record_id) of every version in the table, for each of `columns`.
+    vector<vector<pair<string, int64_t>>> read_index_keys(const TableSchema& schema, const vector<int>& columns);
+    // Throws std::invalid_argument if writing `rows` would give a unique
+    // index two live rows with the same key. `replaced` are the rows the
+    // statement deletes before writing.
+    void check_unique(const TableSchema& schema, const vector<const vector<Value>*>& rows,
+                      const unordered_set<int64_t>& replaced);
+    bool key_in_use(const TableSchema& schema, int column, const string& key, const unordered_set<int64_t>& replaced);
 
 public:
-    TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im);
-
-    int insert_into(const string& table_name, const vector<string>& values);
-    bool delete_from(const string& table_name, int record_id);
-    bool update(const string& table_name, int record_id, const vector<string>& new_values);
-    Record select(const string& table_name, int record_id);
-    vector<Record> scan(const string& table_name); // optional: full scan
-    void printTable(const std::string& tableName);
+    TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im, ColumnStore& cs);
+
+    // Values must be in schema order and of the column types (see
+    // Value::parse); rows are stored in the table's RowLayout, or appended
+    // to a column table. The record id of a row of a column table is its
+    // row number.
+    int64_t insert_into(const string& table_name, const vector<Value>& values);
+    bool delete_from(const string& table_name, int64_t record_id);
+    bool update(const string& table_name, int64_t record_id, const vector<Value>& new_values);
+    // Statement-sized batches: every row is changed, then the statement
+    // commits once. `rows` carry the record_id and the new values.
+    // Loads many rows with one commit. Batches of at least
+    // BULK_LOAD_MIN_PAGES pages go through RecordManager::bulk_insert and
+    // build their index entries afterwards, one sorted batch per index.
+    size_t insert_rows(const string& table_name, const vector<vector<Value>>& rows);
+    size_t delete_rows(const string& table_name, const vector<int64_t>& record_ids);
+    size_t update_rows(const string& table_name, const vector<Tuple>& rows);
+    Record select(const string& table_name, int64_t record_id);
+    vector<Value> select_values(const string& table_name, int64_t record_id);
+    // Streaming scan of the rows matching `where` (all rows if null), using
+    // an index when the planner finds one; nullptr if the table does not
+    // exist. The plan borrows `where`. See plan_scan for `columns`. The
+    // plan reads a snapshot taken here, so writers are not held up by it
+    // and it never sees their changes.
+    unique_ptr<Operator> scan(const string& table_name, const Expr* where = nullptr, const vector<bool>& columns = {});
+    // Streaming inner join of two tables on one column each, both read as
+    // of one snapshot taken here; see plan_join.
+    unique_ptr<Operator> join(const TableSchema& left, const TableSchema& right, int left_key, int right_key,
+                              const Expr* left_where, const Expr* right_where, const vector<bool>& left_columns,
+                              const vector<bool>& right_columns);
+    // Threads worth reading the table with; see scan_threads.
+    size_t scan_threads(const TableSchema& schema);
+    void printTable(const std::string& tableName, const Expr* where = nullptr);
+    // Prints every row the plan produces; opens and closes it.
+    void print(Operator& plan);
+
+    // Collects the table's dead versions, then reclaims the space of
+    // deleted rows online (see RecordManager::vacuum_segment). Column
+    // tables keep deleted rows in place and are left as they are. The
+    // caller holds write_latch().
+    VacuumStats vacuum(const string& table_name);
+
+    // Deletes, unindexes and frees the overflow values of the versions no
+    // snapshot can see any more, looking at up to `max_pages` pages, then
+    // commits. Returns true if pages may be left for another call. The
+    // caller holds write_latch(). See GarbageCollector.
+    bool collect_garbage(size_t max_pages);
+
+    // CREATE INDEX: builds the index from the table's rows and publishes it
+    // complete, so readers go on using the table meanwhile. Returns the
+    // number of entries. The caller holds write_latch(). Throws
+    // std::invalid_argument for an unknown table or column, a column
+    // table, a taken name, a column that already has an index, or
+    // (unique) duplicate values.
+    size_t create_index(const string& index_name, const string& table_name, const string& column_name, bool unique,
+                        IndexType type = IndexType::BTREE);
+
+    // Index pages are not covered by the log; after crash recovery the
+    // indexes that changed since the last checkpoint (see
+    // IndexManager::stale_indexes) are rebuilt from the table's row
+    // versions, deleted ones included until they are collected. Does
+    // nothing after a clean shutdown.
+    void rebuild_indexes();
+
+    // Held by every statement that changes the database, so there is one
+    // writer at a time. Readers (scans, lookups) do not take it; they read
+    // a snapshot alongside the writer, under page latches.
+    mutex& write_latch() { return writer; }
 };
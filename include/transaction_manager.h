@@ -0,0 +1,73 @@
+#pragma once
+#include "./buffer_pool_manager.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+
+using namespace std;
+
+using TxnId = uint64_t;
+
+// Table rows are stored as versions: [uint64 xmin][uint64 xmax][row].
+// xmin is the transaction that inserted the version, xmax the one that
+// deleted it (0 while it is live). An update deletes the old version and
+// inserts a new one, so readers keep seeing the old row until they take a
+// new snapshot.
+const int VERSION_HEADER_SIZE = 16;
+const int VERSION_XMAX_OFFSET = 8;
+
+// What one reader sees: the changes of every transaction up to and
+// including `horizon`. Writers are serialized, so transactions commit in
+// id order and a single id describes the committed state.
+struct Snapshot {
+    TxnId horizon;
+
+    bool sees(TxnId xmin, TxnId xmax) const {
+        return xmin <= horizon && (xmax == 0 || xmax > horizon);
+    }
+
+    bool sees(const char* version) const {
+        TxnId xmin, xmax;
+        memcpy(&xmin, version, sizeof(xmin));
+        memcpy(&xmax, version + VERSION_XMAX_OFFSET, sizeof(xmax));
+        return sees(xmin, xmax);
+    }
+
+    // The newest version of every row, the running write transaction's
+    // changes included. Only the writer reads this way.
+    static Snapshot latest() { return Snapshot{UINT64_MAX}; }
+};
+
+// Hands out transaction ids and snapshots. Every statement that changes a
+// table runs as one write transaction; it starts with its first change and
+// ends at RecordManager::commit(), which publishes it to later snapshots.
+// The next id is kept in the database header, so ids keep growing across
+// restarts. Open snapshots are tracked to tell the garbage collector which
+// deleted versions somebody may still read.
+class TransactionManager {
+private:
+    BufferPoolManager& buffer_pool;
+    mutex latch;
+    TxnId last_committed;
+    TxnId writer;                    // running write transaction, 0 if none
+    multiset<TxnId> open_horizons;   // horizons of the open snapshots
+
+public:
+    TransactionManager(BufferPoolManager& bpm);
+
+    // The running write transaction, started (and its id logged) on the
+    // first call after a commit.
+    TxnId write_transaction();
+    // Makes the running write transaction visible to new snapshots. The
+    // caller has made its log records durable.
+    void commit();
+
+    // A snapshot of the committed state. It stays registered until the
+    // last copy of the pointer is gone.
+    shared_ptr<const Snapshot> open_snapshot();
+    // Versions deleted at or before this transaction are invisible to every
+    // open and future snapshot.
+    TxnId gc_horizon();
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+enum class TypeId : uint8_t {
+    INT = 1,     // 32-bit signed
+    BIGINT = 2,  // 64-bit signed
+    DOUBLE = 3,
+    BOOL = 4,
+    VARCHAR = 5, // up to `length` bytes
+};
+
+const uint16_t DEFAULT_VARCHAR_LENGTH = 255; // columns declared without a type
+
+struct Column {
+    string name;
+    TypeId type = TypeId::VARCHAR;
+    uint16_t length = DEFAULT_VARCHAR_LENGTH; // VARCHAR only
+
+    bool is_fixed_width() const { return type != TypeId::VARCHAR; }
+    size_t fixed_width() const;
+    string type_name() const; // "INT", "VARCHAR(32)", ...
+
+    // "name TYPE" as written in CREATE TABLE; a bare name is a VARCHAR.
+    // Throws invalid_argument on an unknown type.
+    static Column parse_definition(const string& definition);
+    // Catalog form "name:TYPE".
+    string serialize() const;
+    static Column deserialize(const string& text);
+};
+
+// A typed, possibly NULL, column value. INT, BIGINT and BOOL share
+// `int_value`.
+struct Value {
+    TypeId type = TypeId::VARCHAR;
+    bool is_null = true;
+    int64_t int_value = 0;
+    double double_value = 0;
+    string string_value;
+
+    static Value make_null(TypeId type);
+    static Value make_int(int64_t v, TypeId type = TypeId::INT);
+    static Value make_double(double v);
+    static Value make_bool(bool v);
+    static Value make_string(const string& v);
+
+    // Converts a SQL literal to a value of the column's type. NULL (any
+    // case) is the null value and strings may be single-quoted. Throws
+    // invalid_argument when the literal does not fit the column.
+    static Value parse(const Column& column, const string& literal);
+
+    string to_string() const;
+
+    // Three-way comparison of two non-NULL values. Numeric types compare
+    // by value across INT, BIGINT and DOUBLE; other mixes compare as text.
+    int compare(const Value& other) const;
+
+    // Byte string whose lexicographic order matches the value order, used
+    // as the B+Tree key.
+    string index_key() const;
+};
@@ -1,17 +1,33 @@
 #include "./include/query/query_parser.h"
 #include "./include/disk_manager.h"
+#include "./include/buffer_pool_manager.h"
+#include "./include/log_manager.h"
+#include "./include/recovery_manager.h"
 #include "./include/record_manager.h"
 #include "./include/catalog_manager.h"
 #include "./include/table_manager.h"
 #include "./include/index_manager.h"
+#include "./include/column_store.h"
+#include "./include/garbage_collector.h"
+#include "./include/logger.h"
 
 int main() {
-    DiskManager disk_manager("database.db");
-    RecordManager record_manager(disk_manager);
+    Logger::instance().configure_from_environment();
 
-    IndexManager index_manager;
-    CatalogManager catalog_manager(record_manager, index_manager);
-    TableManager table_manager(catalog_manager, record_manager, index_manager);
+    DiskManager disk_manager("database.db", DiskManager::mode_from_environment());
+    LogManager log_manager("database.wal");
+    BufferPoolManager buffer_pool(disk_manager, log_manager, DEFAULT_POOL_SIZE);
+    RecoveryManager recovery_manager(buffer_pool, log_manager);
+    uint64_t log_start = log_manager.get_start_lsn();
+    bool recovered = recovery_manager.recover() > 0;
+    RecordManager record_manager(buffer_pool);
+
+    IndexManager index_manager(buffer_pool, record_manager.get_free_space_map(), recovered ? log_start : 0);
+    ColumnStore column_store(buffer_pool, record_manager.get_free_space_map());
+    CatalogManager catalog_manager(record_manager, index_manager, column_store);
+    TableManager table_manager(catalog_manager, record_manager, index_manager, column_store);
+    table_manager.rebuild_indexes();
+    GarbageCollector garbage_collector(table_manager);
 
     QueryParser parser(catalog_manager, table_manager, index_manager);
     parser.run_interactive();
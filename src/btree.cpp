@@ -1,45 +1,596 @@
 #include "../include/btree.h"
-#include<algorithm>
-#include<iostream>
+#include "../include/logger.h"
+#include "../include/header_page.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
-template<typename Key, typename Value>
-BPlusTree<Key, Value>::BPlusTree() : root(nullptr), leftmost_leaf(nullptr) {}
+namespace {
 
-template<typename Key, typename Value>
-BPlusTree<Key, Value> :: ~BPlusTree() {
-    delete root;
+const int NODE_HEADER_SIZE = 8;
+const size_t UNDERFLOW_SIZE = PAGE_SIZE / 4;
+// Largest entry with its offset: a node this far from the page size cannot
+// overflow (or underflow) from one change below it.
+const size_t MAX_ENTRY_SIZE = 2 + 2 + INDEX_MAX_KEY_SIZE + 8 + 4;
+
+// Read-only accessors used to walk a node in place without deserializing it.
+inline bool node_is_leaf(const char* page) { return page[0] != 0; }
+
+inline uint16_t node_count(const char* page) {
+    return *reinterpret_cast<const uint16_t*>(page + 2);
+}
+
+inline int32_t node_link(const char* page) {
+    return *reinterpret_cast<const int32_t*>(page + 4);
+}
+
+inline const char* entry_at(const char* page, int i) {
+    return page + reinterpret_cast<const uint16_t*>(page + NODE_HEADER_SIZE)[i];
+}
+
+inline string_view entry_key(const char* entry) {
+    uint16_t len;
+    memcpy(&len, entry, sizeof(len));
+    return string_view(entry + 2, len);
+}
+
+inline int64_t entry_value(const char* entry) {
+    int64_t value;
+    memcpy(&value, entry + 2 + entry_key(entry).size(), sizeof(value));
+    return value;
+}
+
+inline int32_t entry_child(const char* entry) {
+    int32_t child;
+    memcpy(&child, entry + 2 + entry_key(entry).size() + 8, sizeof(child));
+    return child;
+}
+
+} // namespace
+
+int BPlusTree::compare(string_view a_key, int64_t a_value, string_view b_key, int64_t b_value) {
+    int c = a_key.compare(b_key);
+    if (c != 0) return c;
+    if (a_value != b_value) return a_value < b_value ? -1 : 1;
+    return 0;
+}
+
+// ---------- Node (de)serialization ----------
+
+size_t BPlusTree::entry_size(const Node& node, const Entry& entry) {
+    return sizeof(uint16_t) /* offset */ + 2 + entry.key.size() + 8 + (node.is_leaf ? 0 : 4);
+}
+
+size_t BPlusTree::node_size(const Node& node) {
+    size_t size = NODE_HEADER_SIZE;
+    for (const auto& entry : node.entries) size += entry_size(node, entry);
+    return size;
+}
+
+BPlusTree::Node BPlusTree::read_node(const char* page) {
+    Node node;
+    node.is_leaf = node_is_leaf(page);
+    node.link = node_link(page);
+    uint16_t count = node_count(page);
+    node.entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const char* e = entry_at(page, i);
+        string_view key = entry_key(e);
+        node.entries.push_back({string(key), entry_value(e), node.is_leaf ? INVALID_PAGE_ID : entry_child(e)});
+    }
+    return node;
+}
+
+void BPlusTree::write_node(PageGuard& guard, const Node& node) {
+    if (node_size(node) > static_cast<size_t>(PAGE_SIZE)) {
+        throw logic_error("B+Tree node overflow on store");
+    }
+
+    char* page = guard.data();
+    memset(page, 0, PAGE_SIZE);
+    page[0] = node.is_leaf ? 1 : 0;
+    *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(node.entries.size());
+    *reinterpret_cast<int32_t*>(page + 4) = node.link;
+
+    uint16_t* offsets = reinterpret_cast<uint16_t*>(page + NODE_HEADER_SIZE);
+    size_t pos = NODE_HEADER_SIZE + node.entries.size() * sizeof(uint16_t);
+    for (size_t i = 0; i < node.entries.size(); ++i) {
+        const Entry& entry = node.entries[i];
+        offsets[i] = static_cast<uint16_t>(pos);
+        uint16_t len = static_cast<uint16_t>(entry.key.size());
+        memcpy(page + pos, &len, 2);
+        memcpy(page + pos + 2, entry.key.data(), len);
+        memcpy(page + pos + 2 + len, &entry.value, 8);
+        pos += 2 + len + 8;
+        if (!node.is_leaf) {
+            memcpy(page + pos, &entry.child, 4);
+            pos += 4;
+        }
+    }
+    guard.mark_dirty();
+}
+
+// New pages are not reachable from the tree yet, so nobody else latches them.
+int BPlusTree::allocate_node(const Node& node) {
+    PageGuard guard(buffer_pool, allocate_page());
+    write_node(guard, node);
+    return guard.page_id();
+}
+
+// ---------- Meta page ----------
+
+int BPlusTree::create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id) {
+    int meta_page_id = fsm.allocate_page(segment_id);
+    BPlusTree tree(bpm, fsm, segment_id, meta_page_id);
+    Node root{true, INVALID_PAGE_ID, {}};
+    int root_page_id = tree.allocate_node(root);
+    PageGuard meta(bpm, meta_page_id);
+    memset(meta.data(), 0, PAGE_SIZE);
+    set_root(meta, root_page_id);
+    tree.note_change(meta);
+    LOG_DEBUG(BTREE, "Created B+Tree with meta page " << meta_page_id << " in segment " << segment_id);
+    return meta_page_id;
+}
+
+BPlusTree::BPlusTree(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment, int meta_page)
+    : Index(bpm, fsm, segment, meta_page) {}
+
+int BPlusTree::get_root(const PageGuard& meta) {
+    return *reinterpret_cast<const int32_t*>(meta.data());
+}
+
+void BPlusTree::set_root(PageGuard& meta, int root_page_id) {
+    *reinterpret_cast<int32_t*>(meta.data()) = root_page_id;
+    meta.mark_dirty();
+}
+
+// ---------- Search ----------
+
+// Position of the child that may contain (key, value): the number of
+// separators that are <= (key, value).
+size_t BPlusTree::child_index(const Node& node, const string& key, int64_t value) {
+    size_t lo = 0, hi = node.entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (compare(node.entries[mid].key, node.entries[mid].value, key, value) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Descends with shared latches, taking each child's latch before letting
+// go of its parent, and returns the leaf still latched.
+PageGuard BPlusTree::find_leaf(const string& key, int64_t value) {
+    PageGuard guard(buffer_pool, meta_page_id, LatchMode::SHARED);
+    int page_id = get_root(guard);
+    while (true) {
+        PageGuard child(buffer_pool, page_id, LatchMode::SHARED);
+        guard = std::move(child);
+        const char* page = guard.data();
+        if (node_is_leaf(page)) return guard;
+
+        int lo = 0, hi = node_count(page);
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            const char* e = entry_at(page, mid);
+            if (compare(entry_key(e), entry_value(e), key, value) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        page_id = lo == 0 ? node_link(page) : entry_child(entry_at(page, lo - 1));
+    }
+}
+
+// Walks the leaf chain from the first entry >= (start_key, INT64_MIN),
+// collecting values until the key leaves the requested range. A null
+// `end_key` (with exact == false) runs to the end of the tree. Leaves are
+// latched left to right, the next before the current one is released.
+void BPlusTree::collect(const string& start_key, const string* end_key, bool exact, vector<int64_t>& out) {
+    PageGuard guard = find_leaf(start_key, INT64_MIN);
+    bool first_leaf = true;
+
+    while (true) {
+        const char* page = guard.data();
+        int count = node_count(page);
+
+        int pos = 0;
+        if (first_leaf) {
+            int lo = 0, hi = count;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                const char* e = entry_at(page, mid);
+                if (compare(entry_key(e), entry_value(e), start_key, INT64_MIN) < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            pos = lo;
+            first_leaf = false;
+        }
+
+        for (int i = pos; i < count; ++i) {
+            const char* e = entry_at(page, i);
+            string_view key = entry_key(e);
+            if (exact ? key != start_key : end_key && key.compare(*end_key) > 0) return;
+            out.push_back(entry_value(e));
+        }
+        int next_page_id = node_link(page);
+        if (next_page_id == INVALID_PAGE_ID) return;
+        PageGuard next(buffer_pool, next_page_id, LatchMode::SHARED);
+        guard = std::move(next);
+    }
+}
+
+vector<int64_t> BPlusTree::search(const string& key) {
+    vector<int64_t> result;
+    collect(truncate_key(key), nullptr, true, result);
+    return result;
+}
+
+vector<int64_t> BPlusTree::range_search(const string& start_key, const string& end_key) {
+    vector<int64_t> result;
+    if (start_key.compare(end_key) > 0) return result;
+    collect(truncate_key(start_key), &end_key, false, result);
+    return result;
+}
+
+vector<int64_t> BPlusTree::range_search_from(const string& start_key) {
+    vector<int64_t> result;
+    collect(truncate_key(start_key), nullptr, false, result);
+    return result;
+}
+
+// ---------- Insert ----------
+
+// Splits roughly by bytes so both halves fit even with variable-size keys.
+size_t BPlusTree::split_point(const Node& node) {
+    size_t total = node_size(node) - NODE_HEADER_SIZE;
+    size_t acc = 0;
+    size_t i = 0;
+    for (; i < node.entries.size(); ++i) {
+        acc += entry_size(node, node.entries[i]);
+        if (acc * 2 >= total) break;
+    }
+    return std::clamp<size_t>(i, 1, node.entries.size() - 1);
+}
+
+// Writes the node back, first moving its upper half into a new right
+// sibling if it no longer fits in a page.
+BPlusTree::SplitResult BPlusTree::store_or_split(PageGuard& guard, Node& node) {
+    if (node_size(node) <= static_cast<size_t>(PAGE_SIZE)) {
+        write_node(guard, node);
+        return {false, {}};
+    }
+
+    size_t mid = split_point(node);
+    Node right{node.is_leaf, INVALID_PAGE_ID, {}};
+    Entry separator;
+    if (node.is_leaf) {
+        right.entries.assign(node.entries.begin() + mid, node.entries.end());
+        right.link = node.link;
+        separator = {right.entries.front().key, right.entries.front().value, INVALID_PAGE_ID};
+    } else {
+        // The middle separator moves up; its right child becomes child0 of the new node.
+        separator = node.entries[mid];
+        right.link = separator.child;
+        right.entries.assign(node.entries.begin() + mid + 1, node.entries.end());
+    }
+    node.entries.resize(mid);
+
+    int right_page_id = allocate_node(right);
+    if (node.is_leaf) node.link = right_page_id;
+    write_node(guard, node);
+
+    separator.child = right_page_id;
+    LOG_TRACE(BTREE, "Split page " << guard.page_id() << " into " << right_page_id);
+    return {true, separator};
+}
+
+// A node is safe for insert if taking one more separator cannot split it.
+bool BPlusTree::insert_safe(const Node& node) {
+    return node_size(node) + MAX_ENTRY_SIZE <= static_cast<size_t>(PAGE_SIZE);
+}
+
+// Losing one entry must not underflow the node, and a longer separator
+// from redistribution below must not split it. The root only changes the
+// meta page when it splits or an internal root loses its last separator.
+bool BPlusTree::remove_safe(const Node& node, bool is_root) {
+    if (is_root) return node.is_leaf || (node.entries.size() >= 2 && insert_safe(node));
+    return node_size(node) >= UNDERFLOW_SIZE + MAX_ENTRY_SIZE && insert_safe(node);
+}
+
+// Latch crabbing for writers: descends with exclusive latches and drops the
+// meta page and every ancestor as soon as the current node is safe, so
+// only the part of the path a split or merge can reach stays latched.
+void BPlusTree::latch_path(const string& key, int64_t value, bool for_insert, PageGuard& meta, vector<PathNode>& path) {
+    meta = PageGuard(buffer_pool, meta_page_id);
+    note_change(meta);
+    int page_id = get_root(meta);
+    while (true) {
+        PageGuard guard(buffer_pool, page_id);
+        Node node = read_node(guard.data());
+        if (for_insert ? insert_safe(node) : remove_safe(node, meta.valid() && path.empty())) {
+            path.clear();
+            meta.release();
+        }
+        size_t pos = node.is_leaf ? 0 : child_index(node, key, value);
+        if (!node.is_leaf) page_id = pos == 0 ? node.link : node.entries[pos - 1].child;
+        bool is_leaf = node.is_leaf;
+        path.push_back({std::move(guard), std::move(node), pos});
+        if (is_leaf) return;
+    }
+}
+
+void BPlusTree::insert(const string& key, int64_t value) {
+    Entry entry{truncate_key(key), value, INVALID_PAGE_ID};
+    PageGuard meta;
+    vector<PathNode> path;
+    latch_path(entry.key, entry.value, true, meta, path);
+
+    Node& leaf = path.back().node;
+    auto it = lower_bound(leaf.entries.begin(), leaf.entries.end(), entry, [](const Entry& a, const Entry& b) {
+        return compare(a.key, a.value, b.key, b.value) < 0;
+    });
+    if (it != leaf.entries.end() && compare(it->key, it->value, entry.key, entry.value) == 0) {
+        return; // already present
+    }
+    leaf.entries.insert(it, entry);
+
+    SplitResult split{false, {}};
+    for (size_t i = path.size(); i-- > 0;) {
+        PathNode& level = path[i];
+        if (i + 1 < path.size()) {
+            if (!split.split) return;
+            level.node.entries.insert(level.node.entries.begin() + level.pos, split.separator);
+        }
+        split = store_or_split(level.guard, level.node);
+    }
+    if (split.split) {
+        // Only an unsafe root splits, and then the meta page is still held.
+        Node new_root{false, path.front().guard.page_id(), {split.separator}};
+        set_root(meta, allocate_node(new_root));
+        LOG_DEBUG(BTREE, "Root split. Tree grew by one level.");
+    }
 }
 
-template<typename Key, typename Value>
-typename BPlusTree<Key, Value>::LeafNode* BPlusTree<Key, Value> ::find_leaf(const Key& key){
-    if(!root) return nullptr;
+// Like store_or_split, but cuts the node into as many page-filling pieces
+// as it needs. Returns the separators of the new right siblings in order.
+vector<BPlusTree::Entry> BPlusTree::store_or_split_all(PageGuard& guard, Node& node) {
+    vector<Entry> separators;
+    if (node_size(node) <= static_cast<size_t>(PAGE_SIZE)) {
+        write_node(guard, node);
+        return separators;
+    }
 
-    Node* current = root;
-    while(!current->is_leaf){
-        InternalNode* internal = static_cast<InternalNode*>(current);
-        int i = 0;
-        while(i < current->keys.size() && key >= current->keys[i]) {
-            i++;
+    vector<Node> pieces;
+    Node current{node.is_leaf, node.link, {}};
+    size_t size = NODE_HEADER_SIZE;
+    for (Entry& entry : node.entries) {
+        size_t needed = entry_size(node, entry);
+        if (size + needed > static_cast<size_t>(PAGE_SIZE) && !current.entries.empty()) {
+            pieces.push_back(std::move(current));
+            if (node.is_leaf) {
+                separators.push_back({entry.key, entry.value, INVALID_PAGE_ID});
+                current = Node{true, INVALID_PAGE_ID, {}};
+                size = NODE_HEADER_SIZE;
+            } else {
+                // The entry moves up; its child becomes child0 of the next piece.
+                current = Node{false, entry.child, {}};
+                size = NODE_HEADER_SIZE;
+                separators.push_back(std::move(entry));
+                continue;
+            }
         }
-        current = internal->children[i];
+        size += needed;
+        current.entries.push_back(std::move(entry));
+    }
+    pieces.push_back(std::move(current));
+
+    // Allocate front to back so a bulk-built leaf chain is laid out in
+    // ascending page order.
+    vector<int> page_ids{guard.page_id()};
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        int new_page_id = allocate_page();
+        page_ids.push_back(new_page_id);
+        separators[i - 1].child = new_page_id;
+    }
+    if (node.is_leaf) {
+        pieces.back().link = node.link;
+        for (size_t i = 0; i + 1 < pieces.size(); ++i) pieces[i].link = page_ids[i + 1];
+    }
+    write_node(guard, pieces[0]);
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        PageGuard piece(buffer_pool, page_ids[i]);
+        write_node(piece, pieces[i]);
+    }
+
+    LOG_TRACE(BTREE, "Split page " << guard.page_id() << " into " << pieces.size() << " pages");
+    return separators;
+}
+
+// [first, last) is sorted and lies entirely under page_id. Each child
+// receives its sub-range in a single call; the node stays latched while
+// its children are filled.
+vector<BPlusTree::Entry> BPlusTree::insert_sorted(int page_id, const Entry* first, const Entry* last) {
+    PageGuard guard(buffer_pool, page_id);
+    Node node = read_node(guard.data());
+    auto less = [](const Entry& a, const Entry& b) { return compare(a.key, a.value, b.key, b.value) < 0; };
+
+    vector<Entry> entries;
+    entries.reserve(node.entries.size() + (node.is_leaf ? last - first : 0));
+    if (node.is_leaf) {
+        auto it = node.entries.begin();
+        for (const Entry* e = first; e != last; ++e) {
+            while (it != node.entries.end() && less(*it, *e)) entries.push_back(std::move(*it++));
+            if (it != node.entries.end() && !less(*e, *it)) continue; // already present
+            entries.push_back(*e);
+        }
+        while (it != node.entries.end()) entries.push_back(std::move(*it++));
+    } else {
+        const Entry* begin = first;
+        for (size_t i = 0; i <= node.entries.size(); ++i) {
+            if (i > 0) entries.push_back(node.entries[i - 1]);
+            const Entry* end = i < node.entries.size() ? lower_bound(begin, last, node.entries[i], less) : last;
+            if (begin != end) {
+                int child = i == 0 ? node.link : node.entries[i - 1].child;
+                vector<Entry> child_separators = insert_sorted(child, begin, end);
+                entries.insert(entries.end(), child_separators.begin(), child_separators.end());
+            }
+            begin = end;
+        }
+    }
+    node.entries = std::move(entries);
+    return store_or_split_all(guard, node);
+}
+
+void BPlusTree::bulk_insert(const vector<pair<string, int64_t>>& pairs) {
+    vector<Entry> entries;
+    entries.reserve(pairs.size());
+    for (const auto& [key, value] : pairs) entries.push_back({truncate_key(key), value, INVALID_PAGE_ID});
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return compare(a.key, a.value, b.key, b.value) < 0;
+    });
+    entries.erase(unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return compare(a.key, a.value, b.key, b.value) == 0;
+    }), entries.end());
+    if (entries.empty()) return;
+
+    // The meta page is held throughout, so no reader enters the tree while
+    // it is rebuilt.
+    PageGuard meta(buffer_pool, meta_page_id);
+    note_change(meta);
+    int root = get_root(meta);
+    int old_root = root;
+    vector<Entry> separators = insert_sorted(root, entries.data(), entries.data() + entries.size());
+    while (!separators.empty()) {
+        Node new_root{false, root, std::move(separators)};
+        root = allocate_page();
+        PageGuard guard(buffer_pool, root);
+        separators = store_or_split_all(guard, new_root);
+    }
+    if (root != old_root) {
+        set_root(meta, root);
+        LOG_DEBUG(BTREE, "Bulk insert of " << entries.size() << " entries grew the tree to root page " << root);
     }
-    return static_cast<LeafNode*>(current);
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::insert(const Key& key, const Value& value) {
-    if(!root) {
-        root = new LeafNode();
-        leftmost_leaf = static_cast<LeafNode*>(root);
+// ---------- Remove ----------
+
+// Fixes an underfull child by merging it with a sibling when both fit in
+// one page, otherwise by redistributing entries between the two. The
+// sibling is latched left to right like the leaf chain: a child that is
+// the right node lets go of its latch while the left one is taken.
+void BPlusTree::rebalance_child(PathNode& parent, PathNode& child) {
+    Node& parent_node = parent.node;
+    if (parent_node.entries.empty()) return;
+
+    size_t left_pos = parent.pos > 0 ? parent.pos - 1 : 0;
+    Entry& separator = parent_node.entries[left_pos];
+    int left_id = left_pos == 0 ? parent_node.link : parent_node.entries[left_pos - 1].child;
+    int right_id = separator.child;
+
+    PageGuard left_guard;
+    PageGuard right_guard;
+    Node left;
+    Node right;
+    if (parent.pos == 0) {
+        right_guard = PageGuard(buffer_pool, right_id);
+        left_guard = std::move(child.guard);
+        left = std::move(child.node);
+        right = read_node(right_guard.data());
+    } else {
+        child.guard.release();
+        left_guard = PageGuard(buffer_pool, left_id);
+        right_guard = PageGuard(buffer_pool, right_id);
+        left = read_node(left_guard.data());
+        right = std::move(child.node);
+    }
+
+    Node merged{left.is_leaf, left.link, left.entries};
+    if (left.is_leaf) {
+        merged.entries.insert(merged.entries.end(), right.entries.begin(), right.entries.end());
+    } else {
+        // Pull the separator down between the two halves.
+        merged.entries.push_back({separator.key, separator.value, right.link});
+        merged.entries.insert(merged.entries.end(), right.entries.begin(), right.entries.end());
     }
 
-    LeafNode* leaf = find_leaf(key);
-    if(!leaf) {
-        leaf = static_cast<LeafNode*>(root);
+    if (node_size(merged) <= static_cast<size_t>(PAGE_SIZE)) {
+        if (merged.is_leaf) merged.link = right.link;
+        write_node(left_guard, merged);
+        parent_node.entries.erase(parent_node.entries.begin() + left_pos);
+        // Nothing points at the right page any more, and the latches held
+        // on the parent and on the left page keep readers from reaching it.
+        right_guard.release();
+        free_space_map.release_page(right_id);
+        LOG_TRACE(BTREE, "Merged page " << right_id << " into " << left_id);
+        return;
     }
 
-    insert_in_leaf(leaf, key, value);
+    size_t mid = split_point(merged);
+    Node new_left{merged.is_leaf, merged.link, {}};
+    Node new_right{merged.is_leaf, INVALID_PAGE_ID, {}};
+    if (merged.is_leaf) {
+        new_left.entries.assign(merged.entries.begin(), merged.entries.begin() + mid);
+        new_left.link = right_id;
+        new_right.entries.assign(merged.entries.begin() + mid, merged.entries.end());
+        new_right.link = right.link;
+        separator.key = new_right.entries.front().key;
+        separator.value = new_right.entries.front().value;
+    } else {
+        new_left.entries.assign(merged.entries.begin(), merged.entries.begin() + mid);
+        new_right.link = merged.entries[mid].child;
+        new_right.entries.assign(merged.entries.begin() + mid + 1, merged.entries.end());
+        separator.key = merged.entries[mid].key;
+        separator.value = merged.entries[mid].value;
+    }
+    write_node(left_guard, new_left);
+    write_node(right_guard, new_right);
+    LOG_TRACE(BTREE, "Redistributed entries between pages " << left_id << " and " << right_id);
 }
 
-// template<typename Key, typename Value>
-// void BPlusTree<Key, Value>::insert_in_leaf(LeafNode* leaf, const Key& key, const Value& value)
\ No newline at end of file
+bool BPlusTree::remove(const string& key, int64_t value) {
+    string truncated = truncate_key(key);
+    PageGuard meta;
+    vector<PathNode> path;
+    latch_path(truncated, value, false, meta, path);
+
+    Node& leaf = path.back().node;
+    auto it = find_if(leaf.entries.begin(), leaf.entries.end(), [&](const Entry& e) {
+        return compare(e.key, e.value, truncated, value) == 0;
+    });
+    if (it == leaf.entries.end()) return false;
+    leaf.entries.erase(it);
+
+    SplitResult split{false, {}};
+    for (size_t i = path.size(); i-- > 0;) {
+        PathNode& level = path[i];
+        if (i + 1 < path.size()) {
+            PathNode& child = path[i + 1];
+            if (split.split) {
+                level.node.entries.insert(level.node.entries.begin() + level.pos, split.separator);
+            } else {
+                if (node_size(child.node) >= UNDERFLOW_SIZE && !child.node.entries.empty()) return true;
+                rebalance_child(level, child);
+            }
+            child.guard.release();
+        }
+        // A longer separator pulled up by redistribution can overflow this
+        // node, in which case it splits exactly as on insert.
+        split = store_or_split(level.guard, level.node);
+    }
+    if (!meta.valid()) return true;
+
+    PathNode& root = path.front();
+    if (split.split) {
+        Node new_root{false, root.guard.page_id(), {split.separator}};
+        set_root(meta, allocate_node(new_root));
+    } else if (!root.node.is_leaf && root.node.entries.empty()) {
+        // Collapse an internal root left with a single child. Readers hold
+        // the meta page while they latch the root, so none is left on it.
+        int old_root = root.guard.page_id();
+        set_root(meta, root.node.link);
+        root.guard.release();
+        free_space_map.release_page(old_root);
+        LOG_DEBUG(BTREE, "Root collapsed. Tree shrank by one level.");
+    }
+    return true;
+}
@@ -0,0 +1,236 @@
+#include "../include/buffer_pool_manager.h"
+#include "../include/logger.h"
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+BufferPoolManager::BufferPoolManager(DiskManager& dm, LogManager& lm, size_t pool_size)
+    : disk(dm), log(lm), frames(pool_size), clock_hand(0), hits(0), misses(0) {
+    if (pool_size == 0) {
+        throw invalid_argument("Buffer pool size must be positive");
+    }
+    free_frames.reserve(pool_size);
+    for (int i = static_cast<int>(pool_size) - 1; i >= 0; --i) {
+        free_frames.push_back(i);
+    }
+    if (disk.get_mode() == DiskMode::PREAD) {
+        read_ahead = make_unique<ReadAhead>(disk);
+    }
+    LOG_DEBUG(BUFFER_POOL, "BufferPoolManager initialized with " << pool_size << " frames.");
+}
+
+BufferPoolManager::~BufferPoolManager() {
+    checkpoint();
+    LOG_DEBUG(BUFFER_POOL, "BufferPoolManager destroyed. hits=" << hits << ", misses=" << misses);
+}
+
+bool BufferPoolManager::write_back(Page& frame) {
+    if (!frame.is_dirty) return true;
+    // Write-ahead rule: the log records behind this page go to disk first.
+    log.flush(frame.lsn);
+    if (!disk.write_page(frame.page_id, frame.data.data())) {
+        LOG_ERROR(BUFFER_POOL, "Failed to write back page " << frame.page_id);
+        return false;
+    }
+    frame.is_dirty = false;
+    return true;
+}
+
+// CLOCK: sweep the frames, giving every referenced page a second chance.
+// Two full sweeps are enough to clear all reference bits; if nothing is
+// found by then, every frame is pinned.
+int BufferPoolManager::find_victim_frame() {
+    if (!free_frames.empty()) {
+        int frame_id = free_frames.back();
+        free_frames.pop_back();
+        return frame_id;
+    }
+
+    for (size_t scanned = 0; scanned < 2 * frames.size(); ++scanned) {
+        Page& frame = frames[clock_hand];
+        int frame_id = static_cast<int>(clock_hand);
+        clock_hand = (clock_hand + 1) % frames.size();
+
+        if (frame.pin_count > 0) continue;
+        if (frame.ref_bit) {
+            frame.ref_bit = false;
+            continue;
+        }
+
+        if (!write_back(frame)) {
+            throw runtime_error("Failed to evict dirty page");
+        }
+        LOG_TRACE(BUFFER_POOL, "Evicting page " << frame.page_id << " from frame " << frame_id);
+        page_table.erase(frame.page_id);
+        frame.page_id = -1;
+        return frame_id;
+    }
+
+    LOG_ERROR(BUFFER_POOL, "All " << frames.size() << " frames are pinned.");
+    throw runtime_error("Buffer pool exhausted");
+}
+
+Page* BufferPoolManager::fetch_page(int page_id) {
+    unique_lock<mutex> lock(latch);
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+        int frame_id = it->second;
+        Page& frame = frames[frame_id];
+        frame.pin_count++;
+        frame.ref_bit = true;
+        hits++;
+        load_done.wait(lock, [&frame] { return !frame.loading; });
+        if (frame.load_failed) {
+            drop_failed_pin(frame_id);
+            throw runtime_error("Failed to read page " + to_string(page_id));
+        }
+        return &frame;
+    }
+
+    if (page_id < 0 || page_id >= disk.get_num_pages()) {
+        throw runtime_error("Page " + to_string(page_id) + " does not exist");
+    }
+
+    misses++;
+    int frame_id = find_victim_frame();
+    Page& frame = frames[frame_id];
+    frame.page_id = page_id;
+    frame.pin_count = 1;
+    frame.is_dirty = false;
+    frame.ref_bit = true;
+    frame.loading = true;
+    frame.load_failed = false;
+    frame.lsn = 0;
+    page_table[page_id] = frame_id;
+
+    lock.unlock();
+    bool ok = (read_ahead && read_ahead->take(page_id, frame.data.data())) || disk.read_page(page_id, frame.data.data());
+    lock.lock();
+
+    frame.loading = false;
+    load_done.notify_all();
+    if (!ok) {
+        frame.load_failed = true;
+        page_table.erase(page_id);
+        drop_failed_pin(frame_id);
+        throw runtime_error("Failed to read page " + to_string(page_id));
+    }
+    return &frame;
+}
+
+// The frame of a failed read is out of the page table; it is freed by the
+// last thread that had pinned it.
+void BufferPoolManager::drop_failed_pin(int frame_id) {
+    Page& frame = frames[frame_id];
+    if (--frame.pin_count > 0) return;
+    frame.page_id = -1;
+    frame.load_failed = false;
+    free_frames.push_back(frame_id);
+}
+
+Page* BufferPoolManager::new_page(int& page_id) {
+    lock_guard<mutex> lock(latch);
+    int frame_id = find_victim_frame();
+
+    page_id = disk.allocate_page();
+    if (page_id < 0) {
+        free_frames.push_back(frame_id);
+        throw runtime_error("Failed to allocate page");
+    }
+
+    Page& frame = frames[frame_id];
+    memset(frame.data.data(), 0, PAGE_SIZE);
+    frame.page_id = page_id;
+    frame.pin_count = 1;
+    frame.is_dirty = false;
+    frame.ref_bit = true;
+    frame.loading = false;
+    frame.load_failed = false;
+    frame.lsn = 0;
+    page_table[page_id] = frame_id;
+
+    LOG_TRACE(BUFFER_POOL, "Allocated page " << page_id << " in frame " << frame_id);
+    return &frame;
+}
+
+int BufferPoolManager::append_pages(const char* data, int count) {
+    lock_guard<mutex> lock(latch);
+    int first_page_id = disk.append_pages(data, count);
+    if (first_page_id < 0) {
+        throw runtime_error("Failed to append " + to_string(count) + " pages");
+    }
+    LOG_TRACE(BUFFER_POOL, "Appended " << count << " pages from page " << first_page_id);
+    return first_page_id;
+}
+
+void BufferPoolManager::sync_pages() {
+    disk.flush();
+}
+
+void BufferPoolManager::prefetch(int page_id) {
+    lock_guard<mutex> lock(latch);
+    if (!read_ahead || page_table.count(page_id)) return;
+    if (page_id < 0 || page_id >= disk.get_num_pages()) return;
+    read_ahead->request(page_id);
+}
+
+bool BufferPoolManager::unpin_page(int page_id, bool is_dirty) {
+    lock_guard<mutex> lock(latch);
+    auto it = page_table.find(page_id);
+    if (it == page_table.end()) {
+        LOG_ERROR(BUFFER_POOL, "Unpin of page " << page_id << " that is not resident.");
+        return false;
+    }
+    Page& frame = frames[it->second];
+    if (frame.pin_count <= 0) {
+        LOG_ERROR(BUFFER_POOL, "Unpin of page " << page_id << " with pin_count 0.");
+        return false;
+    }
+    frame.pin_count--;
+    if (is_dirty) frame.is_dirty = true;
+    return true;
+}
+
+bool BufferPoolManager::flush_page(int page_id) {
+    lock_guard<mutex> lock(latch);
+    auto it = page_table.find(page_id);
+    if (it == page_table.end()) return false;
+    return write_back(frames[it->second]);
+}
+
+bool BufferPoolManager::flush_all_pages() {
+    lock_guard<mutex> lock(latch);
+    bool ok = true;
+    for (auto& frame : frames) {
+        if (frame.page_id >= 0) {
+            ok = write_back(frame) && ok;
+        }
+    }
+    disk.flush();
+    return ok;
+}
+
+void BufferPoolManager::checkpoint() {
+    if (!flush_all_pages()) {
+        LOG_ERROR(BUFFER_POOL, "Checkpoint skipped: some pages could not be written.");
+        return;
+    }
+    log.truncate();
+    LOG_DEBUG(BUFFER_POOL, "Checkpoint complete.");
+}
+
+int BufferPoolManager::get_num_pages() {
+    return disk.get_num_pages();
+}
+
+uint64_t PageGuard::log_write(size_t offset, size_t len) {
+    LogRecord record;
+    record.type = LogRecordType::PAGE_WRITE;
+    record.page_id = page->page_id;
+    record.offset = static_cast<uint16_t>(offset);
+    record.data.assign(data() + offset, data() + offset + len);
+    uint64_t lsn = bpm->get_log_manager().append(record);
+    set_lsn(lsn);
+    return lsn;
+}
@@ -1,28 +1,24 @@
 #include "../include/catalog_manager.h"
-#include <iostream>
+#include "../include/logger.h"
 #include <sstream>
 #include "../include/record_iterator.h"
-#include "../include/table_manager.h"
 #include <algorithm>
+#include <iterator>
 
-// ANSI color codes for debug output
-#define COLOR_RESET   "\033[0m"
-#define COLOR_YELLOW  "\033[33m"
-#define COLOR_CYAN    "\033[36m"
-
-#define DEBUG_CATALOG(msg) \
-    std::cout << COLOR_YELLOW << "[DEBUG]" << COLOR_CYAN << "[CATALOG_MANAGER] " << COLOR_RESET << msg << std::endl;
+#define DEBUG_CATALOG(msg) LOG_DEBUG(CATALOG, msg)
+#define TRACE_CATALOG(msg) LOG_TRACE(CATALOG, msg)
 
 // ---------- TableSchema Methods ----------
 
 std::string TableSchema::serialize() const {
     std::ostringstream oss;
-    oss << "SCHEMA|" << table_name << "|";
+    oss << "SCHEMA|" << table_name << "|" << segment_id << "|";
     for (size_t i = 0; i < columns.size(); ++i) {
-        oss << columns[i];
+        oss << columns[i].serialize();
         if (i + 1 < columns.size()) oss << ",";
     }
-    DEBUG_CATALOG("Serialized schema for table '" << table_name << "': " << oss.str());
+    if (storage == TableStorage::COLUMN) oss << "|COLUMN:" << column_meta_page;
+    TRACE_CATALOG("Serialized schema for table '" << table_name << "': " << oss.str());
     return oss.str();
 }
 
@@ -30,72 +26,203 @@ std::string TableSchema::serialize() const {
 TableSchema TableSchema::deserialize(const std::string& record_str) {
     const std::string prefix = "SCHEMA|";
     if (record_str.rfind(prefix, 0) != 0) { // Not a schema record
-        DEBUG_CATALOG("Skipped non-schema record: '" << record_str << "'");
+        TRACE_CATALOG("Skipped non-schema record: '" << record_str << "'");
         return TableSchema{};
     }
-    size_t sep = record_str.find('|', prefix.size());
+    size_t name_end = record_str.find('|', prefix.size());
+    size_t sep = name_end == std::string::npos ? std::string::npos : record_str.find('|', name_end + 1);
     if (sep == std::string::npos) {
         DEBUG_CATALOG("Failed to deserialize: missing separator in '" << record_str << "'");
         return TableSchema{};
     }
 
     TableSchema schema;
-    schema.table_name = record_str.substr(prefix.size(), sep - prefix.size());
-    std::string cols = record_str.substr(sep + 1);
+    schema.table_name = record_str.substr(prefix.size(), name_end - prefix.size());
+    schema.segment_id = std::stoi(record_str.substr(name_end + 1, sep - name_end - 1));
+    size_t cols_end = record_str.find('|', sep + 1);
+    std::string cols = record_str.substr(sep + 1, cols_end == std::string::npos ? std::string::npos : cols_end - sep - 1);
+    if (cols_end != std::string::npos) {
+        const std::string column_prefix = "COLUMN:";
+        std::string storage = record_str.substr(cols_end + 1);
+        if (storage.rfind(column_prefix, 0) != 0) {
+            DEBUG_CATALOG("Failed to deserialize: unknown storage in '" << record_str << "'");
+            return TableSchema{};
+        }
+        schema.storage = TableStorage::COLUMN;
+        schema.column_meta_page = std::stoi(storage.substr(column_prefix.size()));
+    }
 
     size_t pos = 0, prev = 0;
     while ((pos = cols.find(',', prev)) != std::string::npos) {
-        schema.columns.push_back(cols.substr(prev, pos - prev));
+        schema.columns.push_back(Column::deserialize(cols.substr(prev, pos - prev)));
         prev = pos + 1;
     }
     if (prev < cols.size())
-        schema.columns.push_back(cols.substr(prev));
+        schema.columns.push_back(Column::deserialize(cols.substr(prev)));
 
-    DEBUG_CATALOG("Deserialized schema for table '" << schema.table_name << "' with columns: " << cols);
+    TRACE_CATALOG("Deserialized schema for table '" << schema.table_name << "' with columns: " << cols);
     return schema;
 }
 
+int TableSchema::column_index(const std::string& column_name) const {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == column_name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// ---------- IndexInfo Methods ----------
+
+std::string IndexInfo::serialize() const {
+    std::ostringstream oss;
+    oss << "INDEX|" << table_name << "|" << column_name << "|" << meta_page_id << "|" << segment_id << "|"
+        << index_name << "|" << (unique ? 1 : 0) << "|" << index_type_to_string(type);
+    return oss.str();
+}
+
+IndexInfo IndexInfo::deserialize(const std::string& record_str) {
+    const std::string prefix = "INDEX|";
+    if (record_str.rfind(prefix, 0) != 0) return IndexInfo{};
+
+    size_t table_end = record_str.find('|', prefix.size());
+    size_t column_end = table_end == std::string::npos ? std::string::npos : record_str.find('|', table_end + 1);
+    size_t page_end = column_end == std::string::npos ? std::string::npos : record_str.find('|', column_end + 1);
+    size_t segment_end = page_end == std::string::npos ? std::string::npos : record_str.find('|', page_end + 1);
+    size_t name_end = segment_end == std::string::npos ? std::string::npos : record_str.find('|', segment_end + 1);
+    if (name_end == std::string::npos) {
+        DEBUG_CATALOG("Failed to deserialize index entry '" << record_str << "'");
+        return IndexInfo{};
+    }
+
+    IndexInfo info;
+    info.table_name = record_str.substr(prefix.size(), table_end - prefix.size());
+    info.column_name = record_str.substr(table_end + 1, column_end - table_end - 1);
+    info.meta_page_id = std::stoi(record_str.substr(column_end + 1, page_end - column_end - 1));
+    info.segment_id = std::stoi(record_str.substr(page_end + 1, segment_end - page_end - 1));
+    info.index_name = record_str.substr(segment_end + 1, name_end - segment_end - 1);
+    size_t unique_end = record_str.find('|', name_end + 1);
+    info.unique = record_str.substr(name_end + 1, unique_end == std::string::npos ? std::string::npos : unique_end - name_end - 1) == "1";
+    if (unique_end != std::string::npos) info.type = string_to_index_type(record_str.substr(unique_end + 1));
+    return info;
+}
+
 // ---------- CatalogManager Methods ----------
 
-CatalogManager::CatalogManager(RecordManager& rm, IndexManager& im)
-    : record_manager(rm), index_manager(im) {
+CatalogManager::CatalogManager(RecordManager& rm, IndexManager& im, ColumnStore& cs)
+    : record_manager(rm), index_manager(im), column_store(cs) {
     DEBUG_CATALOG("Initializing CatalogManager");
     load_catalog();
 }
 
 void CatalogManager::load_catalog() {
     DEBUG_CATALOG("Loading catalog from disk");
-    RecordIterator iter(record_manager.get_disk());
+    RecordIterator iter(record_manager, CATALOG_SEGMENT);
     int count = 0;
+    int index_count = 0;
 
     while (iter.has_next()) {
         try {
             auto [rec, page_id, slot_id] = iter.next_with_location();
-            TableSchema schema = TableSchema::deserialize(rec.to_string());
+            std::string rec_str = rec.to_string();
+            TableSchema schema = TableSchema::deserialize(rec_str);
             if (!schema.table_name.empty()) {
                 schema_cache[schema.table_name] = schema;
                 ++count;
+                continue;
+            }
+            IndexInfo info = IndexInfo::deserialize(rec_str);
+            if (!info.table_name.empty() && index_manager.open_index(info.table_name, info.column_name, info.meta_page_id, info.segment_id, info.type)) {
+                index_cache[info.index_name] = info;
+                ++index_count;
             }
         } catch (const std::exception& e) {
             DEBUG_CATALOG("Error loading schema: " << e.what());
         }
     }
 
-    DEBUG_CATALOG("Loaded " << count << " table schemas into cache");
+    DEBUG_CATALOG("Loaded " << count << " table schemas and " << index_count << " indexes into cache");
+}
+
+bool CatalogManager::add_index(IndexInfo info, const std::vector<std::pair<std::string, int64_t>>& entries) {
+    if (!index_manager.create_index(info.table_name, info.column_name, entries, info.type)) return false;
+    info.meta_page_id = index_manager.get_index_page(info.table_name, info.column_name);
+    info.segment_id = index_manager.get_index_segment(info.table_name, info.column_name);
+    record_manager.insert_record(CATALOG_SEGMENT, Record(info.serialize()));
+    {
+        std::unique_lock<std::shared_mutex> lock(cache_latch);
+        index_cache[info.index_name] = info;
+    }
+    DEBUG_CATALOG("Recorded index '" << info.index_name << "' on '" << info.table_name << "." << info.column_name
+                  << "' at meta page " << info.meta_page_id << " in segment " << info.segment_id);
+    return true;
+}
+
+bool CatalogManager::create_index(const IndexInfo& info, const std::vector<std::pair<std::string, int64_t>>& entries) {
+    DEBUG_CATALOG("Attempting to create index '" << info.index_name << "'");
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_latch);
+        if (index_cache.count(info.index_name)) {
+            DEBUG_CATALOG("Index '" << info.index_name << "' already exists");
+            return false;
+        }
+    }
+    if (!add_index(info, entries)) return false;
+    record_manager.commit();
+    return true;
+}
+
+bool CatalogManager::drop_index(const std::string& index_name) {
+    DEBUG_CATALOG("Attempting to drop index '" << index_name << "'");
+    IndexInfo info;
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_latch);
+        auto it = index_cache.find(index_name);
+        if (it == index_cache.end()) {
+            DEBUG_CATALOG("Index '" << index_name << "' does not exist");
+            return false;
+        }
+        info = it->second;
+    }
+
+    const std::string serialized = info.serialize();
+    RecordIterator iterator(record_manager, CATALOG_SEGMENT);
+    while (iterator.has_next()) {
+        auto [rec, page_id, slot_id] = iterator.next_with_location();
+        if (rec.to_string() == serialized) {
+            record_manager.delete_record(RecordID(page_id, slot_id).encode());
+            break;
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(cache_latch);
+        index_cache.erase(index_name);
+    }
+    index_manager.drop_index(info.table_name, info.column_name);
+    record_manager.commit();
+    DEBUG_CATALOG("Index '" << index_name << "' dropped");
+    return true;
 }
 
-bool CatalogManager::create_table(const std::string& table_name, const std::vector<std::string>& columns) {
+bool CatalogManager::create_table(const std::string& table_name, const std::vector<Column>& columns, TableStorage storage) {
     DEBUG_CATALOG("Attempting to create table '" << table_name << "'");
-    if (schema_cache.count(table_name)) {
+    if (has_table(table_name)) {
         DEBUG_CATALOG("Table '" << table_name << "' already exists");
         return false;
     }
 
-    TableSchema schema{table_name, columns};
+    TableSchema schema{table_name, record_manager.create_segment(), columns};
+    if (storage == TableStorage::COLUMN) {
+        schema.storage = TableStorage::COLUMN;
+        schema.column_meta_page = column_store.create_table(schema.segment_id, columns);
+    }
     Record record(schema.serialize());
-    record_manager.insert_record(record);
-    schema_cache[table_name] = schema;
+    record_manager.insert_record(CATALOG_SEGMENT, record);
+    {
+        std::unique_lock<std::shared_mutex> lock(cache_latch);
+        schema_cache[table_name] = schema;
+    }
 
+    record_manager.commit();
     DEBUG_CATALOG("Table '" << table_name << "' created with columns: " << schema.serialize());
     return true;
 }
@@ -103,26 +230,33 @@ bool CatalogManager::create_table(const std::string& table_name, const std::vect
 bool CatalogManager::drop_table(const std::string& table_name) {
     DEBUG_CATALOG("Attempting to drop table '" << table_name << "'");
 
-    if (!schema_cache.count(table_name)) {
+    TableSchema schema = get_schema(table_name);
+    if (schema.table_name.empty()) {
         DEBUG_CATALOG("Table '" << table_name << "' does not exist");
         return false;
     }
 
-    TableSchema schema = schema_cache[table_name];
     std::string serialized_schema = schema.serialize();
 
-    RecordIterator iterator(record_manager.get_disk());
+    const std::string index_prefix = "INDEX|" + table_name + "|";
+
+    RecordIterator iterator(record_manager, CATALOG_SEGMENT);
     bool found = false;
 
     while (iterator.has_next()) {
         auto [rec, page_id, slot_id] = iterator.next_with_location();
-        if (rec.to_string() == serialized_schema) {
+        std::string rec_str = rec.to_string();
+        if (rec_str == serialized_schema) {
             RecordID rid(page_id, slot_id);
-            int record_id = rid.encode();
+            int64_t record_id = rid.encode();
             record_manager.delete_record(record_id);
             DEBUG_CATALOG("Deleted schema for '" << table_name << "' at page " << page_id << ", slot " << slot_id);
             found = true;
-            break;
+        } else if (rec_str.rfind(index_prefix, 0) == 0) {
+            IndexInfo info = IndexInfo::deserialize(rec_str);
+            record_manager.delete_record(RecordID(page_id, slot_id).encode());
+            index_manager.drop_index(info.table_name, info.column_name);
+            DEBUG_CATALOG("Deleted index entry for '" << table_name << "." << info.column_name << "'");
         }
     }
 
@@ -131,35 +265,85 @@ bool CatalogManager::drop_table(const std::string& table_name) {
         return false;
     }
 
-    TableManager tm(*this, record_manager, index_manager);  // Pass yourself as catalog manager
-    int deleted = tm.delete_from(table_name, -1);  // Delete all records
-    DEBUG_CATALOG("Deleted " << deleted << " data records from table '" << table_name << "'");
+    // The rows go with the segment; its pages are reused by later inserts.
+    record_manager.drop_segment(schema.segment_id);
+    if (schema.storage == TableStorage::COLUMN) column_store.drop_table(schema.column_meta_page);
+    DEBUG_CATALOG("Released segment " << schema.segment_id << " of table '" << table_name << "'");
 
-    schema_cache.erase(table_name);
-    DEBUG_CATALOG("Table '" << table_name << "' dropped from cache (record data remains)");
+    {
+        std::unique_lock<std::shared_mutex> lock(cache_latch);
+        schema_cache.erase(table_name);
+        for (auto it = index_cache.begin(); it != index_cache.end();) {
+            it = it->second.table_name == table_name ? index_cache.erase(it) : std::next(it);
+        }
+    }
+    record_manager.commit();
+    DEBUG_CATALOG("Table '" << table_name << "' dropped");
     return true;
 }
 
+void CatalogManager::recreate_index(const std::string& table_name, const std::string& column_name) {
+    const std::string index_prefix = "INDEX|" + table_name + "|" + column_name + "|";
+    IndexInfo info;
+    RecordIterator iterator(record_manager, CATALOG_SEGMENT);
+    while (iterator.has_next()) {
+        auto [rec, page_id, slot_id] = iterator.next_with_location();
+        std::string rec_str = rec.to_string();
+        if (rec_str.rfind(index_prefix, 0) == 0) {
+            info = IndexInfo::deserialize(rec_str);
+            record_manager.delete_record(RecordID(page_id, slot_id).encode());
+            break;
+        }
+    }
+    if (info.table_name.empty()) return;
+
+    index_manager.drop_index(table_name, column_name);
+    add_index(info, {});
+    DEBUG_CATALOG("Recreated index on '" << table_name << "." << column_name << "'");
+}
+
 TableSchema CatalogManager::get_schema(const std::string& table_name) {
-    DEBUG_CATALOG("Fetching schema for table '" << table_name << "'");
-    if (!schema_cache.count(table_name)) {
+    TRACE_CATALOG("Fetching schema for table '" << table_name << "'");
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
+    auto it = schema_cache.find(table_name);
+    if (it == schema_cache.end()) {
         DEBUG_CATALOG("Table '" << table_name << "' not found in catalog");
         return TableSchema{}; // Return empty schema instead of throwing
     }
-    return schema_cache[table_name];
+    return it->second;
+}
+
+std::vector<IndexInfo> CatalogManager::get_indexes(const std::string& table_name) {
+    std::vector<IndexInfo> indexes;
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
+    for (const auto& [name, info] : index_cache) {
+        if (info.table_name == table_name) indexes.push_back(info);
+    }
+    return indexes;
+}
+
+bool CatalogManager::has_index(const std::string& index_name) {
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
+    return index_cache.count(index_name) > 0;
+}
+
+bool CatalogManager::has_table(const std::string& table_name) {
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
+    return schema_cache.count(table_name) > 0;
 }
 
 std::vector<std::string> CatalogManager::list_tables() {
     std::vector<std::string> names;
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
     for (const auto& [name, _] : schema_cache) {
         names.push_back(name);
     }
-    DEBUG_CATALOG("Listing tables: " << names.size() << " found");
+    TRACE_CATALOG("Listing tables: " << names.size() << " found");
     return names;
 }
 
 bool CatalogManager::column_exists(const std::string& table_name, const std::string& column_name) {
-    if (!schema_cache.count(table_name)) return false;
-    const auto& columns = schema_cache[table_name].columns;
-    return std::find(columns.begin(), columns.end(), column_name) != columns.end();
+    std::shared_lock<std::shared_mutex> lock(cache_latch);
+    auto it = schema_cache.find(table_name);
+    return it != schema_cache.end() && it->second.column_index(column_name) >= 0;
 }
@@ -0,0 +1,496 @@
+#include "../include/column_store.h"
+#include "../include/logger.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#define DEBUG_COLUMN(msg) LOG_DEBUG(COLUMN, msg)
+
+namespace {
+
+const int META_HEADER_SIZE = 16;
+const int META_CHAIN_SIZE = 16;
+const int MAX_CHAINS = (PAGE_SIZE - META_HEADER_SIZE) / META_CHAIN_SIZE;
+const int VERSION_CHAINS = 2; // xmin, xmax
+
+inline int32_t read_int32(const char* at) {
+    int32_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+inline void write_int32(char* at, int32_t value) {
+    memcpy(at, &value, sizeof(value));
+}
+
+inline uint16_t read_uint16(const char* at) {
+    uint16_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+inline void write_uint16(char* at, uint16_t value) {
+    memcpy(at, &value, sizeof(value));
+}
+
+inline int chain_offset(size_t chain) {
+    return META_HEADER_SIZE + static_cast<int>(chain) * META_CHAIN_SIZE;
+}
+
+// Null bitmap offset on a page; values follow it.
+inline size_t values_offset(size_t capacity) {
+    return COLUMN_PAGE_HEADER_SIZE + capacity / 8;
+}
+
+} // namespace
+
+size_t ColumnTable::value_width(TypeId type) {
+    switch (type) {
+    case TypeId::INT: return 4;
+    case TypeId::BIGINT: return 8;
+    case TypeId::DOUBLE: return 8;
+    case TypeId::BOOL: return 1;
+    case TypeId::VARCHAR: return 4;
+    }
+    return 8;
+}
+
+// As many values as fit with one bitmap bit each, rounded down to whole
+// bitmap bytes.
+size_t ColumnTable::page_capacity(size_t width) {
+    size_t capacity = (PAGE_SIZE - COLUMN_PAGE_HEADER_SIZE) * 8 / (8 * width + 1);
+    return capacity & ~static_cast<size_t>(7);
+}
+
+int ColumnTable::create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id, const vector<Column>& columns) {
+    if (columns.size() + VERSION_CHAINS > static_cast<size_t>(MAX_CHAINS)) {
+        throw invalid_argument("A column table has at most " + to_string(MAX_CHAINS - VERSION_CHAINS) + " columns");
+    }
+    vector<TypeId> types;
+    for (const auto& column : columns) types.push_back(column.type);
+    types.insert(types.end(), VERSION_CHAINS, TypeId::BIGINT);
+
+    int meta_page_id = fsm.allocate_page(segment_id);
+    PageGuard meta(bpm, meta_page_id);
+    char* data = meta.data();
+    memset(data, 0, PAGE_SIZE);
+    uint32_t chain_count = static_cast<uint32_t>(types.size());
+    memcpy(data + 8, &chain_count, sizeof(chain_count));
+
+    for (size_t i = 0; i < types.size(); ++i) {
+        char* entry = data + chain_offset(i);
+        entry[0] = static_cast<char>(types[i]);
+
+        int directory = fsm.allocate_page(segment_id);
+        {
+            PageGuard page(bpm, directory);
+            write_int32(page.data(), INVALID_PAGE_ID);
+            write_int32(page.data() + 4, 0);
+            page.log_write(0, COLUMN_DIRECTORY_HEADER_SIZE);
+        }
+        write_int32(entry + 4, directory);
+
+        int dictionary = INVALID_PAGE_ID;
+        if (types[i] == TypeId::VARCHAR) {
+            dictionary = fsm.allocate_page(segment_id);
+            PageGuard page(bpm, dictionary);
+            write_int32(page.data(), INVALID_PAGE_ID);
+            write_uint16(page.data() + 4, 0);
+            page.log_write(0, COLUMN_DICTIONARY_HEADER_SIZE);
+        }
+        write_int32(entry + 8, dictionary);
+    }
+    meta.log_write(0, chain_offset(types.size()));
+    DEBUG_COLUMN("Created column table with " << columns.size() << " columns at meta page " << meta_page_id
+                                              << " in segment " << segment_id);
+    return meta_page_id;
+}
+
+ColumnTable::ColumnTable(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment, int meta_page)
+    : buffer_pool(bpm), free_space_map(fsm), segment_id(segment), meta_page_id(meta_page) {
+    vector<pair<int, int>> anchors; // directory_first, dictionary_first
+    {
+        PageGuard meta(buffer_pool, meta_page_id, LatchMode::SHARED);
+        const char* data = meta.data();
+        uint32_t chain_count;
+        memcpy(&rows, data, sizeof(rows));
+        memcpy(&chain_count, data + 8, sizeof(chain_count));
+        if (chain_count < VERSION_CHAINS || chain_count > static_cast<uint32_t>(MAX_CHAINS)) {
+            throw runtime_error("Corrupt column table meta page " + to_string(meta_page_id));
+        }
+        chains.resize(chain_count);
+        for (uint32_t i = 0; i < chain_count; ++i) {
+            const char* entry = data + chain_offset(i);
+            chains[i].type = static_cast<TypeId>(entry[0]);
+            anchors.push_back({read_int32(entry + 4), read_int32(entry + 8)});
+        }
+    }
+    for (size_t i = 0; i < chains.size(); ++i) {
+        load_chain(chains[i], anchors[i].first, anchors[i].second);
+    }
+    DEBUG_COLUMN("Opened column table at meta page " << meta_page_id << ": " << rows << " rows, "
+                                                     << chains.size() - VERSION_CHAINS << " columns");
+}
+
+// A dictionary entry whose bytes did not all reach the log before a crash
+// was never referenced by a row, and the page pointing at its tail is
+// written last (see append_dictionary), so the stream always ends on a
+// whole entry.
+void ColumnTable::load_chain(Chain& chain, int directory_first, int dictionary_first) {
+    chain.width = value_width(chain.type);
+    chain.capacity = page_capacity(chain.width);
+
+    for (int page_id = directory_first; page_id != INVALID_PAGE_ID;) {
+        PageGuard page(buffer_pool, page_id, LatchMode::SHARED);
+        const char* data = page.data();
+        int count = read_int32(data + 4);
+        for (int i = 0; i < count; ++i) {
+            chain.pages.push_back(read_int32(data + COLUMN_DIRECTORY_HEADER_SIZE + i * 4));
+        }
+        chain.directory_last = page_id;
+        chain.directory_count = count;
+        page_id = read_int32(data);
+    }
+
+    string stream;
+    for (int page_id = dictionary_first; page_id != INVALID_PAGE_ID;) {
+        PageGuard page(buffer_pool, page_id, LatchMode::SHARED);
+        const char* data = page.data();
+        uint16_t used = read_uint16(data + 4);
+        stream.append(data + COLUMN_DICTIONARY_HEADER_SIZE, used);
+        chain.dictionary_last = page_id;
+        chain.dictionary_used = used;
+        page_id = read_int32(data);
+    }
+    for (size_t pos = 0; pos + 2 <= stream.size();) {
+        uint16_t len = read_uint16(stream.data() + pos);
+        if (pos + 2 + len > stream.size()) break;
+        chain.dictionary.push_back(stream.substr(pos + 2, len));
+        chain.codes.emplace(chain.dictionary.back(), static_cast<uint32_t>(chain.dictionary.size() - 1));
+        pos += 2 + len;
+    }
+}
+
+uint64_t ColumnTable::row_count() const {
+    shared_lock<shared_mutex> lock(latch);
+    return rows;
+}
+
+int ColumnTable::data_page(const Chain& chain, uint64_t row) const {
+    return chain.pages[row / chain.capacity];
+}
+
+// The new page's entry is logged before the directory count that makes it
+// part of the chain.
+void ColumnTable::add_data_page(Chain& chain) {
+    int page_id = free_space_map.allocate_page(segment_id);
+    if (chain.directory_count == COLUMN_DIRECTORY_ENTRIES) {
+        int directory = free_space_map.allocate_page(segment_id);
+        {
+            PageGuard page(buffer_pool, directory);
+            write_int32(page.data(), INVALID_PAGE_ID);
+            write_int32(page.data() + 4, 0);
+            page.log_write(0, COLUMN_DIRECTORY_HEADER_SIZE);
+        }
+        {
+            PageGuard last(buffer_pool, chain.directory_last);
+            write_int32(last.data(), directory);
+            last.log_write(0, sizeof(int32_t));
+        }
+        chain.directory_last = directory;
+        chain.directory_count = 0;
+    }
+    {
+        PageGuard directory(buffer_pool, chain.directory_last);
+        size_t offset = COLUMN_DIRECTORY_HEADER_SIZE + chain.directory_count * 4;
+        write_int32(directory.data() + offset, page_id);
+        directory.log_write(offset, sizeof(int32_t));
+        write_int32(directory.data() + 4, ++chain.directory_count);
+        directory.log_write(4, sizeof(int32_t));
+    }
+    unique_lock<shared_mutex> lock(latch);
+    chain.pages.push_back(page_id);
+}
+
+// An entry that does not fit on the last page continues on new pages,
+// which are written first; the last page's `used` and `next`, logged
+// last, then publish the whole entry at once.
+void ColumnTable::append_dictionary(Chain& chain, const string& value) {
+    string entry(2, '\0');
+    write_uint16(entry.data(), static_cast<uint16_t>(value.size()));
+    entry += value;
+
+    const size_t page_data = PAGE_SIZE - COLUMN_DICTIONARY_HEADER_SIZE;
+    size_t room = page_data - chain.dictionary_used;
+    size_t head = min(room, entry.size());
+
+    vector<int> continuation;
+    for (size_t rest = entry.size() - head; rest > 0; rest -= min(rest, page_data)) {
+        continuation.push_back(free_space_map.allocate_page(segment_id));
+    }
+    size_t pos = head;
+    for (size_t i = 0; i < continuation.size(); ++i) {
+        size_t len = min(entry.size() - pos, page_data);
+        PageGuard page(buffer_pool, continuation[i]);
+        write_int32(page.data(), i + 1 < continuation.size() ? continuation[i + 1] : INVALID_PAGE_ID);
+        write_uint16(page.data() + 4, static_cast<uint16_t>(len));
+        memcpy(page.data() + COLUMN_DICTIONARY_HEADER_SIZE, entry.data() + pos, len);
+        page.log_write(0, COLUMN_DICTIONARY_HEADER_SIZE + len);
+        pos += len;
+    }
+
+    {
+        PageGuard last(buffer_pool, chain.dictionary_last);
+        size_t offset = COLUMN_DICTIONARY_HEADER_SIZE + chain.dictionary_used;
+        if (head > 0) {
+            memcpy(last.data() + offset, entry.data(), head);
+            last.log_write(offset, head);
+        }
+        if (!continuation.empty()) write_int32(last.data(), continuation.front());
+        write_uint16(last.data() + 4, static_cast<uint16_t>(chain.dictionary_used + head));
+        last.log_write(0, COLUMN_DICTIONARY_HEADER_SIZE);
+    }
+    if (continuation.empty()) {
+        chain.dictionary_used += static_cast<int>(head);
+    } else {
+        chain.dictionary_last = continuation.back();
+        chain.dictionary_used = static_cast<int>(entry.size() - head - (continuation.size() - 1) * page_data);
+    }
+}
+
+uint32_t ColumnTable::encode(Chain& chain, const string& value) {
+    auto it = chain.codes.find(value);
+    if (it != chain.codes.end()) return it->second;
+
+    append_dictionary(chain, value);
+    unique_lock<shared_mutex> lock(latch);
+    chain.dictionary.push_back(value);
+    uint32_t code = static_cast<uint32_t>(chain.dictionary.size() - 1);
+    chain.codes.emplace(chain.dictionary.back(), code);
+    return code;
+}
+
+// Every row's null bit is written, set or clear, so pages reused from a
+// dropped table need no clearing beyond their header.
+void ColumnTable::write_values(Chain& chain, uint64_t first, size_t n, const char* values, const vector<uint8_t>& nulls) {
+    size_t bitmap = COLUMN_PAGE_HEADER_SIZE;
+    size_t start = values_offset(chain.capacity);
+    for (size_t done = 0; done < n;) {
+        uint64_t row = first + done;
+        size_t slot = row % chain.capacity;
+        if (row / chain.capacity == chain.pages.size()) add_data_page(chain);
+        size_t count = min(n - done, chain.capacity - slot);
+
+        PageGuard page(buffer_pool, data_page(chain, row));
+        char* data = page.data();
+        uint32_t null_count = 0;
+        if (slot > 0) memcpy(&null_count, data, sizeof(null_count));
+        for (size_t i = 0; i < count; ++i) {
+            size_t bit = slot + i;
+            uint8_t& byte = reinterpret_cast<uint8_t&>(data[bitmap + bit / 8]);
+            if (nulls[done + i]) {
+                byte |= static_cast<uint8_t>(1u << (bit % 8));
+                null_count++;
+            } else {
+                byte &= static_cast<uint8_t>(~(1u << (bit % 8)));
+            }
+        }
+        memcpy(data + start + slot * chain.width, values + done * chain.width, count * chain.width);
+        memcpy(data, &null_count, sizeof(null_count));
+        memset(data + 4, 0, 4);
+
+        page.log_write(0, COLUMN_PAGE_HEADER_SIZE);
+        page.log_write(bitmap + slot / 8, (slot + count - 1) / 8 - slot / 8 + 1);
+        page.log_write(start + slot * chain.width, count * chain.width);
+        done += count;
+    }
+}
+
+// Each chain is written in one pass; row_count, logged last, makes the
+// rows part of the table.
+uint64_t ColumnTable::append(const vector<vector<Value>>& values, TxnId txn) {
+    uint64_t first = row_count();
+    size_t n = values.size();
+    if (n == 0) return first;
+
+    size_t columns = chains.size() - VERSION_CHAINS;
+    vector<char> buffer;
+    vector<uint8_t> nulls(n);
+    for (size_t c = 0; c < columns; ++c) {
+        Chain& chain = chains[c];
+        buffer.assign(n * chain.width, 0);
+        for (size_t r = 0; r < n; ++r) {
+            const Value& value = values[r][c];
+            nulls[r] = value.is_null;
+            if (value.is_null) continue;
+            char* at = buffer.data() + r * chain.width;
+            switch (chain.type) {
+            case TypeId::INT: {
+                int32_t v = static_cast<int32_t>(value.int_value);
+                memcpy(at, &v, sizeof(v));
+                break;
+            }
+            case TypeId::BIGINT:
+                memcpy(at, &value.int_value, sizeof(value.int_value));
+                break;
+            case TypeId::DOUBLE:
+                memcpy(at, &value.double_value, sizeof(value.double_value));
+                break;
+            case TypeId::BOOL:
+                *at = value.int_value ? 1 : 0;
+                break;
+            case TypeId::VARCHAR: {
+                uint32_t code = encode(chain, value.string_value);
+                memcpy(at, &code, sizeof(code));
+                break;
+            }
+            }
+        }
+        write_values(chain, first, n, buffer.data(), nulls);
+    }
+
+    fill(nulls.begin(), nulls.end(), 0);
+    vector<uint64_t> versions(n, txn);
+    write_values(chains[xmin_column()], first, n, reinterpret_cast<const char*>(versions.data()), nulls);
+    fill(versions.begin(), versions.end(), 0);
+    write_values(chains[xmax_column()], first, n, reinterpret_cast<const char*>(versions.data()), nulls);
+
+    {
+        PageGuard meta(buffer_pool, meta_page_id);
+        uint64_t count = first + n;
+        memcpy(meta.data(), &count, sizeof(count));
+        meta.log_write(0, sizeof(count));
+    }
+    unique_lock<shared_mutex> lock(latch);
+    rows = first + n;
+    return first;
+}
+
+bool ColumnTable::remove(uint64_t row, TxnId txn) {
+    int page_id;
+    {
+        shared_lock<shared_mutex> lock(latch);
+        if (row >= rows) return false;
+        page_id = data_page(chains[xmax_column()], row);
+    }
+    const Chain& chain = chains[xmax_column()];
+    PageGuard page(buffer_pool, page_id);
+    size_t offset = values_offset(chain.capacity) + (row % chain.capacity) * chain.width;
+    TxnId xmax;
+    memcpy(&xmax, page.data() + offset, sizeof(xmax));
+    if (xmax != 0) return false;
+    memcpy(page.data() + offset, &txn, sizeof(txn));
+    page.log_write(offset, sizeof(txn));
+    return true;
+}
+
+void ColumnTable::read(size_t chain_index, uint64_t first, size_t n, char* values, uint64_t* nulls) const {
+    const Chain& chain = chains[chain_index];
+    fill(nulls, nulls + (n + 63) / 64, 0);
+    vector<int> pages;
+    {
+        shared_lock<shared_mutex> lock(latch);
+        for (uint64_t p = first / chain.capacity; n > 0 && p <= (first + n - 1) / chain.capacity; ++p) {
+            pages.push_back(chain.pages[p]);
+        }
+    }
+
+    size_t start = values_offset(chain.capacity);
+    size_t done = 0;
+    for (int page_id : pages) {
+        size_t slot = (first + done) % chain.capacity;
+        size_t count = min(n - done, chain.capacity - slot);
+        PageGuard page(buffer_pool, page_id, LatchMode::SHARED);
+        const char* data = page.data();
+        memcpy(values + done * chain.width, data + start + slot * chain.width, count * chain.width);
+        uint32_t null_count;
+        memcpy(&null_count, data, sizeof(null_count));
+        if (null_count > 0) {
+            const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(data + COLUMN_PAGE_HEADER_SIZE);
+            for (size_t i = 0; i < count; ++i) {
+                size_t bit = slot + i;
+                if (bitmap[bit / 8] & (1u << (bit % 8))) nulls[(done + i) / 64] |= 1ULL << ((done + i) % 64);
+            }
+        }
+        done += count;
+    }
+}
+
+bool ColumnTable::read_row(uint64_t row, const Snapshot& snapshot, vector<Value>& values, const vector<bool>* columns) const {
+    if (row >= row_count()) return false;
+    TxnId xmin, xmax;
+    uint64_t null_word;
+    read(xmin_column(), row, 1, reinterpret_cast<char*>(&xmin), &null_word);
+    read(xmax_column(), row, 1, reinterpret_cast<char*>(&xmax), &null_word);
+    if (!snapshot.sees(xmin, xmax)) return false;
+
+    size_t column_count = chains.size() - VERSION_CHAINS;
+    values.assign(column_count, Value());
+    char buffer[8];
+    for (size_t c = 0; c < column_count; ++c) {
+        const Chain& chain = chains[c];
+        values[c] = Value::make_null(chain.type);
+        if (columns && !(*columns)[c]) continue;
+        read(c, row, 1, buffer, &null_word);
+        if (null_word) continue;
+        switch (chain.type) {
+        case TypeId::INT: {
+            int32_t v;
+            memcpy(&v, buffer, sizeof(v));
+            values[c] = Value::make_int(v);
+            break;
+        }
+        case TypeId::BIGINT: {
+            int64_t v;
+            memcpy(&v, buffer, sizeof(v));
+            values[c] = Value::make_int(v, TypeId::BIGINT);
+            break;
+        }
+        case TypeId::DOUBLE: {
+            double v;
+            memcpy(&v, buffer, sizeof(v));
+            values[c] = Value::make_double(v);
+            break;
+        }
+        case TypeId::BOOL:
+            values[c] = Value::make_bool(buffer[0] != 0);
+            break;
+        case TypeId::VARCHAR: {
+            uint32_t code;
+            memcpy(&code, buffer, sizeof(code));
+            shared_lock<shared_mutex> lock(latch);
+            values[c] = Value::make_string(chain.dictionary[code]);
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+bool ColumnTable::find_code(size_t column, const string& value, uint32_t& code) const {
+    const auto& codes = chains[column].codes;
+    auto it = codes.find(value);
+    if (it == codes.end()) return false;
+    code = it->second;
+    return true;
+}
+
+ColumnStore::ColumnStore(BufferPoolManager& bpm, FreeSpaceMap& fsm) : buffer_pool(bpm), free_space_map(fsm) {}
+
+int ColumnStore::create_table(int segment_id, const vector<Column>& columns) {
+    return ColumnTable::create(buffer_pool, free_space_map, segment_id, columns);
+}
+
+shared_ptr<ColumnTable> ColumnStore::open_table(int segment_id, int meta_page_id) {
+    lock_guard<mutex> lock(latch);
+    auto it = tables.find(meta_page_id);
+    if (it != tables.end()) return it->second;
+    auto table = make_shared<ColumnTable>(buffer_pool, free_space_map, segment_id, meta_page_id);
+    tables[meta_page_id] = table;
+    return table;
+}
+
+void ColumnStore::drop_table(int meta_page_id) {
+    lock_guard<mutex> lock(latch);
+    tables.erase(meta_page_id);
+}
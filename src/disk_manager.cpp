@@ -1,114 +1,235 @@
-#define COLOR_DEBUG   "\033[1;36m" // Cyan
-#define COLOR_ERROR   "\033[1;31m" // Red
-#define COLOR_SUCCESS "\033[1;32m" // Green
-#define COLOR_RESET   "\033[0m"
-
 #include "../include/disk_manager.h"
-#include <iostream>
+#include "../include/logger.h"
+#include <stdexcept>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
 
 using namespace std;
 
-DiskManager::DiskManager(const string& filename) : file_name(filename) {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] DiskManager constructor called with file: " << filename << COLOR_RESET << endl;
-    db_file.open(filename, ios::in | ios::out | ios::binary);
-    if(!db_file.is_open()){
-        cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] File does not exist. Creating new file: " << filename << COLOR_RESET << endl;
-        db_file.open(filename, std::ios::out | std::ios::binary);
-        std::vector<char> zero_page(PAGE_SIZE, 0);
-        db_file.write(zero_page.data(), PAGE_SIZE);
-        db_file.close();
-        db_file.open(filename, ios::in | ios::out | ios::binary);
+DiskManager::DiskManager(const string& filename, DiskMode disk_mode)
+    : fd(-1), file_name(filename), num_pages(0), mode(disk_mode), mapping(nullptr), mapped_pages(0) {
+    LOG_DEBUG(DISK, "DiskManager constructor called with file: " << filename);
+    fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR(DISK, "Cannot open " << filename << ": " << strerror(errno));
+        throw runtime_error("Cannot open database file");
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    num_pages = static_cast<int>(st.st_size / PAGE_SIZE);
+
+    if (mode == DiskMode::MMAP) {
+        if (!grow_mapping(num_pages > 0 ? num_pages.load() : 1)) {
+            close(fd);
+            throw runtime_error("Cannot map database file");
+        }
+        // A crash leaves the unused tail of the last extension in the file;
+        // those pages were never written and are all zero.
+        static const char zero_page[PAGE_SIZE] = {};
+        while (num_pages > 1 && memcmp(mapping + static_cast<size_t>(num_pages - 1) * PAGE_SIZE, zero_page, PAGE_SIZE) == 0) {
+            num_pages--;
+        }
     }
+
+    if (num_pages == 0) {
+        LOG_DEBUG(DISK, "File is empty. Writing page 0 of new file: " << filename);
+        allocate_page();
+    }
+    LOG_DEBUG(DISK, "Opened " << filename << " with " << num_pages << " pages" << (mode == DiskMode::MMAP ? " (mmap)." : "."));
 }
 
 DiskManager::~DiskManager() {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] DiskManager destructor called." << COLOR_RESET << endl;
+    LOG_DEBUG(DISK, "DiskManager destructor called.");
     flush();
-    db_file.close();
+    if (mapping) {
+        munmap(mapping, static_cast<size_t>(mapped_pages) * PAGE_SIZE);
+        // Give back the unused part of the last extension.
+        if (ftruncate(fd, static_cast<off_t>(num_pages) * PAGE_SIZE) != 0) {
+            LOG_WARN(DISK, "Could not trim " << file_name << ": " << strerror(errno));
+        }
+    }
+    close(fd);
 }
 
-bool DiskManager::write_page(int page_id, const vector<char>& data) {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Writing page " << page_id << COLOR_RESET << endl;
-    db_file.clear();
+DiskMode DiskManager::mode_from_environment() {
+    const char* name = getenv("LIMBODB_DISK_MODE");
+    return name && strcasecmp(name, "mmap") == 0 ? DiskMode::MMAP : DiskMode::PREAD;
+}
+
+// Extends the file and the mapping to at least `min_pages` pages, rounded up
+// to whole MMAP_GROW_PAGES chunks so growth costs one ftruncate and mremap
+// per chunk. The mapping may move.
+bool DiskManager::grow_mapping(int min_pages) {
+    if (min_pages <= mapped_pages) return true;
+    int new_pages = (min_pages + MMAP_GROW_PAGES - 1) / MMAP_GROW_PAGES * MMAP_GROW_PAGES;
+    size_t new_size = static_cast<size_t>(new_pages) * PAGE_SIZE;
 
-    db_file.seekp(page_id * PAGE_SIZE, ios::beg);
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Seekp failed for page " << page_id << COLOR_RESET << "\n";
+    if (ftruncate(fd, static_cast<off_t>(new_size)) != 0) {
+        LOG_ERROR(DISK, "Cannot extend " << file_name << " to " << new_pages << " pages: " << strerror(errno));
         return false;
     }
-
-    db_file.write(data.data(), PAGE_SIZE);
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Write failed for page " << page_id << COLOR_RESET << "\n";
+    void* new_mapping = mapping
+        ? mremap(mapping, static_cast<size_t>(mapped_pages) * PAGE_SIZE, new_size, MREMAP_MAYMOVE)
+        : mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (new_mapping == MAP_FAILED) {
+        LOG_ERROR(DISK, "Cannot map " << new_pages << " pages of " << file_name << ": " << strerror(errno));
         return false;
     }
 
-    db_file.flush();
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Flush failed for page " << page_id << COLOR_RESET << "\n";
+    mapping = static_cast<char*>(new_mapping);
+    mapped_pages = new_pages;
+    LOG_DEBUG(DISK, "Mapped " << mapped_pages << " pages of " << file_name);
+    return true;
+}
+
+// The mapping never shrinks, so once it covers `min_pages` it keeps doing so
+// and copies only need the latch shared.
+bool DiskManager::ensure_mapped(int min_pages) {
+    {
+        shared_lock<shared_mutex> lock(map_latch);
+        if (min_pages <= mapped_pages) return true;
+    }
+    unique_lock<shared_mutex> lock(map_latch);
+    return grow_mapping(min_pages);
+}
+
+bool DiskManager::write_page(int page_id, const char* data) {
+    if (mode == DiskMode::MMAP) {
+        if (!ensure_mapped(page_id + 1)) return false;
+        {
+            shared_lock<shared_mutex> lock(map_latch);
+            memcpy(mapping + static_cast<size_t>(page_id) * PAGE_SIZE, data, PAGE_SIZE);
+        }
+        if (page_id >= num_pages) num_pages = page_id + 1;
+        LOG_TRACE(DISK, "Page " << page_id << " written.");
+        return true;
+    }
+
+    ssize_t written = pwrite(fd, data, PAGE_SIZE, static_cast<off_t>(page_id) * PAGE_SIZE);
+    if (written != PAGE_SIZE) {
+        LOG_ERROR(DISK, "Write failed for page " << page_id << ": " << strerror(errno));
         return false;
     }
 
-    cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Page " << page_id << " written successfully." << COLOR_RESET << endl;
+    if (page_id >= num_pages) {
+        num_pages = page_id + 1;
+    }
+
+    LOG_TRACE(DISK, "Page " << page_id << " written.");
     return true;
 }
 
-std::vector<char> DiskManager::read_page(int page_id) {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Reading page " << page_id << COLOR_RESET << endl;
-    std::vector<char> page(PAGE_SIZE);
-
-    std::ifstream file(file_name, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Failed to open file" + COLOR_RESET);
+bool DiskManager::read_page(int page_id, char* data) {
+    if (page_id < 0 || page_id >= num_pages) {
+        LOG_ERROR(DISK, "Page " << page_id << " is beyond end of file");
+        return false;
     }
 
-    file.seekg(page_id * PAGE_SIZE);
-    if (!file.good()) {
-        std::cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Seekg failed for page " << page_id << COLOR_RESET << std::endl;
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Seekg failed" + COLOR_RESET);
+    if (mode == DiskMode::MMAP) {
+        shared_lock<shared_mutex> lock(map_latch);
+        memcpy(data, mapping + static_cast<size_t>(page_id) * PAGE_SIZE, PAGE_SIZE);
+        LOG_TRACE(DISK, "Page " << page_id << " read.");
+        return true;
     }
 
-    file.read(page.data(), PAGE_SIZE);
-    if (file.gcount() < PAGE_SIZE) {
-        std::cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Could not read full page " << page_id << COLOR_RESET << std::endl;
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Partial read" + COLOR_RESET);
+    if (!pread_page(page_id, data)) {
+        LOG_ERROR(DISK, "Could not read full page " << page_id);
+        return false;
     }
 
-    cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Page " << page_id << " read successfully." << COLOR_RESET << endl;
-    return page;
+    LOG_TRACE(DISK, "Page " << page_id << " read.");
+    return true;
 }
 
-void DiskManager::flush(){
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Flushing db_file." << COLOR_RESET << endl;
-    db_file.flush();
+bool DiskManager::pread_page(int page_id, char* data) const {
+    size_t done = 0;
+    while (done < static_cast<size_t>(PAGE_SIZE)) {
+        ssize_t bytes_read = pread(fd, data + done, PAGE_SIZE - done, static_cast<off_t>(page_id) * PAGE_SIZE + static_cast<off_t>(done));
+        if (bytes_read <= 0) {
+            if (bytes_read < 0 && errno == EINTR) continue;
+            return false;
+        }
+        done += static_cast<size_t>(bytes_read);
+    }
+    return true;
 }
 
-int DiskManager::get_num_pages() {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Getting number of pages." << COLOR_RESET << endl;
-    db_file.clear();
-    db_file.seekg(0, ios::end);
-    streampos file_size = db_file.tellg();
+void DiskManager::flush(){
+    LOG_TRACE(DISK, "Syncing " << file_name << ".");
+    shared_lock<shared_mutex> lock(map_latch);
+    if (mapping && msync(mapping, static_cast<size_t>(num_pages) * PAGE_SIZE, MS_SYNC) != 0) {
+        LOG_ERROR(DISK, "msync failed: " << strerror(errno));
+    }
+    if (fdatasync(fd) != 0) {
+        LOG_ERROR(DISK, "fdatasync failed: " << strerror(errno));
+    }
+}
 
-    if (file_size == -1) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Failed to get file size." << COLOR_RESET << "\n";
-        return -1;
+void DiskManager::advise(AccessPattern pattern) {
+    shared_lock<shared_mutex> lock(map_latch);
+    if (mapping) {
+        int advice = pattern == AccessPattern::SEQUENTIAL ? MADV_SEQUENTIAL
+                   : pattern == AccessPattern::RANDOM ? MADV_RANDOM : MADV_NORMAL;
+        madvise(mapping, static_cast<size_t>(mapped_pages) * PAGE_SIZE, advice);
+    } else {
+        int advice = pattern == AccessPattern::SEQUENTIAL ? POSIX_FADV_SEQUENTIAL
+                   : pattern == AccessPattern::RANDOM ? POSIX_FADV_RANDOM : POSIX_FADV_NORMAL;
+        posix_fadvise(fd, 0, 0, advice);
     }
-    int num_pages = static_cast<int>(file_size / PAGE_SIZE);
-    cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Number of pages: " << num_pages << COLOR_RESET << endl;
+}
+
+int DiskManager::get_num_pages() {
     return num_pages;
 }
 
 int DiskManager::allocate_page() {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Allocating new page." << COLOR_RESET << endl;
     int new_page_id = get_num_pages();
 
     vector<char> zero_page(PAGE_SIZE, 0);
-    if (!write_page(new_page_id, zero_page)) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Failed to write zero page for allocation." << COLOR_RESET << "\n";
+    if (!write_page(new_page_id, zero_page.data())) {
+        LOG_ERROR(DISK, "Failed to write zero page for allocation.");
         return -1;
     }
 
-    cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Allocated new page with ID " << new_page_id << "." << COLOR_RESET << endl;
+    LOG_TRACE(DISK, "Allocated new page with ID " << new_page_id << ".");
     return new_page_id;
 }
+
+int DiskManager::append_pages(const char* data, int count) {
+    int first_page_id = get_num_pages();
+    size_t total = static_cast<size_t>(count) * PAGE_SIZE;
+    off_t offset = static_cast<off_t>(first_page_id) * PAGE_SIZE;
+
+    if (mode == DiskMode::MMAP) {
+        if (!ensure_mapped(first_page_id + count)) return -1;
+        {
+            shared_lock<shared_mutex> lock(map_latch);
+            memcpy(mapping + offset, data, total);
+        }
+        num_pages += count;
+        LOG_TRACE(DISK, "Appended pages " << first_page_id << ".." << first_page_id + count - 1 << ".");
+        return first_page_id;
+    }
+
+    size_t done = 0;
+    while (done < total) {
+        ssize_t written = pwrite(fd, data + done, total - done, offset + static_cast<off_t>(done));
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            LOG_ERROR(DISK, "Append of " << count << " pages at page " << first_page_id << " failed: " << strerror(errno));
+            return -1;
+        }
+        done += static_cast<size_t>(written);
+    }
+    num_pages += count;
+
+    LOG_TRACE(DISK, "Appended pages " << first_page_id << ".." << first_page_id + count - 1 << ".");
+    return first_page_id;
+}
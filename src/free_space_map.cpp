@@ -0,0 +1,216 @@
+#include "../include/free_space_map.h"
+#include "../include/logger.h"
+#include "../include/header_page.h"
+#include <stdexcept>
+#include <climits>
+#include <cstddef>
+#include <mutex>
+
+using namespace std;
+
+FreeSpaceMap::FreeSpaceMap(BufferPoolManager& bpm) : buffer_pool(bpm) {
+    load();
+}
+
+uint8_t FreeSpaceMap::to_category(int free_bytes) {
+    if (free_bytes <= 0) return 0;
+    int category = free_bytes / FSM_CATEGORY_BYTES;
+    return static_cast<uint8_t>(category > FSM_MAX_CATEGORY ? FSM_MAX_CATEGORY : category);
+}
+
+void FreeSpaceMap::load() {
+    PageGuard header_guard(buffer_pool, HEADER_PAGE_ID);
+    DatabaseHeader* header = reinterpret_cast<DatabaseHeader*>(header_guard.data());
+
+    if (!header->is_initialized()) {
+        if (buffer_pool.get_num_pages() > 1) {
+            LOG_ERROR(FSM, "Database file has data but no header; it predates format versioning.");
+            throw runtime_error("Unsupported database format version");
+        }
+        LOG_DEBUG(FSM, "Database header not initialized. Writing a new one.");
+        header->initialize();
+        header_guard.log_write(0, sizeof(DatabaseHeader));
+        return;
+    }
+    if (header->format_version != DB_FORMAT_VERSION) {
+        LOG_ERROR(FSM, "Unsupported database format version " << header->format_version);
+        throw runtime_error("Unsupported database format version");
+    }
+
+    int fsm_page_id = header->fsm_first_page;
+    header_guard.release();
+
+    while (fsm_page_id != INVALID_PAGE_ID) {
+        PageGuard guard(buffer_pool, fsm_page_id);
+        const char* data = guard.data();
+        fsm_pages.push_back(fsm_page_id);
+
+        const uint8_t* entries = reinterpret_cast<const uint8_t*>(data + FSM_PAGE_HEADER_SIZE);
+        categories.insert(categories.end(), entries, entries + FSM_ENTRIES_PER_PAGE);
+        const int32_t* owners = reinterpret_cast<const int32_t*>(data + FSM_PAGE_HEADER_SIZE + FSM_ENTRIES_PER_PAGE);
+        segments.insert(segments.end(), owners, owners + FSM_ENTRIES_PER_PAGE);
+        fsm_page_id = *reinterpret_cast<const int32_t*>(data);
+    }
+
+    size_t with_space = 0;
+    for (size_t i = 0; i < categories.size(); ++i) {
+        int page_id = static_cast<int>(i);
+        if (segments[i] == NO_SEGMENT) continue;
+        segment_pages[segments[i]].insert(page_id);
+        if (categories[i] > 0) {
+            candidates[segments[i]].insert({categories[i], page_id});
+            with_space++;
+        }
+    }
+    LOG_DEBUG(FSM, "Loaded " << fsm_pages.size() << " FSM pages, " << segment_pages.size() << " segments, " << with_space << " pages with free space.");
+}
+
+// Appends FSM pages to the chain until `page_id` has an entry. A freshly
+// allocated FSM page is all zeroes, so the pages it covers (including
+// itself) start out with no free space and no owning segment.
+void FreeSpaceMap::ensure_coverage(int page_id) {
+    while (page_id >= static_cast<int>(categories.size())) {
+        int new_page_id;
+        PageGuard guard(buffer_pool, buffer_pool.new_page(new_page_id));
+        *reinterpret_cast<int32_t*>(guard.data()) = INVALID_PAGE_ID;
+        guard.log_write(0, sizeof(int32_t));
+        guard.release();
+
+        if (fsm_pages.empty()) {
+            PageGuard header_guard(buffer_pool, HEADER_PAGE_ID);
+            reinterpret_cast<DatabaseHeader*>(header_guard.data())->fsm_first_page = new_page_id;
+            header_guard.log_write(offsetof(DatabaseHeader, fsm_first_page), sizeof(int32_t));
+        } else {
+            PageGuard prev_guard(buffer_pool, fsm_pages.back());
+            *reinterpret_cast<int32_t*>(prev_guard.data()) = new_page_id;
+            prev_guard.log_write(0, sizeof(int32_t));
+        }
+
+        fsm_pages.push_back(new_page_id);
+        categories.resize(categories.size() + FSM_ENTRIES_PER_PAGE, 0);
+        segments.resize(segments.size() + FSM_ENTRIES_PER_PAGE, NO_SEGMENT);
+        LOG_DEBUG(FSM, "Allocated FSM page " << new_page_id << " covering up to page " << categories.size() - 1);
+    }
+}
+
+// Copies the cached entry of `page_id` into its FSM page and logs the
+// changed part.
+void FreeSpaceMap::write_entry(int page_id, bool segment_changed) {
+    int fsm_index = page_id / FSM_ENTRIES_PER_PAGE;
+    int slot = page_id % FSM_ENTRIES_PER_PAGE;
+    PageGuard guard(buffer_pool, fsm_pages[fsm_index]);
+    uint8_t* entries = reinterpret_cast<uint8_t*>(guard.data() + FSM_PAGE_HEADER_SIZE);
+    int32_t* owners = reinterpret_cast<int32_t*>(guard.data() + FSM_PAGE_HEADER_SIZE + FSM_ENTRIES_PER_PAGE);
+    entries[slot] = categories[page_id];
+    owners[slot] = segments[page_id];
+    if (segment_changed) {
+        guard.log_write(FSM_PAGE_HEADER_SIZE + FSM_ENTRIES_PER_PAGE + slot * sizeof(int32_t), sizeof(int32_t));
+    } else {
+        guard.log_write(FSM_PAGE_HEADER_SIZE + slot, 1);
+    }
+}
+
+void FreeSpaceMap::set_category(int page_id, uint8_t category) {
+    ensure_coverage(page_id);
+
+    uint8_t old_category = categories[page_id];
+    if (old_category == category) return;
+
+    auto& segment_candidates = candidates[segments[page_id]];
+    if (old_category > 0) segment_candidates.erase({old_category, page_id});
+    if (category > 0) segment_candidates.insert({category, page_id});
+    categories[page_id] = category;
+    write_entry(page_id, false);
+}
+
+// Best fit: the smallest category that still guarantees enough room, so
+// nearly empty pages are kept for large records.
+int FreeSpaceMap::find_page(int segment_id, int required_bytes) {
+    lock_guard<recursive_mutex> lock(latch);
+    int needed = (required_bytes + FSM_CATEGORY_BYTES - 1) / FSM_CATEGORY_BYTES;
+    if (needed > FSM_MAX_CATEGORY) needed = FSM_MAX_CATEGORY;
+    if (needed < 1) needed = 1;
+
+    auto seg_it = candidates.find(segment_id);
+    if (seg_it == candidates.end()) return INVALID_PAGE_ID;
+    auto it = seg_it->second.lower_bound({static_cast<uint8_t>(needed), INT_MIN});
+    if (it == seg_it->second.end()) return INVALID_PAGE_ID;
+    return it->second;
+}
+
+void FreeSpaceMap::update(int page_id, int free_bytes) {
+    lock_guard<recursive_mutex> lock(latch);
+    set_category(page_id, to_category(free_bytes));
+}
+
+void FreeSpaceMap::set_segment(int page_id, int segment_id) {
+    lock_guard<recursive_mutex> lock(latch);
+    ensure_coverage(page_id);
+    int old_segment = segments[page_id];
+    if (old_segment == segment_id) return;
+
+    if (old_segment != NO_SEGMENT) segment_pages[old_segment].erase(page_id);
+    if (segment_id != NO_SEGMENT) segment_pages[segment_id].insert(page_id);
+    if (categories[page_id] > 0) {
+        candidates[old_segment].erase({categories[page_id], page_id});
+        candidates[segment_id].insert({categories[page_id], page_id});
+    }
+    segments[page_id] = segment_id;
+    write_entry(page_id, true);
+}
+
+int FreeSpaceMap::get_segment(int page_id) const {
+    lock_guard<recursive_mutex> lock(latch);
+    if (page_id < 0 || page_id >= static_cast<int>(segments.size())) return NO_SEGMENT;
+    return segments[page_id];
+}
+
+vector<int> FreeSpaceMap::get_segment_pages(int segment_id) const {
+    lock_guard<recursive_mutex> lock(latch);
+    auto it = segment_pages.find(segment_id);
+    if (it == segment_pages.end()) return {};
+    return vector<int>(it->second.begin(), it->second.end());
+}
+
+int FreeSpaceMap::allocate_segment() {
+    lock_guard<recursive_mutex> lock(latch);
+    PageGuard header_guard(buffer_pool, HEADER_PAGE_ID);
+    DatabaseHeader* header = reinterpret_cast<DatabaseHeader*>(header_guard.data());
+    int segment_id = header->next_segment_id++;
+    header_guard.log_write(offsetof(DatabaseHeader, next_segment_id), sizeof(int32_t));
+    LOG_DEBUG(FSM, "Allocated segment " << segment_id);
+    return segment_id;
+}
+
+void FreeSpaceMap::release_segment(int segment_id) {
+    lock_guard<recursive_mutex> lock(latch);
+    vector<int> pages = get_segment_pages(segment_id);
+    for (int page_id : pages) release_page(page_id);
+    segment_pages.erase(segment_id);
+    candidates.erase(segment_id);
+    LOG_DEBUG(FSM, "Released " << pages.size() << " pages of segment " << segment_id);
+}
+
+void FreeSpaceMap::release_page(int page_id) {
+    lock_guard<recursive_mutex> lock(latch);
+    set_category(page_id, 0);
+    set_segment(page_id, FREE_SEGMENT);
+}
+
+int FreeSpaceMap::take_free_page() {
+    lock_guard<recursive_mutex> lock(latch);
+    auto it = segment_pages.find(FREE_SEGMENT);
+    if (it == segment_pages.end() || it->second.empty()) return INVALID_PAGE_ID;
+    return *it->second.begin();
+}
+
+int FreeSpaceMap::allocate_page(int segment_id) {
+    lock_guard<recursive_mutex> lock(latch);
+    int page_id = take_free_page();
+    if (page_id == INVALID_PAGE_ID) {
+        buffer_pool.new_page(page_id);
+        buffer_pool.unpin_page(page_id, true);
+    }
+    set_segment(page_id, segment_id);
+    return page_id;
+}
@@ -0,0 +1,37 @@
+#include "../include/garbage_collector.h"
+#include "../include/logger.h"
+#include <exception>
+
+using namespace std;
+
+GarbageCollector::GarbageCollector(TableManager& tm, chrono::milliseconds period)
+    : tables(tm), interval(period), stopping(false) {
+    worker = thread(&GarbageCollector::run, this);
+}
+
+GarbageCollector::~GarbageCollector() {
+    {
+        lock_guard<mutex> lock(latch);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void GarbageCollector::run() {
+    unique_lock<mutex> lock(latch);
+    while (!wake.wait_for(lock, interval, [this] { return stopping.load(); })) {
+        lock.unlock();
+        try {
+            bool more = true;
+            while (more) {
+                lock_guard<mutex> writer(tables.write_latch());
+                more = tables.collect_garbage(GC_BATCH_PAGES);
+                if (stopping) break;
+            }
+        } catch (const exception& e) {
+            LOG_ERROR(TXN, "Garbage collection failed: " << e.what());
+        }
+        lock.lock();
+    }
+}
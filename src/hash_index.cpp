@@ -0,0 +1,397 @@
+#include "../include/hash_index.h"
+#include "../include/logger.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const int META_DIRECTORY_COUNT_OFFSET = 4;
+const int META_DIRECTORY_OFFSET = 16;
+const uint32_t SLOTS_PER_DIRECTORY_PAGE = PAGE_SIZE / sizeof(int32_t);
+// 2^19 slots fill 512 directory pages, well within the meta page.
+const int MAX_GLOBAL_DEPTH = 19;
+
+const int BUCKET_HEADER_SIZE = 12;
+
+inline uint16_t bucket_local_depth(const char* page) {
+    return *reinterpret_cast<const uint16_t*>(page);
+}
+
+inline uint16_t bucket_count(const char* page) {
+    return *reinterpret_cast<const uint16_t*>(page + 2);
+}
+
+inline uint16_t bucket_used(const char* page) {
+    return *reinterpret_cast<const uint16_t*>(page + 4);
+}
+
+inline int32_t bucket_next(const char* page) {
+    return *reinterpret_cast<const int32_t*>(page + 8);
+}
+
+inline void set_bucket_header(char* page, uint16_t count, uint16_t used) {
+    *reinterpret_cast<uint16_t*>(page + 2) = count;
+    *reinterpret_cast<uint16_t*>(page + 4) = used;
+}
+
+inline void set_bucket_next(char* page, int32_t next) {
+    *reinterpret_cast<int32_t*>(page + 8) = next;
+}
+
+// Entry accessors, walking a page in place.
+inline uint32_t entry_hash(const char* entry) {
+    uint32_t hash;
+    memcpy(&hash, entry, sizeof(hash));
+    return hash;
+}
+
+inline string_view entry_key(const char* entry) {
+    uint16_t len;
+    memcpy(&len, entry + 4, sizeof(len));
+    return string_view(entry + 6, len);
+}
+
+inline int64_t entry_value(const char* entry) {
+    int64_t value;
+    memcpy(&value, entry + 6 + entry_key(entry).size(), sizeof(value));
+    return value;
+}
+
+inline uint32_t reverse_bits(uint32_t x) {
+    uint32_t r = 0;
+    for (int i = 0; i < 32; ++i, x >>= 1) r = (r << 1) | (x & 1);
+    return r;
+}
+
+} // namespace
+
+// FNV-1a, finished with the MurmurHash3 mixer: the directory uses the low
+// bits, which FNV alone spreads poorly for short binary keys.
+uint32_t HashIndex::hash_key(string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+}
+
+size_t HashIndex::entry_size(size_t key_size) {
+    return 4 + 2 + key_size + 8;
+}
+
+// ---------- Meta page and directory ----------
+
+int HashIndex::create(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment_id) {
+    int meta_page_id = fsm.allocate_page(segment_id);
+    HashIndex index(bpm, fsm, segment_id, meta_page_id);
+    int bucket_page_id = index.allocate_page();
+    {
+        PageGuard bucket(bpm, bucket_page_id);
+        init_page(bucket, 0);
+    }
+    int directory_page_id = index.allocate_page();
+    {
+        PageGuard directory(bpm, directory_page_id);
+        memset(directory.data(), 0, PAGE_SIZE);
+        *reinterpret_cast<int32_t*>(directory.data()) = bucket_page_id;
+        directory.mark_dirty();
+    }
+    PageGuard meta(bpm, meta_page_id);
+    memset(meta.data(), 0, PAGE_SIZE);
+    *reinterpret_cast<int32_t*>(meta.data() + META_DIRECTORY_COUNT_OFFSET) = 1;
+    *reinterpret_cast<int32_t*>(meta.data() + META_DIRECTORY_OFFSET) = directory_page_id;
+    meta.mark_dirty();
+    index.note_change(meta);
+    LOG_DEBUG(HASH, "Created hash index with meta page " << meta_page_id << " in segment " << segment_id);
+    return meta_page_id;
+}
+
+HashIndex::HashIndex(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment, int meta_page)
+    : Index(bpm, fsm, segment, meta_page) {}
+
+int HashIndex::global_depth(const PageGuard& meta) {
+    return *reinterpret_cast<const int32_t*>(meta.data());
+}
+
+int HashIndex::directory_page(const PageGuard& meta, uint32_t slot) const {
+    return reinterpret_cast<const int32_t*>(meta.data() + META_DIRECTORY_OFFSET)[slot / SLOTS_PER_DIRECTORY_PAGE];
+}
+
+int HashIndex::bucket_for(const PageGuard& meta, uint32_t hash) {
+    uint32_t slot = hash & ((1u << global_depth(meta)) - 1);
+    PageGuard directory(buffer_pool, directory_page(meta, slot), LatchMode::SHARED);
+    return reinterpret_cast<const int32_t*>(directory.data())[slot % SLOTS_PER_DIRECTORY_PAGE];
+}
+
+// Callers hold the meta page exclusively.
+void HashIndex::set_slot(const PageGuard& meta, uint32_t slot, int bucket_page_id) {
+    PageGuard directory(buffer_pool, directory_page(meta, slot));
+    reinterpret_cast<int32_t*>(directory.data())[slot % SLOTS_PER_DIRECTORY_PAGE] = bucket_page_id;
+    directory.mark_dirty();
+}
+
+// Doubles the directory: slot i + 2^depth starts out pointing where slot i
+// does. Callers hold the meta page exclusively.
+void HashIndex::grow_directory(PageGuard& meta) {
+    int depth = global_depth(meta);
+    if (depth >= MAX_GLOBAL_DEPTH) throw logic_error("Hash index directory is at its largest");
+    uint32_t slots = 1u << depth;
+    if (slots < SLOTS_PER_DIRECTORY_PAGE) {
+        PageGuard directory(buffer_pool, directory_page(meta, 0));
+        int32_t* slot = reinterpret_cast<int32_t*>(directory.data());
+        memcpy(slot + slots, slot, slots * sizeof(int32_t));
+        directory.mark_dirty();
+    } else {
+        int32_t* pages = reinterpret_cast<int32_t*>(meta.data() + META_DIRECTORY_OFFSET);
+        int count = static_cast<int>(slots / SLOTS_PER_DIRECTORY_PAGE);
+        for (int i = 0; i < count; ++i) {
+            PageGuard copy(buffer_pool, allocate_page());
+            PageGuard original(buffer_pool, pages[i], LatchMode::SHARED);
+            memcpy(copy.data(), original.data(), PAGE_SIZE);
+            copy.mark_dirty();
+            pages[count + i] = copy.page_id();
+        }
+        *reinterpret_cast<int32_t*>(meta.data() + META_DIRECTORY_COUNT_OFFSET) = 2 * count;
+    }
+    *reinterpret_cast<int32_t*>(meta.data()) = depth + 1;
+    meta.mark_dirty();
+    LOG_DEBUG(HASH, "Hash index " << meta_page_id << " directory grown to depth " << depth + 1);
+}
+
+// ---------- Buckets ----------
+
+void HashIndex::init_page(PageGuard& guard, int local_depth) {
+    char* page = guard.data();
+    memset(page, 0, PAGE_SIZE);
+    *reinterpret_cast<uint16_t*>(page) = static_cast<uint16_t>(local_depth);
+    set_bucket_header(page, 0, BUCKET_HEADER_SIZE);
+    set_bucket_next(page, INVALID_PAGE_ID);
+    guard.mark_dirty();
+}
+
+// Adds the entry to this one page if it fits.
+bool HashIndex::append(PageGuard& guard, const Entry& entry) {
+    char* page = guard.data();
+    size_t used = bucket_used(page);
+    size_t size = entry_size(entry.key.size());
+    if (used + size > static_cast<size_t>(PAGE_SIZE)) return false;
+    uint16_t len = static_cast<uint16_t>(entry.key.size());
+    char* out = page + used;
+    memcpy(out, &entry.hash, 4);
+    memcpy(out + 4, &len, 2);
+    memcpy(out + 6, entry.key.data(), len);
+    memcpy(out + 6 + len, &entry.value, 8);
+    set_bucket_header(page, bucket_count(page) + 1, static_cast<uint16_t>(used + size));
+    guard.mark_dirty();
+    return true;
+}
+
+// New overflow pages go right behind the bucket page, so only the bucket
+// page and the newest overflow page can have room; neither walk is longer.
+bool HashIndex::append_to_bucket(PageGuard& bucket, const Entry& entry) {
+    if (append(bucket, entry)) return true;
+    int next = bucket_next(bucket.data());
+    if (next == INVALID_PAGE_ID) return false;
+    PageGuard overflow(buffer_pool, next);
+    return append(overflow, entry);
+}
+
+// Callers hold the meta page exclusively.
+void HashIndex::append_overflow(PageGuard& bucket, const Entry& entry) {
+    PageGuard overflow(buffer_pool, allocate_page());
+    init_page(overflow, 0);
+    set_bucket_next(overflow.data(), bucket_next(bucket.data()));
+    append(overflow, entry);
+    set_bucket_next(bucket.data(), overflow.page_id());
+    bucket.mark_dirty();
+}
+
+vector<HashIndex::Entry> HashIndex::read_chain(PageGuard& bucket) {
+    vector<Entry> entries;
+    auto read = [&entries](const char* page) {
+        const char* entry = page + BUCKET_HEADER_SIZE;
+        for (int i = 0; i < bucket_count(page); ++i) {
+            string_view key = entry_key(entry);
+            entries.push_back({entry_hash(entry), string(key), entry_value(entry)});
+            entry += entry_size(key.size());
+        }
+    };
+    read(bucket.data());
+    for (int next = bucket_next(bucket.data()); next != INVALID_PAGE_ID;) {
+        PageGuard overflow(buffer_pool, next, LatchMode::SHARED);
+        read(overflow.data());
+        next = bucket_next(overflow.data());
+    }
+    return entries;
+}
+
+// Splits the bucket `hash` maps to by the next hash bit, growing the
+// directory first if the bucket is already told apart by every bit it
+// has. Overflow pages are given back and the entries repacked. Callers
+// hold the meta page exclusively.
+void HashIndex::split(PageGuard& meta, PageGuard& bucket, uint32_t hash) {
+    int local = bucket_local_depth(bucket.data());
+    if (local == global_depth(meta)) grow_directory(meta);
+
+    vector<Entry> entries = read_chain(bucket);
+    for (int next = bucket_next(bucket.data()); next != INVALID_PAGE_ID;) {
+        int page_id = next;
+        {
+            PageGuard overflow(buffer_pool, page_id, LatchMode::SHARED);
+            next = bucket_next(overflow.data());
+        }
+        free_space_map.release_page(page_id);
+    }
+
+    PageGuard sibling(buffer_pool, allocate_page());
+    init_page(bucket, local + 1);
+    init_page(sibling, local + 1);
+    for (const Entry& entry : entries) {
+        PageGuard& target = (entry.hash >> local) & 1 ? sibling : bucket;
+        if (!append_to_bucket(target, entry)) append_overflow(target, entry);
+    }
+
+    uint32_t slots = 1u << global_depth(meta);
+    uint32_t low = hash & ((1u << local) - 1);
+    for (uint32_t slot = low | (1u << local); slot < slots; slot += 2u << local) {
+        set_slot(meta, slot, sibling.page_id());
+    }
+    LOG_TRACE(HASH, "Split bucket " << bucket.page_id() << " at depth " << local << " into " << sibling.page_id());
+}
+
+// Callers hold the meta page exclusively.
+void HashIndex::insert_exclusive(PageGuard& meta, const Entry& entry) {
+    while (true) {
+        PageGuard bucket(buffer_pool, bucket_for(meta, entry.hash));
+        if (append_to_bucket(bucket, entry)) return;
+        // Splitting helps only if some entry's hash differs from this one in
+        // a bit the directory can still grow to.
+        int local = bucket_local_depth(bucket.data());
+        bool separable = false;
+        if (local < MAX_GLOBAL_DEPTH) {
+            uint32_t mask = (1u << MAX_GLOBAL_DEPTH) - 1;
+            for (const Entry& other : read_chain(bucket)) {
+                if ((other.hash ^ entry.hash) & mask) {
+                    separable = true;
+                    break;
+                }
+            }
+        }
+        if (!separable) {
+            append_overflow(bucket, entry);
+            return;
+        }
+        split(meta, bucket, entry.hash);
+    }
+}
+
+// ---------- Public operations ----------
+
+void HashIndex::insert(const string& key, int64_t value) {
+    string stored = truncate_key(key);
+    Entry entry{hash_key(stored), stored, value};
+    {
+        // Fast path: the bucket has room and nothing but it changes.
+        PageGuard meta(buffer_pool, meta_page_id, LatchMode::SHARED);
+        if (change_noted(meta)) {
+            PageGuard bucket(buffer_pool, bucket_for(meta, entry.hash));
+            if (append_to_bucket(bucket, entry)) return;
+        }
+    }
+    PageGuard meta(buffer_pool, meta_page_id);
+    note_change(meta);
+    insert_exclusive(meta, entry);
+}
+
+// Entries are added in bit-reversed hash order, so those that share a
+// bucket (and its low hash bits) arrive one after another.
+void HashIndex::bulk_insert(const vector<pair<string, int64_t>>& entries) {
+    if (entries.empty()) return;
+    vector<Entry> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& [key, value] : entries) {
+        string stored = truncate_key(key);
+        uint32_t hash = hash_key(stored);
+        sorted.push_back({hash, std::move(stored), value});
+    }
+    sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+        return reverse_bits(a.hash) < reverse_bits(b.hash);
+    });
+
+    PageGuard meta(buffer_pool, meta_page_id);
+    note_change(meta);
+    for (const Entry& entry : sorted) insert_exclusive(meta, entry);
+    LOG_DEBUG(HASH, "Bulk inserted " << entries.size() << " entries into hash index " << meta_page_id
+                    << ", global depth " << global_depth(meta));
+}
+
+// An overflow page the removal empties is unlinked and given back.
+bool HashIndex::remove(const string& key, int64_t value) {
+    string stored = truncate_key(key);
+    uint32_t hash = hash_key(stored);
+    PageGuard meta(buffer_pool, meta_page_id, LatchMode::SHARED);
+    if (!change_noted(meta)) {
+        meta.release();
+        meta = PageGuard(buffer_pool, meta_page_id);
+        note_change(meta);
+    }
+
+    PageGuard previous;
+    PageGuard page(buffer_pool, bucket_for(meta, hash));
+    while (true) {
+        char* data = page.data();
+        char* entry = data + BUCKET_HEADER_SIZE;
+        for (int i = 0; i < bucket_count(data); ++i) {
+            size_t size = entry_size(entry_key(entry).size());
+            if (entry_hash(entry) == hash && entry_key(entry) == stored && entry_value(entry) == value) {
+                size_t used = bucket_used(data);
+                memmove(entry, entry + size, data + used - (entry + size));
+                set_bucket_header(data, bucket_count(data) - 1, static_cast<uint16_t>(used - size));
+                page.mark_dirty();
+                if (previous.valid() && bucket_count(data) == 0) {
+                    set_bucket_next(previous.data(), bucket_next(data));
+                    previous.mark_dirty();
+                    int page_id = page.page_id();
+                    page.release();
+                    free_space_map.release_page(page_id);
+                }
+                return true;
+            }
+            entry += size;
+        }
+        int next = bucket_next(data);
+        if (next == INVALID_PAGE_ID) return false;
+        PageGuard overflow(buffer_pool, next);
+        previous = std::move(page);
+        page = std::move(overflow);
+    }
+}
+
+vector<int64_t> HashIndex::search(const string& key) {
+    string stored = truncate_key(key);
+    uint32_t hash = hash_key(stored);
+    vector<int64_t> result;
+    PageGuard meta(buffer_pool, meta_page_id, LatchMode::SHARED);
+    PageGuard page(buffer_pool, bucket_for(meta, hash), LatchMode::SHARED);
+    while (true) {
+        const char* data = page.data();
+        const char* entry = data + BUCKET_HEADER_SIZE;
+        for (int i = 0; i < bucket_count(data); ++i) {
+            string_view entry_key_view = entry_key(entry);
+            if (entry_hash(entry) == hash && entry_key_view == stored) result.push_back(entry_value(entry));
+            entry += entry_size(entry_key_view.size());
+        }
+        int next = bucket_next(data);
+        if (next == INVALID_PAGE_ID) break;
+        PageGuard overflow(buffer_pool, next, LatchMode::SHARED);
+        page = std::move(overflow);
+    }
+    return result;
+}
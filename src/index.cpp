@@ -0,0 +1,63 @@
+#include "../include/index.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const int META_CHANGED_LSN_OFFSET = 8;
+
+} // namespace
+
+string index_type_to_string(IndexType type) {
+    return type == IndexType::HASH ? "HASH" : "BTREE";
+}
+
+IndexType string_to_index_type(const string& name) {
+    if (name == "BTREE") return IndexType::BTREE;
+    if (name == "HASH") return IndexType::HASH;
+    throw invalid_argument("Unknown index type: " + name);
+}
+
+Index::Index(BufferPoolManager& bpm, FreeSpaceMap& fsm, int segment, int meta_page)
+    : buffer_pool(bpm), free_space_map(fsm), segment_id(segment), meta_page_id(meta_page) {}
+
+string Index::truncate_key(const string& key) {
+    if (key.size() <= static_cast<size_t>(INDEX_MAX_KEY_SIZE)) return key;
+    return key.substr(0, INDEX_MAX_KEY_SIZE);
+}
+
+int Index::allocate_page() {
+    return free_space_map.allocate_page(segment_id);
+}
+
+bool Index::change_noted(const PageGuard& meta) const {
+    uint64_t changed_lsn;
+    memcpy(&changed_lsn, meta.data() + META_CHANGED_LSN_OFFSET, sizeof(changed_lsn));
+    return changed_lsn == buffer_pool.get_log_manager().get_start_lsn();
+}
+
+// The first change after a checkpoint stamps the meta page with the start
+// of the current log and makes that durable before any other page of this
+// stretch can reach the disk. Recovery then knows which indexes may be torn.
+void Index::note_change(PageGuard& meta) {
+    if (change_noted(meta)) return;
+    LogManager& log = buffer_pool.get_log_manager();
+    uint64_t start_lsn = log.get_start_lsn();
+    memcpy(meta.data() + META_CHANGED_LSN_OFFSET, &start_lsn, sizeof(start_lsn));
+    log.flush(meta.log_write(META_CHANGED_LSN_OFFSET, sizeof(start_lsn)));
+}
+
+bool Index::changed_since(uint64_t lsn) {
+    PageGuard meta(buffer_pool, meta_page_id, LatchMode::SHARED);
+    uint64_t changed_lsn;
+    memcpy(&changed_lsn, meta.data() + META_CHANGED_LSN_OFFSET, sizeof(changed_lsn));
+    return changed_lsn >= lsn;
+}
+
+vector<int64_t> Index::range_search(const string&, const string&) {
+    throw logic_error(index_type_to_string(type()) + " index does not support range search");
+}
+
+vector<int64_t> Index::range_search_from(const string&) {
+    throw logic_error(index_type_to_string(type()) + " index does not support range search");
+}
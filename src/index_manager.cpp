@@ -1,30 +1,99 @@
 #include "../include/index_manager.h"
-#include <iostream>
+#include "../include/btree.h"
+#include "../include/hash_index.h"
+#include "../include/logger.h"
 #include <algorithm>
+#include <mutex>
 
 using namespace std;
 
-#define DEBUG_INDEX_MANAGER(msg) cout << "[DEBUG][INDEX_MANAGER] " << msg << endl;
+#define DEBUG_INDEX_MANAGER(msg) LOG_DEBUG(INDEX, msg)
+#define TRACE_INDEX_MANAGER(msg) LOG_TRACE(INDEX, msg)
 
+namespace {
 
-// Create index
-bool IndexManager::create_index(const string& table_name, const string& column_name) {
-    DEBUG_INDEX_MANAGER("Creating index on table '" << table_name << "', column '" << column_name << "'");
-    indexes[table_name][column_name] = {}; // initialize empty index
-    DEBUG_INDEX_MANAGER("Index created successfully");
+// Keys are binary (see Value::index_key); show them as hex in debug output.
+string printable_key(const string& key) {
+    static const char* digits = "0123456789abcdef";
+    string out;
+    for (unsigned char c : key) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xF]);
+    }
+    return out;
+}
+
+} // namespace
+
+IndexManager::IndexManager(BufferPoolManager& bpm, FreeSpaceMap& fsm, uint64_t stale_lsn)
+    : buffer_pool(bpm), free_space_map(fsm), stale_lsn(stale_lsn) {}
+
+Index* IndexManager::find_index(const string& table_name, const string& column_name) {
+    auto table_it = indexes.find(table_name);
+    if (table_it == indexes.end()) return nullptr;
+    auto col_it = table_it->second.find(column_name);
+    if (col_it == table_it->second.end()) return nullptr;
+    return col_it->second.get();
+}
+
+unique_ptr<Index> IndexManager::make_index(IndexType type, int segment_id, int meta_page_id) {
+    if (type == IndexType::HASH) return make_unique<HashIndex>(buffer_pool, free_space_map, segment_id, meta_page_id);
+    return make_unique<BPlusTree>(buffer_pool, free_space_map, segment_id, meta_page_id);
+}
+
+// Create index. The index is filled before it is published, so concurrent
+// readers either do not see it yet or see all of it.
+bool IndexManager::create_index(const string& table_name, const string& column_name, const vector<pair<string, int64_t>>& entries, IndexType type) {
+    DEBUG_INDEX_MANAGER("Creating " << index_type_to_string(type) << " index on table '" << table_name << "', column '" << column_name << "' from " << entries.size() << " entries");
+    {
+        shared_lock<shared_mutex> lock(latch);
+        if (find_index(table_name, column_name)) {
+            DEBUG_INDEX_MANAGER("Index already exists");
+            return false;
+        }
+    }
+    int segment_id = free_space_map.allocate_segment();
+    int meta_page_id = type == IndexType::HASH ? HashIndex::create(buffer_pool, free_space_map, segment_id)
+                                               : BPlusTree::create(buffer_pool, free_space_map, segment_id);
+    unique_ptr<Index> index = make_index(type, segment_id, meta_page_id);
+    index->bulk_insert(entries);
+
+    unique_lock<shared_mutex> lock(latch);
+    indexes[table_name][column_name] = std::move(index);
+    DEBUG_INDEX_MANAGER("Index created successfully with meta page " << meta_page_id);
+    return true;
+}
+
+// Reopen an index persisted by an earlier run
+bool IndexManager::open_index(const string& table_name, const string& column_name, int meta_page_id, int segment_id, IndexType type) {
+    unique_lock<shared_mutex> lock(latch);
+    DEBUG_INDEX_MANAGER("Opening index on table '" << table_name << "', column '" << column_name << "' at meta page " << meta_page_id);
+    if (meta_page_id <= 0 || meta_page_id >= buffer_pool.get_num_pages() || segment_id < FIRST_TABLE_SEGMENT) {
+        DEBUG_INDEX_MANAGER("Invalid meta page " << meta_page_id << " or segment " << segment_id);
+        return false;
+    }
+    unique_ptr<Index> index = make_index(type, segment_id, meta_page_id);
+    if (stale_lsn > 0 && index->changed_since(stale_lsn)) {
+        DEBUG_INDEX_MANAGER("Index changed before the crash; it will be rebuilt");
+        stale.insert({table_name, column_name});
+    }
+    indexes[table_name][column_name] = std::move(index);
     return true;
 }
 
 // Drop index
 bool IndexManager::drop_index(const string& table_name, const string& column_name) {
+    unique_lock<shared_mutex> lock(latch);
     DEBUG_INDEX_MANAGER("Dropping index on table '" << table_name << "', column '" << column_name << "'");
-    
+
     // Declare iterator first
     auto table_it = indexes.find(table_name);
     if (table_it != indexes.end()) {
         auto col_it = table_it->second.find(column_name);  // Explicit declaration
         if (col_it != table_it->second.end()) {
+            free_space_map.release_segment(col_it->second->get_segment_id());
             table_it->second.erase(col_it);
+            stale.erase({table_name, column_name});
             if (table_it->second.empty()) {
                 indexes.erase(table_it);
             }
@@ -36,46 +105,104 @@ bool IndexManager::drop_index(const string& table_name, const string& column_nam
     return false;
 }
 
+bool IndexManager::has_index(const string& table_name, const string& column_name) {
+    shared_lock<shared_mutex> lock(latch);
+    return find_index(table_name, column_name) != nullptr;
+}
+
+bool IndexManager::has_ordered_index(const string& table_name, const string& column_name) {
+    shared_lock<shared_mutex> lock(latch);
+    Index* index = find_index(table_name, column_name);
+    return index && index->ordered();
+}
+
+int IndexManager::get_index_page(const string& table_name, const string& column_name) {
+    shared_lock<shared_mutex> lock(latch);
+    Index* index = find_index(table_name, column_name);
+    return index ? index->get_meta_page_id() : -1;
+}
+
+int IndexManager::get_index_segment(const string& table_name, const string& column_name) {
+    shared_lock<shared_mutex> lock(latch);
+    Index* index = find_index(table_name, column_name);
+    return index ? index->get_segment_id() : NO_SEGMENT;
+}
+
+vector<pair<string, string>> IndexManager::stale_indexes() {
+    shared_lock<shared_mutex> lock(latch);
+    return vector<pair<string, string>>(stale.begin(), stale.end());
+}
 
 // Insert entry
-bool IndexManager::insert_entry(const string& table_name, const string& column_name, const string& key, int record_id) {
-    DEBUG_INDEX_MANAGER("Inserting entry: table='" << table_name << "', column='" << column_name << "', key='" << key << "', record_id=" << record_id);
-    indexes[table_name][column_name][key].insert(record_id);
-    DEBUG_INDEX_MANAGER("Entry inserted successfully");
+bool IndexManager::insert_entry(const string& table_name, const string& column_name, const string& key, int64_t record_id) {
+    shared_lock<shared_mutex> lock(latch);
+    TRACE_INDEX_MANAGER("Inserting entry: table='" << table_name << "', column='" << column_name << "', key=" << printable_key(key) << ", record_id=" << record_id);
+    Index* index = find_index(table_name, column_name);
+    if (!index) {
+        TRACE_INDEX_MANAGER("No index on '" << table_name << "." << column_name << "'");
+        return false;
+    }
+    index->insert(key, record_id);
+    TRACE_INDEX_MANAGER("Entry inserted successfully");
     return true;
 }
 
-// Delete entry
-bool IndexManager::delete_entry(const string& table_name, const string& column_name, const string& key, int record_id) {
-    DEBUG_INDEX_MANAGER("Deleting entry: table='" << table_name << "', column='" << column_name << "', key='" << key << "', record_id=" << record_id);
-    auto& id_set = indexes[table_name][column_name][key];
-    id_set.erase(record_id);
-    if (id_set.empty()) {
-        indexes[table_name][column_name].erase(key);
-        DEBUG_INDEX_MANAGER("Key '" << key << "' erased from index as it became empty");
+// Insert a batch of entries
+bool IndexManager::insert_entries(const string& table_name, const string& column_name, const vector<pair<string, int64_t>>& entries) {
+    shared_lock<shared_mutex> lock(latch);
+    DEBUG_INDEX_MANAGER("Inserting " << entries.size() << " entries into '" << table_name << "." << column_name << "'");
+    Index* index = find_index(table_name, column_name);
+    if (!index) {
+        TRACE_INDEX_MANAGER("No index on '" << table_name << "." << column_name << "'");
+        return false;
     }
-    DEBUG_INDEX_MANAGER("Entry deleted successfully");
+    index->bulk_insert(entries);
     return true;
 }
 
+// Delete entry
+bool IndexManager::delete_entry(const string& table_name, const string& column_name, const string& key, int64_t record_id) {
+    shared_lock<shared_mutex> lock(latch);
+    TRACE_INDEX_MANAGER("Deleting entry: table='" << table_name << "', column='" << column_name << "', key=" << printable_key(key) << ", record_id=" << record_id);
+    Index* index = find_index(table_name, column_name);
+    if (!index) {
+        TRACE_INDEX_MANAGER("No index on '" << table_name << "." << column_name << "'");
+        return false;
+    }
+    bool removed = index->remove(key, record_id);
+    TRACE_INDEX_MANAGER((removed ? "Entry deleted successfully" : "Entry not found"));
+    return removed;
+}
+
 // Search by key
-vector<int> IndexManager::search(const string& table_name, const string& column_name, const string& key) {
-    DEBUG_INDEX_MANAGER("Searching for key '" << key << "' in table '" << table_name << "', column '" << column_name << "'");
-    vector<int> result;
-    auto& id_set = indexes[table_name][column_name][key];
-    result.assign(id_set.begin(), id_set.end());
-    DEBUG_INDEX_MANAGER("Search found " << result.size() << " record(s)");
+vector<int64_t> IndexManager::search(const string& table_name, const string& column_name, const string& key) {
+    shared_lock<shared_mutex> lock(latch);
+    TRACE_INDEX_MANAGER("Searching for key " << printable_key(key) << " in table '" << table_name << "', column '" << column_name << "'");
+    Index* index = find_index(table_name, column_name);
+    if (!index) return {};
+    vector<int64_t> result = index->search(key);
+    TRACE_INDEX_MANAGER("Search found " << result.size() << " record(s)");
     return result;
 }
 
 // Range search
-vector<int> IndexManager::range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key) {
-    DEBUG_INDEX_MANAGER("Range search: table='" << table_name << "', column='" << column_name << "', start_key='" << start_key << "', end_key='" << end_key << "'");
-    vector<int> result;
-    auto& col_index = indexes[table_name][column_name];
-    for (auto it = col_index.lower_bound(start_key); it != col_index.upper_bound(end_key); ++it) {
-        result.insert(result.end(), it->second.begin(), it->second.end());
-    }
-    DEBUG_INDEX_MANAGER("Range search found " << result.size() << " record(s)");
+vector<int64_t> IndexManager::range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key) {
+    shared_lock<shared_mutex> lock(latch);
+    TRACE_INDEX_MANAGER("Range search: table='" << table_name << "', column='" << column_name << "', start_key=" << printable_key(start_key) << ", end_key=" << printable_key(end_key));
+    Index* index = find_index(table_name, column_name);
+    if (!index) return {};
+    vector<int64_t> result = index->range_search(start_key, end_key);
+    TRACE_INDEX_MANAGER("Range search found " << result.size() << " record(s)");
+    return result;
+}
+
+// Open-ended range search
+vector<int64_t> IndexManager::range_search_from(const string& table_name, const string& column_name, const string& start_key) {
+    shared_lock<shared_mutex> lock(latch);
+    TRACE_INDEX_MANAGER("Range search from: table='" << table_name << "', column='" << column_name << "', start_key=" << printable_key(start_key));
+    Index* index = find_index(table_name, column_name);
+    if (!index) return {};
+    vector<int64_t> result = index->range_search_from(start_key);
+    TRACE_INDEX_MANAGER("Range search found " << result.size() << " record(s)");
     return result;
 }
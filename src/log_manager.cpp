@@ -0,0 +1,292 @@
+#include "../include/log_manager.h"
+#include "../include/logger.h"
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+const char LOG_MAGIC[8] = {'L', 'I', 'M', 'B', 'O', 'W', 'A', 'L'};
+
+uint32_t checksum(const char* data, size_t len) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void encode(const LogRecord& record, vector<char>& out) {
+    uint32_t size = LOG_RECORD_HEADER_SIZE + static_cast<uint32_t>(record.data.size());
+    size_t start = out.size();
+    out.resize(start + size);
+    char* p = out.data() + start;
+
+    uint8_t type = static_cast<uint8_t>(record.type);
+    uint8_t pad = 0;
+    uint16_t data_len = static_cast<uint16_t>(record.data.size());
+    memcpy(p, &size, 4);
+    memcpy(p + 8, &record.lsn, 8);
+    memcpy(p + 16, &type, 1);
+    memcpy(p + 17, &pad, 1);
+    memcpy(p + 18, &record.slot_id, 2);
+    memcpy(p + 20, &record.page_id, 4);
+    memcpy(p + 24, &record.offset, 2);
+    memcpy(p + 26, &data_len, 2);
+    if (data_len > 0) memcpy(p + LOG_RECORD_HEADER_SIZE, record.data.data(), data_len);
+
+    uint32_t sum = checksum(p + 8, size - 8);
+    memcpy(p + 4, &sum, 4);
+}
+
+// Decodes records from `bytes` (the file without its header). Returns the
+// length of the valid prefix; decoding stops at the first torn record.
+size_t decode_all(const vector<char>& bytes, vector<LogRecord>* out, uint64_t& last_lsn) {
+    size_t pos = 0;
+    while (pos + LOG_RECORD_HEADER_SIZE <= bytes.size()) {
+        const char* p = bytes.data() + pos;
+        uint32_t size, sum;
+        memcpy(&size, p, 4);
+        memcpy(&sum, p + 4, 4);
+        if (size < LOG_RECORD_HEADER_SIZE || pos + size > bytes.size()) break;
+        if (checksum(p + 8, size - 8) != sum) break;
+
+        LogRecord record;
+        uint8_t type;
+        uint16_t data_len;
+        memcpy(&record.lsn, p + 8, 8);
+        memcpy(&type, p + 16, 1);
+        memcpy(&record.slot_id, p + 18, 2);
+        memcpy(&record.page_id, p + 20, 4);
+        memcpy(&record.offset, p + 24, 2);
+        memcpy(&data_len, p + 26, 2);
+        if (LOG_RECORD_HEADER_SIZE + data_len != size) break;
+        record.type = static_cast<LogRecordType>(type);
+        record.data.assign(p + LOG_RECORD_HEADER_SIZE, p + size);
+
+        last_lsn = record.lsn;
+        if (out) out->push_back(move(record));
+        pos += size;
+    }
+    return pos;
+}
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+vector<char> read_file(int fd, size_t offset) {
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = static_cast<size_t>(st.st_size);
+    vector<char> bytes(size > offset ? size - offset : 0);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = pread(fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(offset + done));
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    bytes.resize(done);
+    return bytes;
+}
+
+} // namespace
+
+thread_local uint64_t LogManager::last_appended_lsn = 0;
+
+LogManager::LogManager(const string& filename)
+    : file_name(filename), fd(-1), stopping(false), start_lsn(1), next_lsn(1), buffered_lsn(0),
+      flush_requested(0), flushed_lsn(0), file_size(0), commit_count(0), sync_count(0) {
+    open_log();
+    flusher = thread(&LogManager::flush_loop, this);
+}
+
+LogManager::~LogManager() {
+    {
+        lock_guard<mutex> lock(latch);
+        stopping = true;
+    }
+    flush_needed.notify_one();
+    flusher.join();
+    close(fd);
+    LOG_DEBUG(WAL, "LogManager closed. commits=" << commit_count << ", syncs=" << sync_count);
+}
+
+void LogManager::write_file_header(int file, uint64_t start_lsn) {
+    char header[LOG_FILE_HEADER_SIZE];
+    memcpy(header, LOG_MAGIC, 8);
+    memcpy(header + 8, &start_lsn, 8);
+    if (pwrite(file, header, LOG_FILE_HEADER_SIZE, 0) != LOG_FILE_HEADER_SIZE || fdatasync(file) != 0) {
+        throw runtime_error("Failed to write log header");
+    }
+}
+
+void LogManager::open_log() {
+    fd = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR(WAL, "Cannot open " << file_name << ": " << strerror(errno));
+        throw runtime_error("Cannot open log file");
+    }
+
+    vector<char> header = read_file(fd, 0);
+    if (header.size() < static_cast<size_t>(LOG_FILE_HEADER_SIZE)) {
+        LOG_DEBUG(WAL, "Creating new log " << file_name);
+        write_file_header(fd, next_lsn);
+        file_size = LOG_FILE_HEADER_SIZE;
+    } else {
+        if (memcmp(header.data(), LOG_MAGIC, 8) != 0) {
+            LOG_ERROR(WAL, file_name << " is not a LimboDB log");
+            throw runtime_error("Invalid log file");
+        }
+        memcpy(&next_lsn, header.data() + 8, 8);
+        start_lsn = next_lsn;
+
+        uint64_t last_lsn = next_lsn - 1;
+        vector<char> body(header.begin() + LOG_FILE_HEADER_SIZE, header.end());
+        size_t valid = decode_all(body, nullptr, last_lsn);
+        if (valid < body.size()) {
+            LOG_WARN(WAL, "Discarding " << body.size() - valid << " bytes of torn log tail");
+            if (ftruncate(fd, LOG_FILE_HEADER_SIZE + valid) != 0 || fdatasync(fd) != 0) {
+                throw runtime_error("Failed to truncate torn log tail");
+            }
+        }
+        next_lsn = last_lsn + 1;
+        file_size = LOG_FILE_HEADER_SIZE + valid;
+    }
+
+    lseek(fd, static_cast<off_t>(file_size), SEEK_SET);
+    buffered_lsn = flushed_lsn = flush_requested = next_lsn - 1;
+    LOG_DEBUG(WAL, "Opened " << file_name << " (" << file_size << " bytes), next LSN " << next_lsn);
+}
+
+uint64_t LogManager::append(LogRecord& record) {
+    lock_guard<mutex> lock(latch);
+    record.lsn = next_lsn++;
+    encode(record, buffer);
+    buffered_lsn = record.lsn;
+    last_appended_lsn = record.lsn;
+    if (buffer.size() >= LOG_BUFFER_SIZE) {
+        // Let the flusher drain a full buffer without anyone waiting on it.
+        flush_requested = max(flush_requested, buffered_lsn);
+        flush_needed.notify_one();
+    }
+    return record.lsn;
+}
+
+// Group commit: every caller that asks for a flush while a write+sync is in
+// progress gets its records into the next batch, which is written with one
+// write() and made durable with one fdatasync().
+void LogManager::flush_loop() {
+    unique_lock<mutex> lock(latch);
+    while (true) {
+        flush_needed.wait(lock, [this] { return stopping || flush_requested > flushed_lsn; });
+        if (buffer.empty()) {
+            if (stopping) break;
+            flushed_lsn = buffered_lsn;
+            flush_done.notify_all();
+            continue;
+        }
+
+        vector<char> batch;
+        batch.swap(buffer);
+        uint64_t batch_lsn = buffered_lsn;
+        lock.unlock();
+
+        bool ok = write_all(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+        if (!ok) {
+            LOG_ERROR(WAL, "Log write failed: " << strerror(errno));
+            terminate(); // continuing would acknowledge commits that are not durable
+        }
+
+        lock.lock();
+        file_size += batch.size();
+        flushed_lsn = batch_lsn;
+        sync_count++;
+        flush_done.notify_all();
+    }
+}
+
+void LogManager::flush(uint64_t lsn) {
+    unique_lock<mutex> lock(latch);
+    if (lsn <= flushed_lsn) return;
+    if (lsn > buffered_lsn) lsn = buffered_lsn;
+    flush_requested = max(flush_requested, lsn);
+    flush_needed.notify_one();
+    flush_done.wait(lock, [this, lsn] { return flushed_lsn >= lsn; });
+}
+
+void LogManager::commit() {
+    {
+        lock_guard<mutex> lock(latch);
+        commit_count++;
+    }
+    flush(last_appended_lsn);
+}
+
+vector<LogRecord> LogManager::read_records() {
+    lock_guard<mutex> lock(latch);
+    vector<LogRecord> records;
+    uint64_t last_lsn = 0;
+    decode_all(read_file(fd, LOG_FILE_HEADER_SIZE), &records, last_lsn);
+    return records;
+}
+
+// The new, empty log is written next to the old one and renamed over it, so
+// a crash in the middle leaves one of the two complete files behind.
+void LogManager::truncate() {
+    flush(next_lsn - 1);
+
+    lock_guard<mutex> lock(latch);
+    string tmp_name = file_name + ".tmp";
+    int tmp_fd = open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tmp_fd < 0) {
+        LOG_ERROR(WAL, "Cannot create " << tmp_name << ": " << strerror(errno));
+        throw runtime_error("Cannot truncate log");
+    }
+    write_file_header(tmp_fd, next_lsn);
+    if (rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+        close(tmp_fd);
+        throw runtime_error("Cannot truncate log");
+    }
+    start_lsn = next_lsn;
+
+    size_t slash = file_name.find_last_of('/');
+    string dir = slash == string::npos ? "." : file_name.substr(0, slash);
+    int dir_fd = open(dir.c_str(), O_RDONLY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    close(fd);
+    fd = tmp_fd;
+    lseek(fd, LOG_FILE_HEADER_SIZE, SEEK_SET);
+    file_size = LOG_FILE_HEADER_SIZE;
+    LOG_DEBUG(WAL, "Log truncated, next LSN " << next_lsn);
+}
+
+bool LogManager::needs_checkpoint() {
+    lock_guard<mutex> lock(latch);
+    return file_size + buffer.size() >= LOG_CHECKPOINT_SIZE;
+}
+
+uint64_t LogManager::get_flushed_lsn() {
+    lock_guard<mutex> lock(latch);
+    return flushed_lsn;
+}
@@ -0,0 +1,182 @@
+#include "../include/logger.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t LOG_SINK_BUFFER_SIZE = 64 * 1024;
+const auto LOG_ASYNC_INTERVAL = chrono::milliseconds(100);
+
+const char* const LEVEL_NAMES[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+
+} // namespace
+
+Logger::Logger()
+    : level(static_cast<int>(LogLevel::INFO)), components(0xFFFFFFFFu), fd(STDERR_FILENO),
+      owns_fd(false), async(false), stopping(false) {
+    buffer.reserve(LOG_SINK_BUFFER_SIZE);
+}
+
+Logger::~Logger() {
+    stop_writer();
+    flush();
+    if (owns_fd) close(fd);
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+// Caller holds write_latch, so chunks reach the output in order.
+void Logger::write_out(const string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return; // nowhere left to report it
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+}
+
+void Logger::write(LogLevel message_level, LogComponent component, const string& message) {
+    bool flush_now = false;
+    {
+        lock_guard<mutex> lock(latch);
+        buffer += '[';
+        buffer += level_name(message_level);
+        buffer += "][";
+        buffer += component_name(component);
+        buffer += "] ";
+        buffer += message;
+        buffer += '\n';
+        bool full = buffer.size() >= LOG_SINK_BUFFER_SIZE;
+        if (async) {
+            if (full) flush_needed.notify_one();
+        } else {
+            flush_now = full || message_level >= LogLevel::ERROR;
+        }
+    }
+    if (flush_now) flush();
+}
+
+void Logger::flush() {
+    lock_guard<mutex> write_lock(write_latch);
+    string chunk;
+    {
+        lock_guard<mutex> lock(latch);
+        chunk.swap(buffer);
+        buffer.reserve(LOG_SINK_BUFFER_SIZE);
+    }
+    if (!chunk.empty()) write_out(chunk);
+}
+
+void Logger::writer_loop() {
+    unique_lock<mutex> lock(latch);
+    while (!stopping) {
+        flush_needed.wait_for(lock, LOG_ASYNC_INTERVAL, [this] {
+            return stopping || buffer.size() >= LOG_SINK_BUFFER_SIZE;
+        });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void Logger::stop_writer() {
+    {
+        lock_guard<mutex> lock(latch);
+        if (!writer.joinable()) return;
+        stopping = true;
+        async = false;
+    }
+    flush_needed.notify_one();
+    writer.join();
+    stopping = false;
+}
+
+void Logger::set_async(bool enable) {
+    if (!enable) {
+        stop_writer();
+        return;
+    }
+    lock_guard<mutex> lock(latch);
+    if (writer.joinable()) return;
+    async = true;
+    writer = thread(&Logger::writer_loop, this);
+}
+
+void Logger::set_output(const string& path) {
+    int new_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (new_fd < 0) {
+        throw runtime_error("Cannot open log output " + path + ": " + strerror(errno));
+    }
+    flush();
+    lock_guard<mutex> write_lock(write_latch);
+    if (owns_fd) close(fd);
+    fd = new_fd;
+    owns_fd = true;
+}
+
+void Logger::configure_from_environment() {
+    if (const char* name = getenv("LIMBODB_LOG_LEVEL")) {
+        LogLevel parsed;
+        if (parse_level(name, parsed)) {
+            set_level(parsed);
+        } else {
+            LOG_WARN(QUERY, "Ignoring unknown LIMBODB_LOG_LEVEL '" << name << "'");
+        }
+    }
+    if (const char* path = getenv("LIMBODB_LOG_FILE")) {
+        set_output(path);
+    }
+    if (const char* flag = getenv("LIMBODB_LOG_ASYNC")) {
+        set_async(strcmp(flag, "1") == 0);
+    }
+}
+
+const char* Logger::level_name(LogLevel level) {
+    return LEVEL_NAMES[static_cast<int>(level)];
+}
+
+const char* Logger::component_name(LogComponent component) {
+    switch (component) {
+    case LogComponent::DISK: return "DISK_MANAGER";
+    case LogComponent::BUFFER_POOL: return "BUFFER_POOL";
+    case LogComponent::WAL: return "LOG_MANAGER";
+    case LogComponent::RECOVERY: return "RECOVERY";
+    case LogComponent::FSM: return "FREE_SPACE_MAP";
+    case LogComponent::RECORD: return "RECORD_MANAGER";
+    case LogComponent::INDEX: return "INDEX_MANAGER";
+    case LogComponent::BTREE: return "BTREE";
+    case LogComponent::CATALOG: return "CATALOG_MANAGER";
+    case LogComponent::TABLE: return "TABLE_MANAGER";
+    case LogComponent::QUERY: return "QUERY";
+    case LogComponent::TXN: return "TRANSACTION";
+    case LogComponent::HASH: return "HASH_INDEX";
+    case LogComponent::COLUMN: return "COLUMN_STORE";
+    }
+    return "UNKNOWN";
+}
+
+bool Logger::parse_level(const string& name, LogLevel& out) {
+    for (int i = 0; i <= static_cast<int>(LogLevel::OFF); ++i) {
+        if (strcasecmp(name.c_str(), LEVEL_NAMES[i]) == 0) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
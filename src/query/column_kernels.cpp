@@ -0,0 +1,377 @@
+#include "../../include/query/column_kernels.h"
+#include "../../include/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIMBO_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Every comparison is written with < and > only, so integers behave as
+// usual and a NaN double compares like Value::compare says.
+template <CompareOp OP, typename T>
+inline bool test(T a, T b) {
+    if constexpr (OP == CompareOp::EQ) return !(a < b) && !(a > b);
+    if constexpr (OP == CompareOp::NE) return a < b || a > b;
+    if constexpr (OP == CompareOp::LT) return a < b;
+    if constexpr (OP == CompareOp::LE) return !(a > b);
+    if constexpr (OP == CompareOp::GT) return a > b;
+    return !(a < b);
+}
+
+// Calls f with the operator as a compile-time constant, so the kernels
+// carry no per-value branch on it.
+template <typename F>
+void with_op(CompareOp op, F&& f) {
+    switch (op) {
+    case CompareOp::EQ: f(integral_constant<CompareOp, CompareOp::EQ>()); break;
+    case CompareOp::NE: f(integral_constant<CompareOp, CompareOp::NE>()); break;
+    case CompareOp::LT: f(integral_constant<CompareOp, CompareOp::LT>()); break;
+    case CompareOp::LE: f(integral_constant<CompareOp, CompareOp::LE>()); break;
+    case CompareOp::GT: f(integral_constant<CompareOp, CompareOp::GT>()); break;
+    case CompareOp::GE: f(integral_constant<CompareOp, CompareOp::GE>()); break;
+    }
+}
+
+template <CompareOp OP, typename T>
+void compare_scalar(const T* values, size_t n, T operand, uint64_t* mask) {
+    for (size_t w = 0; w < mask_words(n); ++w) {
+        size_t end = min(n, (w + 1) * 64);
+        uint64_t bits = 0;
+        for (size_t i = w * 64; i < end; ++i) bits |= static_cast<uint64_t>(test<OP>(values[i], operand)) << (i % 64);
+        mask[w] = bits;
+    }
+}
+
+void lookup_scalar(const uint32_t* codes, size_t n, const int32_t* matches, uint64_t* mask) {
+    for (size_t w = 0; w < mask_words(n); ++w) {
+        size_t end = min(n, (w + 1) * 64);
+        uint64_t bits = 0;
+        for (size_t i = w * 64; i < end; ++i) bits |= static_cast<uint64_t>(matches[codes[i]] != 0) << (i % 64);
+        mask[w] = bits;
+    }
+}
+
+void visible_scalar(const TxnId* xmin, const TxnId* xmax, size_t n, TxnId horizon, uint64_t* mask) {
+    Snapshot snapshot{horizon};
+    for (size_t w = 0; w < mask_words(n); ++w) {
+        size_t end = min(n, (w + 1) * 64);
+        uint64_t bits = 0;
+        for (size_t i = w * 64; i < end; ++i) bits |= static_cast<uint64_t>(snapshot.sees(xmin[i], xmax[i])) << (i % 64);
+        mask[w] = bits;
+    }
+}
+
+#ifdef LIMBO_X86_KERNELS
+
+// Integer compares only come as == and >; the other operators swap the
+// operands or invert the result.
+template <CompareOp OP>
+constexpr bool inverted() {
+    return OP == CompareOp::NE || OP == CompareOp::LE || OP == CompareOp::GE;
+}
+
+// Whole 64-value words go through the vector loop, the rest through the
+// scalar one.
+
+template <CompareOp OP>
+__attribute__((target("avx2"))) void compare_int32_avx2(const int32_t* values, size_t n, int32_t operand, uint64_t* mask) {
+    const __m256i x = _mm256_set1_epi32(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64 + j * 8));
+            __m256i hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) hit = _mm256_cmpeq_epi32(v, x);
+            else if constexpr (OP == CompareOp::GT || OP == CompareOp::LE) hit = _mm256_cmpgt_epi32(v, x);
+            else hit = _mm256_cmpgt_epi32(x, v);
+            uint64_t lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+            if constexpr (inverted<OP>()) lanes ^= 0xFF;
+            bits |= lanes << (j * 8);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+template <CompareOp OP>
+__attribute__((target("avx2"))) void compare_int64_avx2(const int64_t* values, size_t n, int64_t operand, uint64_t* mask) {
+    const __m256i x = _mm256_set1_epi64x(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64 + j * 4));
+            __m256i hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) hit = _mm256_cmpeq_epi64(v, x);
+            else if constexpr (OP == CompareOp::GT || OP == CompareOp::LE) hit = _mm256_cmpgt_epi64(v, x);
+            else hit = _mm256_cmpgt_epi64(x, v);
+            uint64_t lanes = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+            if constexpr (inverted<OP>()) lanes ^= 0xF;
+            bits |= lanes << (j * 4);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+// Ordered compares are false for NaN, matching test().
+template <CompareOp OP>
+__attribute__((target("avx2"))) void compare_double_avx2(const double* values, size_t n, double operand, uint64_t* mask) {
+    const __m256d x = _mm256_set1_pd(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m256d v = _mm256_loadu_pd(values + w * 64 + j * 4);
+            __m256d hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) {
+                hit = _mm256_or_pd(_mm256_cmp_pd(v, x, _CMP_LT_OQ), _mm256_cmp_pd(v, x, _CMP_GT_OQ));
+            } else if constexpr (OP == CompareOp::LT || OP == CompareOp::GE) {
+                hit = _mm256_cmp_pd(v, x, _CMP_LT_OQ);
+            } else {
+                hit = _mm256_cmp_pd(v, x, _CMP_GT_OQ);
+            }
+            uint64_t lanes = static_cast<uint32_t>(_mm256_movemask_pd(hit));
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::LE || OP == CompareOp::GE) lanes ^= 0xF;
+            bits |= lanes << (j * 4);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+__attribute__((target("avx2"))) void lookup_avx2(const uint32_t* codes, size_t n, const int32_t* matches, uint64_t* mask) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + w * 64 + j * 8));
+            __m256i found = _mm256_i32gather_epi32(matches, index, 4);
+            __m256i miss = _mm256_cmpeq_epi32(found, zero);
+            uint64_t lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(miss))) ^ 0xFF;
+            bits |= lanes << (j * 8);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) lookup_scalar(codes + words * 64, n % 64, matches, mask + words);
+}
+
+// Transaction ids are unsigned; flipping the sign bit lets the signed
+// 64-bit compare order them.
+__attribute__((target("avx2"))) void visible_avx2(const TxnId* xmin, const TxnId* xmax, size_t n, TxnId horizon, uint64_t* mask) {
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i h = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(horizon)), sign);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m256i inserted = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xmin + w * 64 + j * 4));
+            __m256i deleted = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xmax + w * 64 + j * 4));
+            __m256i inserted_later = _mm256_cmpgt_epi64(_mm256_xor_si256(inserted, sign), h);
+            __m256i live = _mm256_or_si256(_mm256_cmpeq_epi64(deleted, zero),
+                                           _mm256_cmpgt_epi64(_mm256_xor_si256(deleted, sign), h));
+            __m256i seen = _mm256_andnot_si256(inserted_later, live);
+            bits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(seen)))) << (j * 4);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) visible_scalar(xmin + words * 64, xmax + words * 64, n % 64, horizon, mask + words);
+}
+
+template <CompareOp OP>
+__attribute__((target("sse4.2"))) void compare_int32_sse4(const int32_t* values, size_t n, int32_t operand, uint64_t* mask) {
+    const __m128i x = _mm_set1_epi32(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + w * 64 + j * 4));
+            __m128i hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) hit = _mm_cmpeq_epi32(v, x);
+            else if constexpr (OP == CompareOp::GT || OP == CompareOp::LE) hit = _mm_cmpgt_epi32(v, x);
+            else hit = _mm_cmpgt_epi32(x, v);
+            uint64_t lanes = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(hit)));
+            if constexpr (inverted<OP>()) lanes ^= 0xF;
+            bits |= lanes << (j * 4);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+template <CompareOp OP>
+__attribute__((target("sse4.2"))) void compare_int64_sse4(const int64_t* values, size_t n, int64_t operand, uint64_t* mask) {
+    const __m128i x = _mm_set1_epi64x(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 32; ++j) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + w * 64 + j * 2));
+            __m128i hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) hit = _mm_cmpeq_epi64(v, x);
+            else if constexpr (OP == CompareOp::GT || OP == CompareOp::LE) hit = _mm_cmpgt_epi64(v, x);
+            else hit = _mm_cmpgt_epi64(x, v);
+            uint64_t lanes = static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(hit)));
+            if constexpr (inverted<OP>()) lanes ^= 0x3;
+            bits |= lanes << (j * 2);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+template <CompareOp OP>
+__attribute__((target("sse4.2"))) void compare_double_sse4(const double* values, size_t n, double operand, uint64_t* mask) {
+    const __m128d x = _mm_set1_pd(operand);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 32; ++j) {
+            __m128d v = _mm_loadu_pd(values + w * 64 + j * 2);
+            __m128d hit;
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::NE) hit = _mm_or_pd(_mm_cmplt_pd(v, x), _mm_cmpgt_pd(v, x));
+            else if constexpr (OP == CompareOp::LT || OP == CompareOp::GE) hit = _mm_cmplt_pd(v, x);
+            else hit = _mm_cmpgt_pd(v, x);
+            uint64_t lanes = static_cast<uint32_t>(_mm_movemask_pd(hit));
+            if constexpr (OP == CompareOp::EQ || OP == CompareOp::LE || OP == CompareOp::GE) lanes ^= 0x3;
+            bits |= lanes << (j * 2);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) compare_scalar<OP>(values + words * 64, n % 64, operand, mask + words);
+}
+
+__attribute__((target("sse4.2"))) void visible_sse4(const TxnId* xmin, const TxnId* xmax, size_t n, TxnId horizon, uint64_t* mask) {
+    const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+    const __m128i h = _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(horizon)), sign);
+    const __m128i zero = _mm_setzero_si128();
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 32; ++j) {
+            __m128i inserted = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xmin + w * 64 + j * 2));
+            __m128i deleted = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xmax + w * 64 + j * 2));
+            __m128i inserted_later = _mm_cmpgt_epi64(_mm_xor_si128(inserted, sign), h);
+            __m128i live = _mm_or_si128(_mm_cmpeq_epi64(deleted, zero), _mm_cmpgt_epi64(_mm_xor_si128(deleted, sign), h));
+            __m128i seen = _mm_andnot_si128(inserted_later, live);
+            bits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(seen)))) << (j * 2);
+        }
+        mask[w] = bits;
+    }
+    if (n % 64) visible_scalar(xmin + words * 64, xmax + words * 64, n % 64, horizon, mask + words);
+}
+
+#endif // LIMBO_X86_KERNELS
+
+SimdLevel detect_simd_level() {
+    SimdLevel level = SimdLevel::SCALAR;
+#ifdef LIMBO_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        level = SimdLevel::AVX2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        level = SimdLevel::SSE4;
+    }
+#endif
+    if (const char* value = getenv("LIMBODB_SIMD")) {
+        string name = value;
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+        if (name == "scalar") level = SimdLevel::SCALAR;
+        else if (name == "sse4") level = min(level, SimdLevel::SSE4);
+    }
+    LOG_DEBUG(QUERY, "Column filter kernels use " << simd_level_name(level));
+    return level;
+}
+
+} // namespace
+
+SimdLevel simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE4: return "SSE4.2";
+    case SimdLevel::SCALAR: return "scalar code";
+    }
+    return "?";
+}
+
+void compare_int32(const int32_t* values, size_t n, CompareOp op, int32_t operand, uint64_t* mask) {
+    with_op(op, [&](auto constant) {
+        constexpr CompareOp OP = decltype(constant)::value;
+#ifdef LIMBO_X86_KERNELS
+        switch (simd_level()) {
+        case SimdLevel::AVX2: return compare_int32_avx2<OP>(values, n, operand, mask);
+        case SimdLevel::SSE4: return compare_int32_sse4<OP>(values, n, operand, mask);
+        case SimdLevel::SCALAR: break;
+        }
+#endif
+        compare_scalar<OP>(values, n, operand, mask);
+    });
+}
+
+void compare_int64(const int64_t* values, size_t n, CompareOp op, int64_t operand, uint64_t* mask) {
+    with_op(op, [&](auto constant) {
+        constexpr CompareOp OP = decltype(constant)::value;
+#ifdef LIMBO_X86_KERNELS
+        switch (simd_level()) {
+        case SimdLevel::AVX2: return compare_int64_avx2<OP>(values, n, operand, mask);
+        case SimdLevel::SSE4: return compare_int64_sse4<OP>(values, n, operand, mask);
+        case SimdLevel::SCALAR: break;
+        }
+#endif
+        compare_scalar<OP>(values, n, operand, mask);
+    });
+}
+
+void compare_double(const double* values, size_t n, CompareOp op, double operand, uint64_t* mask) {
+    with_op(op, [&](auto constant) {
+        constexpr CompareOp OP = decltype(constant)::value;
+#ifdef LIMBO_X86_KERNELS
+        switch (simd_level()) {
+        case SimdLevel::AVX2: return compare_double_avx2<OP>(values, n, operand, mask);
+        case SimdLevel::SSE4: return compare_double_sse4<OP>(values, n, operand, mask);
+        case SimdLevel::SCALAR: break;
+        }
+#endif
+        compare_scalar<OP>(values, n, operand, mask);
+    });
+}
+
+// BOOL columns are rarely filtered on hot paths; one loop serves every level.
+void compare_uint8(const uint8_t* values, size_t n, CompareOp op, uint8_t operand, uint64_t* mask) {
+    with_op(op, [&](auto constant) { compare_scalar<decltype(constant)::value>(values, n, operand, mask); });
+}
+
+void lookup_codes(const uint32_t* codes, size_t n, const int32_t* matches, uint64_t* mask) {
+#ifdef LIMBO_X86_KERNELS
+    if (simd_level() == SimdLevel::AVX2) return lookup_avx2(codes, n, matches, mask);
+#endif
+    lookup_scalar(codes, n, matches, mask);
+}
+
+void visible_versions(const TxnId* xmin, const TxnId* xmax, size_t n, TxnId horizon, uint64_t* mask) {
+#ifdef LIMBO_X86_KERNELS
+    switch (simd_level()) {
+    case SimdLevel::AVX2: return visible_avx2(xmin, xmax, n, horizon, mask);
+    case SimdLevel::SSE4: return visible_sse4(xmin, xmax, n, horizon, mask);
+    case SimdLevel::SCALAR: break;
+    }
+#endif
+    visible_scalar(xmin, xmax, n, horizon, mask);
+}
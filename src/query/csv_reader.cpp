@@ -0,0 +1,73 @@
+#include "../../include/query/csv_reader.h"
+#include <cctype>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const size_t CSV_READ_BUFFER = 1 << 20;
+
+bool is_null_text(const string& text) {
+    return text.empty() || (text.size() == 4 && toupper(text[0]) == 'N' && toupper(text[1]) == 'U' &&
+                            toupper(text[2]) == 'L' && toupper(text[3]) == 'L');
+}
+
+} // namespace
+
+CsvReader::CsvReader(const string& path) : buffer(CSV_READ_BUFFER) {
+    in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    in.open(path);
+    if (!in) throw runtime_error("Cannot open '" + path + "'");
+}
+
+bool CsvReader::next_row(vector<Literal>& row) {
+    row.clear();
+    string text;
+    do {
+        if (!getline(in, text)) return false;
+        ++line;
+    } while (text.empty() || text == "\r");
+    start_line = line;
+
+    Literal field;
+    bool in_quotes = false;
+    size_t i = 0;
+    while (true) {
+        if (i == text.size()) {
+            if (!in_quotes) break;
+            // A quoted field continues on the next line.
+            if (!getline(in, text)) {
+                throw invalid_argument("Unterminated quoted field starting on line " + to_string(start_line));
+            }
+            ++line;
+            field.text.push_back('\n');
+            i = 0;
+            continue;
+        }
+
+        char c = text[i++];
+        if (in_quotes) {
+            if (c != '"') {
+                field.text.push_back(c);
+            } else if (i < text.size() && text[i] == '"') {
+                field.text.push_back('"');
+                ++i;
+            } else {
+                in_quotes = false;
+            }
+        } else if (c == '"') {
+            in_quotes = true;
+            field.quoted = true;
+        } else if (c == ',') {
+            if (!field.quoted && is_null_text(field.text)) field.text = "NULL";
+            row.push_back(std::move(field));
+            field = Literal();
+        } else if (c != '\r' || i != text.size()) {
+            field.text.push_back(c);
+        }
+    }
+    if (!field.quoted && is_null_text(field.text)) field.text = "NULL";
+    row.push_back(std::move(field));
+    return true;
+}
@@ -0,0 +1,1073 @@
+#include "../../include/query/executor.h"
+#include "../../include/query/expression.h"
+#include "../../include/query/column_kernels.h"
+#include "../../include/logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+using namespace std;
+
+SeqScan::SeqScan(RecordManager& rm, const TableSchema& table_schema, shared_ptr<const Snapshot> read_snapshot,
+                 vector<bool> used_columns)
+    : record_manager(rm), schema(table_schema), layout(table_schema.columns), snapshot(move(read_snapshot)),
+      columns(move(used_columns)) {}
+
+void SeqScan::open() {
+    record_manager.get_buffer_pool().advise(AccessPattern::SEQUENTIAL);
+    iterator = make_unique<RecordIterator>(record_manager, schema.segment_id, snapshot.get());
+}
+
+bool SeqScan::next(Tuple& out) {
+    if (!iterator || !iterator->has_next()) return false;
+    auto [rec, page_id, slot_id] = iterator->next_with_location();
+    if (page_id < 0) return false; // the remaining rows were deleted meanwhile
+    out.values = record_manager.decode_row(layout, rec.data.data(), columns.empty() ? nullptr : &columns);
+    out.record_id = RecordID(page_id, slot_id).encode();
+    return true;
+}
+
+void SeqScan::close() {
+    iterator.reset();
+    record_manager.get_buffer_pool().advise(AccessPattern::NORMAL);
+}
+
+IndexScan::IndexScan(RecordManager& rm, IndexManager& im, const TableSchema& table_schema,
+                     shared_ptr<const Snapshot> read_snapshot, vector<IndexProbe> index_probes, vector<bool> used_columns)
+    : record_manager(rm), index_manager(im), schema(table_schema), layout(table_schema.columns),
+      snapshot(move(read_snapshot)), probes(move(index_probes)), columns(move(used_columns)) {}
+
+void IndexScan::open() {
+    record_manager.get_buffer_pool().advise(AccessPattern::RANDOM);
+    record_ids.clear();
+    cursor = 0;
+    for (const auto& probe : probes) {
+        vector<int64_t> found;
+        if (probe.column.empty()) {
+            if (record_manager.has_record(schema.segment_id, probe.record_id)) found.push_back(probe.record_id);
+        } else if (probe.exact) {
+            found = index_manager.search(schema.table_name, probe.column, probe.low_key);
+        } else if (probe.has_high) {
+            found = index_manager.range_search(schema.table_name, probe.column, probe.low_key, probe.high_key);
+        } else {
+            found = index_manager.range_search_from(schema.table_name, probe.column, probe.low_key);
+        }
+        record_ids.insert(record_ids.end(), found.begin(), found.end());
+    }
+    // Heap order keeps page accesses sequential; OR-ed probes may overlap.
+    sort(record_ids.begin(), record_ids.end());
+    record_ids.erase(unique(record_ids.begin(), record_ids.end()), record_ids.end());
+}
+
+bool IndexScan::next(Tuple& out) {
+    while (cursor < record_ids.size()) {
+        int64_t record_id = record_ids[cursor++];
+        if (!record_manager.get_record(schema.segment_id, record_id, *snapshot, row)) continue;
+        out.values = record_manager.decode_row(layout, row.data(), columns.empty() ? nullptr : &columns);
+        out.record_id = record_id;
+        return true;
+    }
+    return false;
+}
+
+void IndexScan::close() {
+    record_ids.clear();
+    record_ids.shrink_to_fit();
+    cursor = 0;
+    record_manager.get_buffer_pool().advise(AccessPattern::NORMAL);
+}
+
+size_t parallel_scan_threads() {
+    static const size_t threads = [] {
+        if (const char* value = getenv("LIMBODB_SCAN_THREADS")) {
+            int parsed = atoi(value);
+            if (parsed > 0) return static_cast<size_t>(parsed);
+        }
+        unsigned hardware = thread::hardware_concurrency();
+        return static_cast<size_t>(hardware > 0 ? hardware : 1);
+    }();
+    return threads;
+}
+
+ParallelScan::ParallelScan(RecordManager& rm, const TableSchema& table_schema, shared_ptr<const Snapshot> read_snapshot,
+                           const Expr* where, size_t threads, vector<bool> used_columns)
+    : record_manager(rm), schema(table_schema), layout(table_schema.columns), snapshot(move(read_snapshot)),
+      columns(move(used_columns)), predicate(where), thread_count(max<size_t>(threads, 1)) {}
+
+void ParallelScan::open() {
+    close();
+    pages = record_manager.get_segment_pages(schema.segment_id);
+    morsels = vector<Morsel>((pages.size() + MORSEL_PAGES - 1) / MORSEL_PAGES);
+    next_morsel = current = row = 0;
+    current_ready = false;
+    stopping = false;
+    failure = nullptr;
+
+    record_manager.get_buffer_pool().advise(AccessPattern::SEQUENTIAL);
+    size_t count = min(thread_count, morsels.size());
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back(&ParallelScan::worker_loop, this);
+    }
+    LOG_DEBUG(QUERY, "Parallel scan of '" << schema.table_name << "': " << pages.size() << " pages in "
+                                          << morsels.size() << " morsels on " << count << " threads");
+}
+
+void ParallelScan::worker_loop() {
+    unique_lock<mutex> lock(latch);
+    while (true) {
+        window_moved.wait(lock, [this] {
+            return stopping || next_morsel >= morsels.size() || next_morsel < current + PARALLEL_SCAN_WINDOW;
+        });
+        if (stopping || next_morsel >= morsels.size()) return;
+        size_t index = next_morsel++;
+
+        lock.unlock();
+        vector<Tuple> rows;
+        try {
+            scan_morsel(index, rows);
+        } catch (...) {
+            lock.lock();
+            if (!failure) failure = current_exception();
+            stopping = true;
+            morsel_done.notify_all();
+            window_moved.notify_all();
+            return;
+        }
+        lock.lock();
+
+        morsels[index].rows = move(rows);
+        morsels[index].done = true;
+        morsel_done.notify_all();
+    }
+}
+
+void ParallelScan::scan_morsel(size_t index, vector<Tuple>& out) {
+    BufferPoolManager& buffer_pool = record_manager.get_buffer_pool();
+    size_t first = index * MORSEL_PAGES;
+    size_t last = min(pages.size(), first + MORSEL_PAGES);
+    for (size_t i = first + 1; i < last; ++i) buffer_pool.prefetch(pages[i]);
+
+    const vector<bool>* mask = columns.empty() ? nullptr : &columns;
+    Tuple tuple;
+    for (size_t i = first; i < last; ++i) {
+        PageGuard page(buffer_pool, pages[i], LatchMode::SHARED);
+        const char* data = page.data();
+        uint16_t slot_count = reinterpret_cast<const uint16_t*>(data)[0];
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(data + HEADER_SIZE + slot_id * SLOT_SIZE);
+            if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) continue;
+            if (!snapshot->sees(data + slot_entry[0])) continue;
+
+            tuple.values = record_manager.decode_row(layout, data + slot_entry[0] + VERSION_HEADER_SIZE, mask);
+            tuple.record_id = RecordID(pages[i], slot_id).encode();
+            if (!predicate || predicate->evaluate(tuple)) out.push_back(move(tuple));
+        }
+    }
+}
+
+bool ParallelScan::next(Tuple& out) {
+    while (current < morsels.size()) {
+        if (!current_ready) {
+            unique_lock<mutex> lock(latch);
+            morsel_done.wait(lock, [this] { return morsels[current].done || failure; });
+            if (failure) rethrow_exception(failure);
+            current_ready = true;
+        }
+
+        // A finished morsel is no longer touched by the workers.
+        Morsel& morsel = morsels[current];
+        if (row < morsel.rows.size()) {
+            out = move(morsel.rows[row++]);
+            return true;
+        }
+        vector<Tuple>().swap(morsel.rows);
+        {
+            lock_guard<mutex> lock(latch);
+            current++;
+        }
+        current_ready = false;
+        row = 0;
+        window_moved.notify_all();
+    }
+    return false;
+}
+
+void ParallelScan::close() {
+    if (workers.empty()) return;
+    {
+        lock_guard<mutex> lock(latch);
+        stopping = true;
+    }
+    window_moved.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+    morsels.clear();
+    pages.clear();
+    record_manager.get_buffer_pool().advise(AccessPattern::NORMAL);
+}
+
+ColumnScan::ColumnScan(shared_ptr<ColumnTable> column_table, const TableSchema& table_schema,
+                       shared_ptr<const Snapshot> read_snapshot, const Expr* where, vector<bool> used_columns)
+    : table(move(column_table)), schema(table_schema), snapshot(move(read_snapshot)), predicate(where),
+      columns(move(used_columns)) {
+    if (columns.empty()) columns.assign(schema.columns.size(), true);
+    if (predicate) predicate->mark_columns(columns);
+    for (size_t c = 0; c < columns.size(); ++c) {
+        if (columns[c] && schema.columns[c].type == TypeId::VARCHAR) has_strings = true;
+    }
+}
+
+void ColumnScan::open() {
+    row_count = table->row_count();
+    next_row = batch_first = 0;
+    batch_rows = cursor = 0;
+    size_t words = mask_words(COLUMN_SCAN_BATCH);
+    values.assign(columns.size(), {});
+    nulls.assign(columns.size(), {});
+    for (size_t c = 0; c < columns.size(); ++c) {
+        if (!columns[c]) continue;
+        values[c].resize(COLUMN_SCAN_BATCH * ColumnTable::value_width(schema.columns[c].type));
+        nulls[c].resize(words);
+    }
+    xmin.resize(COLUMN_SCAN_BATCH);
+    xmax.resize(COLUMN_SCAN_BATCH);
+    row_numbers.resize(COLUMN_SCAN_BATCH);
+    selected.resize(words);
+    match_tables.clear();
+    LOG_DEBUG(QUERY, "Column scan of '" << schema.table_name << "': " << row_count << " rows, filter kernels use "
+                                        << simd_level_name(simd_level()));
+}
+
+// Columns are only read for batches with a visible row.
+bool ColumnScan::load_batch() {
+    if (next_row >= row_count) return false;
+    batch_first = next_row;
+    batch_rows = static_cast<size_t>(min<uint64_t>(COLUMN_SCAN_BATCH, row_count - next_row));
+    next_row += batch_rows;
+    cursor = 0;
+
+    size_t words = mask_words(batch_rows);
+    vector<uint64_t> version_nulls(words);
+    table->read(table->xmin_column(), batch_first, batch_rows, reinterpret_cast<char*>(xmin.data()), version_nulls.data());
+    table->read(table->xmax_column(), batch_first, batch_rows, reinterpret_cast<char*>(xmax.data()), version_nulls.data());
+    visible_versions(xmin.data(), xmax.data(), batch_rows, snapshot->horizon, selected.data());
+    if (all_of(selected.begin(), selected.begin() + words, [](uint64_t word) { return word == 0; })) return true;
+
+    for (size_t c = 0; c < columns.size(); ++c) {
+        if (columns[c]) table->read(c, batch_first, batch_rows, values[c].data(), nulls[c].data());
+    }
+    if (predicate) {
+        iota(row_numbers.begin(), row_numbers.begin() + batch_rows, static_cast<int64_t>(batch_first));
+        vector<uint64_t> matched(words);
+        evaluate(*predicate, matched.data());
+        for (size_t w = 0; w < words; ++w) selected[w] &= matched[w];
+    }
+    return true;
+}
+
+// Masks may have stray bits past the batch; the visibility mask they are
+// finally combined with has none.
+void ColumnScan::evaluate(const Expr& expr, uint64_t* mask) {
+    size_t words = mask_words(batch_rows);
+    if (expr.kind == Expr::Kind::AND || expr.kind == Expr::Kind::OR) {
+        evaluate(*expr.left, mask);
+        bool none = all_of(mask, mask + words, [](uint64_t word) { return word == 0; });
+        if (expr.kind == Expr::Kind::AND && none) return;
+        vector<uint64_t> right(words);
+        evaluate(*expr.right, right.data());
+        for (size_t w = 0; w < words; ++w) {
+            mask[w] = expr.kind == Expr::Kind::AND ? mask[w] & right[w] : mask[w] | right[w];
+        }
+        return;
+    }
+
+    bool by_code = expr.column_index >= 0 && schema.columns[expr.column_index].type == TypeId::VARCHAR;
+    if (by_code && !(expr.kind == Expr::Kind::COMPARE && (expr.op == CompareOp::EQ || expr.op == CompareOp::NE))) {
+        const vector<int32_t>& matches = match_table(expr);
+        lookup_codes(reinterpret_cast<const uint32_t*>(values[expr.column_index].data()), batch_rows, matches.data(), mask);
+    } else if (expr.kind == Expr::Kind::COMPARE) {
+        compare(expr, expr.op, expr.values[0], mask);
+    } else if (expr.kind == Expr::Kind::BETWEEN) {
+        vector<uint64_t> upper(words);
+        compare(expr, CompareOp::GE, expr.values[0], mask);
+        compare(expr, CompareOp::LE, expr.values[1], upper.data());
+        for (size_t w = 0; w < words; ++w) mask[w] &= upper[w];
+    } else {
+        vector<uint64_t> candidate(words);
+        fill(mask, mask + words, 0);
+        for (const auto& value : expr.values) {
+            compare(expr, CompareOp::EQ, value, candidate.data());
+            for (size_t w = 0; w < words; ++w) mask[w] |= candidate[w];
+        }
+    }
+
+    if (expr.column_index >= 0) {
+        const vector<uint64_t>& column_nulls = nulls[expr.column_index];
+        for (size_t w = 0; w < words; ++w) mask[w] &= ~column_nulls[w];
+    }
+}
+
+void ColumnScan::compare(const Expr& expr, CompareOp op, const Value& operand, uint64_t* mask) {
+    size_t words = mask_words(batch_rows);
+    if (operand.is_null) {
+        fill(mask, mask + words, 0);
+        return;
+    }
+    if (expr.column_index < 0) {
+        compare_int64(row_numbers.data(), batch_rows, op, operand.int_value, mask);
+        return;
+    }
+
+    const char* data = values[expr.column_index].data();
+    switch (schema.columns[expr.column_index].type) {
+    case TypeId::INT:
+        compare_int32(reinterpret_cast<const int32_t*>(data), batch_rows, op, static_cast<int32_t>(operand.int_value), mask);
+        break;
+    case TypeId::BIGINT:
+        compare_int64(reinterpret_cast<const int64_t*>(data), batch_rows, op, operand.int_value, mask);
+        break;
+    case TypeId::DOUBLE:
+        compare_double(reinterpret_cast<const double*>(data), batch_rows, op, operand.double_value, mask);
+        break;
+    case TypeId::BOOL:
+        compare_uint8(reinterpret_cast<const uint8_t*>(data), batch_rows, op, operand.int_value ? 1 : 0, mask);
+        break;
+    case TypeId::VARCHAR: {
+        // = and <> only: a string without a code occurs in no row.
+        uint32_t code;
+        bool found;
+        {
+            auto lock = table->read_lock();
+            found = table->find_code(expr.column_index, operand.string_value, code);
+        }
+        if (found) {
+            compare_int32(reinterpret_cast<const int32_t*>(data), batch_rows, op, static_cast<int32_t>(code), mask);
+        } else {
+            fill(mask, mask + words, op == CompareOp::NE ? ~0ULL : 0);
+        }
+        break;
+    }
+    }
+}
+
+// Built on first use from the dictionary as it is then, which covers every
+// code the rows read by this scan can hold.
+const vector<int32_t>& ColumnScan::match_table(const Expr& expr) {
+    auto it = match_tables.find(&expr);
+    if (it != match_tables.end()) return it->second;
+
+    vector<int32_t> matches;
+    Tuple probe;
+    probe.values.assign(schema.columns.size(), Value());
+    auto lock = table->read_lock();
+    size_t size = table->dictionary_size(expr.column_index);
+    matches.reserve(size);
+    for (size_t code = 0; code < size; ++code) {
+        probe.values[expr.column_index] = Value::make_string(table->dictionary_entry(expr.column_index, static_cast<uint32_t>(code)));
+        matches.push_back(expr.evaluate(probe) ? 1 : 0);
+    }
+    return match_tables.emplace(&expr, move(matches)).first->second;
+}
+
+bool ColumnScan::next(Tuple& out) {
+    while (true) {
+        while (cursor < batch_rows) {
+            uint64_t bits = selected[cursor / 64] >> (cursor % 64);
+            if (bits == 0) {
+                cursor = (cursor / 64 + 1) * 64;
+                continue;
+            }
+            cursor += __builtin_ctzll(bits);
+            if (cursor >= batch_rows) break;
+
+            size_t row = cursor++;
+            shared_lock<shared_mutex> lock;
+            if (has_strings) lock = table->read_lock();
+            out.values.resize(columns.size());
+            for (size_t c = 0; c < columns.size(); ++c) {
+                TypeId type = schema.columns[c].type;
+                if (!columns[c] || (nulls[c][row / 64] >> (row % 64) & 1)) {
+                    out.values[c] = Value::make_null(type);
+                    continue;
+                }
+                const char* at = values[c].data() + row * ColumnTable::value_width(type);
+                switch (type) {
+                case TypeId::INT: {
+                    int32_t v;
+                    memcpy(&v, at, sizeof(v));
+                    out.values[c] = Value::make_int(v);
+                    break;
+                }
+                case TypeId::BIGINT: {
+                    int64_t v;
+                    memcpy(&v, at, sizeof(v));
+                    out.values[c] = Value::make_int(v, TypeId::BIGINT);
+                    break;
+                }
+                case TypeId::DOUBLE: {
+                    double v;
+                    memcpy(&v, at, sizeof(v));
+                    out.values[c] = Value::make_double(v);
+                    break;
+                }
+                case TypeId::BOOL:
+                    out.values[c] = Value::make_bool(*at != 0);
+                    break;
+                case TypeId::VARCHAR: {
+                    uint32_t code;
+                    memcpy(&code, at, sizeof(code));
+                    out.values[c] = Value::make_string(table->dictionary_entry(c, code));
+                    break;
+                }
+                }
+            }
+            out.record_id = static_cast<int64_t>(batch_first + row);
+            return true;
+        }
+        if (!load_batch()) return false;
+    }
+}
+
+void ColumnScan::close() {
+    values.clear();
+    nulls.clear();
+    match_tables.clear();
+    batch_rows = cursor = 0;
+    next_row = row_count;
+}
+
+Filter::Filter(unique_ptr<Operator> input, const Expr* where) : child(move(input)), predicate(where) {}
+
+bool Filter::next(Tuple& out) {
+    while (child->next(out)) {
+        if (!predicate || predicate->evaluate(out)) return true;
+    }
+    return false;
+}
+
+Projection::Projection(unique_ptr<Operator> input_operator, vector<int> indexes)
+    : child(move(input_operator)), column_indexes(move(indexes)) {
+    for (int index : column_indexes) {
+        columns.push_back(child->output_columns()[index]);
+    }
+}
+
+bool Projection::next(Tuple& out) {
+    if (!child->next(input)) return false;
+    out.values.resize(column_indexes.size());
+    for (size_t i = 0; i < column_indexes.size(); ++i) {
+        out.values[i] = move(input.values[column_indexes[i]]);
+    }
+    out.record_id = input.record_id;
+    return true;
+}
+
+string aggregate_name(AggregateFunction function, const string& column) {
+    static const char* const names[] = {"COUNT", "SUM", "AVG", "MIN", "MAX"};
+    return string(names[static_cast<int>(function)]) + "(" + (column.empty() ? "*" : column) + ")";
+}
+
+HashAggregate::HashAggregate(unique_ptr<Operator> input, vector<int> group_columns, vector<AggregateSpec> specs,
+                             size_t threads)
+    : child(move(input)), group_by(move(group_columns)), aggregates(move(specs)),
+      thread_count(max<size_t>(threads, 1)) {
+    const vector<Column>& input_columns = child->output_columns();
+    for (int index : group_by) columns.push_back(input_columns[index]);
+    for (const AggregateSpec& spec : aggregates) {
+        Column column;
+        if (spec.column >= 0) column = input_columns[spec.column];
+        const string name = aggregate_name(spec.function, spec.column >= 0 ? column.name : "");
+        bool numeric = column.type == TypeId::INT || column.type == TypeId::BIGINT || column.type == TypeId::DOUBLE;
+        switch (spec.function) {
+        case AggregateFunction::COUNT:
+            column.type = TypeId::BIGINT;
+            break;
+        case AggregateFunction::SUM:
+        case AggregateFunction::AVG:
+            if (!numeric) {
+                throw invalid_argument(name + " needs a numeric column; '" + column.name + "' is " +
+                                       column.type_name());
+            }
+            if (spec.function == AggregateFunction::AVG || column.type == TypeId::DOUBLE) {
+                column.type = TypeId::DOUBLE;
+            } else {
+                column.type = TypeId::BIGINT;
+            }
+            break;
+        case AggregateFunction::MIN:
+        case AggregateFunction::MAX:
+            break;
+        }
+        column.name = name;
+        columns.push_back(column);
+    }
+}
+
+void HashAggregate::group_key(const Tuple& tuple, string& key) const {
+    key.clear();
+    for (int index : group_by) {
+        const Value& value = tuple.values[index];
+        if (value.is_null) {
+            key.push_back('\0');
+            continue;
+        }
+        key.push_back('\1');
+        string bytes;
+        if (value.type == TypeId::DOUBLE && (value.double_value == 0 || value.double_value != value.double_value)) {
+            // -0.0 groups with 0.0, and every NaN with every other
+            bytes = Value::make_double(value.double_value == 0 ? 0.0 : NAN).index_key();
+        } else {
+            bytes = value.index_key();
+        }
+        // Escaping zero bytes and ending with "\0\0" keeps shorter strings
+        // first and the columns apart.
+        for (char c : bytes) {
+            key.push_back(c);
+            if (c == '\0') key.push_back('\1');
+        }
+        key.append(2, '\0');
+    }
+}
+
+void HashAggregate::accumulate(HashTable& table, const Tuple& tuple, string& key) const {
+    group_key(tuple, key);
+    auto [entry, added] = table.index.try_emplace(key, table.groups.size());
+    if (added) {
+        Group group;
+        for (int index : group_by) group.keys.push_back(tuple.values[index]);
+        group.states.resize(aggregates.size());
+        table.groups.push_back(move(group));
+    }
+    Group& group = table.groups[entry->second];
+
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+        const AggregateSpec& spec = aggregates[i];
+        State& state = group.states[i];
+        if (spec.column < 0) {
+            state.count++;
+            continue;
+        }
+        const Value& value = tuple.values[spec.column];
+        if (value.is_null) continue;
+        switch (spec.function) {
+        case AggregateFunction::COUNT:
+            break;
+        case AggregateFunction::SUM:
+        case AggregateFunction::AVG:
+            if (value.type == TypeId::DOUBLE) {
+                state.double_sum += value.double_value;
+            } else if (spec.function == AggregateFunction::AVG) {
+                state.double_sum += static_cast<double>(value.int_value);
+            } else if (__builtin_add_overflow(state.int_sum, value.int_value, &state.int_sum)) {
+                throw invalid_argument(columns[group_by.size() + i].name + " is out of the BIGINT range");
+            }
+            break;
+        case AggregateFunction::MIN:
+            if (state.count == 0 || value.compare(state.extreme) < 0) state.extreme = value;
+            break;
+        case AggregateFunction::MAX:
+            if (state.count == 0 || value.compare(state.extreme) > 0) state.extreme = value;
+            break;
+        }
+        state.count++;
+    }
+}
+
+void HashAggregate::combine(size_t aggregate, State& into, const State& from) const {
+    const AggregateSpec& spec = aggregates[aggregate];
+    if (from.count == 0) return;
+    if (__builtin_add_overflow(into.int_sum, from.int_sum, &into.int_sum)) {
+        throw invalid_argument(columns[group_by.size() + aggregate].name + " is out of the BIGINT range");
+    }
+    into.double_sum += from.double_sum;
+    if (spec.function == AggregateFunction::MIN || spec.function == AggregateFunction::MAX) {
+        int order = into.count == 0 ? 0 : from.extreme.compare(into.extreme);
+        if (into.count == 0 || (spec.function == AggregateFunction::MIN ? order < 0 : order > 0)) {
+            into.extreme = from.extreme;
+        }
+    }
+    into.count += from.count;
+}
+
+void HashAggregate::merge(HashTable& into, HashTable& from) const {
+    for (auto& [key, position] : from.index) {
+        Group& group = from.groups[position];
+        auto [entry, added] = into.index.try_emplace(key, into.groups.size());
+        if (added) {
+            into.groups.push_back(move(group));
+            continue;
+        }
+        Group& target = into.groups[entry->second];
+        for (size_t i = 0; i < aggregates.size(); ++i) combine(i, target.states[i], group.states[i]);
+    }
+}
+
+Value HashAggregate::result(size_t aggregate, const State& state) const {
+    const AggregateSpec& spec = aggregates[aggregate];
+    if (spec.function == AggregateFunction::COUNT) return Value::make_int(state.count, TypeId::BIGINT);
+    if (state.count == 0) return Value::make_null(columns[group_by.size() + aggregate].type);
+
+    bool doubles = child->output_columns()[spec.column].type == TypeId::DOUBLE;
+    switch (spec.function) {
+    case AggregateFunction::SUM:
+        return doubles ? Value::make_double(state.double_sum) : Value::make_int(state.int_sum, TypeId::BIGINT);
+    case AggregateFunction::AVG:
+        return Value::make_double(state.double_sum / state.count);
+    default:
+        return state.extreme;
+    }
+}
+
+void HashAggregate::open() {
+    results.clear();
+    cursor = 0;
+    child->open();
+
+    // Workers take turns at the child; a short batch means it is exhausted.
+    vector<HashTable> tables(thread_count);
+    vector<exception_ptr> failures(thread_count);
+    mutex input_latch;
+    bool exhausted = false;
+    auto work = [&](size_t worker) {
+        try {
+            vector<Tuple> batch(AGGREGATE_BATCH_ROWS);
+            string key;
+            while (true) {
+                size_t n = 0;
+                {
+                    lock_guard<mutex> lock(input_latch);
+                    if (exhausted) return;
+                    while (n < batch.size() && child->next(batch[n])) n++;
+                    if (n < batch.size()) exhausted = true;
+                }
+                for (size_t i = 0; i < n; ++i) accumulate(tables[worker], batch[i], key);
+            }
+        } catch (...) {
+            failures[worker] = current_exception();
+            lock_guard<mutex> lock(input_latch);
+            exhausted = true;
+        }
+    };
+    vector<thread> workers;
+    for (size_t i = 1; i < thread_count; ++i) workers.emplace_back(work, i);
+    work(0);
+    for (auto& worker : workers) worker.join();
+    child->close();
+    for (const exception_ptr& failure : failures) {
+        if (failure) rethrow_exception(failure);
+    }
+
+    HashTable& table = tables[0];
+    for (size_t i = 1; i < tables.size(); ++i) merge(table, tables[i]);
+    if (group_by.empty() && table.groups.empty()) {
+        table.index.emplace("", 0);
+        table.groups.push_back(Group{{}, vector<State>(aggregates.size())});
+    }
+    LOG_DEBUG(QUERY, "Hash aggregate: " << table.groups.size() << " groups on " << thread_count << " threads");
+
+    vector<pair<const string*, size_t>> order;
+    order.reserve(table.index.size());
+    for (const auto& [key, position] : table.index) order.emplace_back(&key, position);
+    sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    results.reserve(order.size());
+    for (const auto& [key, position] : order) {
+        Group& group = table.groups[position];
+        Tuple tuple;
+        tuple.values = move(group.keys);
+        for (size_t i = 0; i < aggregates.size(); ++i) tuple.values.push_back(result(i, group.states[i]));
+        results.push_back(move(tuple));
+    }
+}
+
+bool HashAggregate::next(Tuple& out) {
+    if (cursor >= results.size()) return false;
+    out = move(results[cursor++]);
+    return true;
+}
+
+void HashAggregate::close() {
+    results.clear();
+    results.shrink_to_fit();
+    cursor = 0;
+}
+
+bool joinable(TypeId left, TypeId right) {
+    auto numeric = [](TypeId type) { return type == TypeId::INT || type == TypeId::BIGINT || type == TypeId::DOUBLE; };
+    return left == right || (numeric(left) && numeric(right));
+}
+
+string join_key(const Value& value, bool as_double) {
+    if (value.type == TypeId::VARCHAR) return value.string_value;
+    if (!as_double) return string(reinterpret_cast<const char*>(&value.int_value), sizeof(value.int_value));
+    double number = value.type == TypeId::DOUBLE ? value.double_value : static_cast<double>(value.int_value);
+    if (number == 0) number = 0;        // -0.0 joins 0.0
+    if (number != number) number = NAN; // and every NaN the others
+    return string(reinterpret_cast<const char*>(&number), sizeof(number));
+}
+
+size_t join_memory_budget() {
+    static const size_t budget = [] {
+        if (const char* value = getenv("LIMBODB_JOIN_MEMORY_MB")) {
+            int parsed = atoi(value);
+            if (parsed > 0) return static_cast<size_t>(parsed) << 20;
+        }
+        return static_cast<size_t>(64) << 20;
+    }();
+    return budget;
+}
+
+namespace {
+
+// Spilled tuples: per value a NULL flag, then an int64, a double or
+// [uint32 length][bytes], by the column type.
+void encode_tuple(const Tuple& tuple, string& out) {
+    out.clear();
+    for (const Value& value : tuple.values) {
+        out.push_back(value.is_null ? 1 : 0);
+        if (value.is_null) continue;
+        if (value.type == TypeId::VARCHAR) {
+            uint32_t length = static_cast<uint32_t>(value.string_value.size());
+            out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.append(value.string_value);
+        } else if (value.type == TypeId::DOUBLE) {
+            out.append(reinterpret_cast<const char*>(&value.double_value), sizeof(value.double_value));
+        } else {
+            out.append(reinterpret_cast<const char*>(&value.int_value), sizeof(value.int_value));
+        }
+    }
+}
+
+void decode_tuple(const string& in, const vector<Column>& columns, Tuple& out) {
+    out.values.resize(columns.size());
+    out.record_id = -1;
+    const char* data = in.data();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        Value& value = out.values[i];
+        value = Value::make_null(columns[i].type);
+        if (*data++) continue;
+        value.is_null = false;
+        if (value.type == TypeId::VARCHAR) {
+            uint32_t length;
+            memcpy(&length, data, sizeof(length));
+            value.string_value.assign(data + sizeof(length), length);
+            data += sizeof(length) + length;
+        } else if (value.type == TypeId::DOUBLE) {
+            memcpy(&value.double_value, data, sizeof(value.double_value));
+            data += sizeof(value.double_value);
+        } else {
+            memcpy(&value.int_value, data, sizeof(value.int_value));
+            data += sizeof(value.int_value);
+        }
+    }
+}
+
+// Rough heap footprint of a tuple kept in a hash table.
+size_t tuple_bytes(const Tuple& tuple) {
+    size_t bytes = sizeof(Tuple) + tuple.values.capacity() * sizeof(Value);
+    for (const Value& value : tuple.values) bytes += value.string_value.size();
+    return bytes;
+}
+
+void concatenate(const Tuple& left, const Tuple& right, Tuple& out) {
+    out.values.clear();
+    out.values.reserve(left.values.size() + right.values.size());
+    out.values.insert(out.values.end(), left.values.begin(), left.values.end());
+    out.values.insert(out.values.end(), right.values.begin(), right.values.end());
+    out.record_id = -1;
+}
+
+} // namespace
+
+HashJoin::HashJoin(unique_ptr<Operator> left, unique_ptr<Operator> right, int left_key, int right_key,
+                   bool build_left_side, size_t budget, vector<Column> joined_columns)
+    : build(build_left_side ? move(left) : move(right)), probe(build_left_side ? move(right) : move(left)),
+      build_key(build_left_side ? left_key : right_key), probe_key(build_left_side ? right_key : left_key),
+      build_left(build_left_side), memory_budget(budget), columns(move(joined_columns)) {
+    as_double = build->output_columns()[build_key].type == TypeId::DOUBLE ||
+                probe->output_columns()[probe_key].type == TypeId::DOUBLE;
+}
+
+// The key's hash, mixed with the partitioning level so that a partition
+// split again spreads over all the new partitions.
+size_t HashJoin::partition_of(const string& key, int depth) {
+    uint64_t hash = std::hash<string>()(key) ^ (static_cast<uint64_t>(depth) * 0x9e3779b97f4a7c15ULL);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash % HASH_JOIN_PARTITIONS;
+}
+
+void HashJoin::spill_tuple(SpillFile& file, size_t first_run, const Tuple& tuple, const string& key, int depth) {
+    encode_tuple(tuple, entry);
+    file.append(first_run + partition_of(key, depth), entry);
+}
+
+void HashJoin::open() {
+    close();
+    build->open();
+    Tuple tuple;
+    size_t bytes = 0;
+    size_t rows = 0;
+    shared_ptr<SpillFile> spill;
+    while (build->next(tuple)) {
+        const Value& value = tuple.values[build_key];
+        if (value.is_null) continue;
+        string key = join_key(value, as_double);
+        rows++;
+        if (spill) {
+            spill_tuple(*spill, 0, tuple, key, 0);
+            continue;
+        }
+        bytes += tuple_bytes(tuple) + key.size() + sizeof(string);
+        table[move(key)].push_back(move(tuple));
+        if (bytes > memory_budget) {
+            spill = make_shared<SpillFile>(2 * HASH_JOIN_PARTITIONS);
+            for (const auto& [spilled_key, tuples] : table) {
+                for (const Tuple& spilled_tuple : tuples) spill_tuple(*spill, 0, spilled_tuple, spilled_key, 0);
+            }
+            table.clear();
+        }
+    }
+    build->close();
+    probe->open();
+    if (!spill) {
+        LOG_DEBUG(QUERY, "Hash join: " << rows << " build rows, " << table.size() << " keys in memory");
+        return;
+    }
+
+    while (probe->next(tuple)) {
+        const Value& value = tuple.values[probe_key];
+        if (!value.is_null) spill_tuple(*spill, HASH_JOIN_PARTITIONS, tuple, join_key(value, as_double), 0);
+    }
+    probe->close();
+    spill->finish();
+    spilled = true;
+    for (size_t run = HASH_JOIN_PARTITIONS; run-- > 0;) pending.push_back(Partition{spill, run, 0});
+    LOG_DEBUG(QUERY, "Hash join: " << rows << " build rows over " << memory_budget << " bytes, spilled "
+                                   << spill->pages() << " pages in " << HASH_JOIN_PARTITIONS << " partitions");
+}
+
+// Loads build tuples from build_run until the table exceeds the budget or
+// the run ends; false if there were none left.
+bool HashJoin::load_chunk() {
+    table.clear();
+    size_t bytes = 0;
+    Tuple tuple;
+    while (bytes <= memory_budget && build_run->next(entry)) {
+        decode_tuple(entry, build->output_columns(), tuple);
+        string key = join_key(tuple.values[build_key], as_double);
+        bytes += tuple_bytes(tuple) + key.size() + sizeof(string);
+        table[move(key)].push_back(move(tuple));
+    }
+    return !table.empty();
+}
+
+// Splits the active partition, whose first chunk is in the table, into
+// HASH_JOIN_PARTITIONS partitions of the next level. If all its build
+// tuples land in one of them (one key), that one is not split again.
+void HashJoin::repartition() {
+    int depth = active.depth + 1;
+    auto file = make_shared<SpillFile>(2 * HASH_JOIN_PARTITIONS);
+    vector<size_t> rows(HASH_JOIN_PARTITIONS);
+    for (const auto& [key, tuples] : table) {
+        size_t run = partition_of(key, depth);
+        for (const Tuple& tuple : tuples) {
+            encode_tuple(tuple, entry);
+            file->append(run, entry);
+        }
+        rows[run] += tuples.size();
+    }
+    table.clear();
+
+    Tuple tuple;
+    while (build_run->next(entry)) {
+        decode_tuple(entry, build->output_columns(), tuple);
+        size_t run = partition_of(join_key(tuple.values[build_key], as_double), depth);
+        file->append(run, entry);
+        rows[run]++;
+    }
+    build_run.reset();
+    SpillFile::Reader probe_reader(*active.file, active.run + HASH_JOIN_PARTITIONS);
+    while (probe_reader.next(entry)) {
+        decode_tuple(entry, probe->output_columns(), tuple);
+        file->append(HASH_JOIN_PARTITIONS + partition_of(join_key(tuple.values[probe_key], as_double), depth), entry);
+    }
+    file->finish();
+    LOG_DEBUG(QUERY, "Hash join: partition " << active.run << " of level " << active.depth
+                                             << " over the budget, split into " << file->pages() << " pages");
+    bool single = count_if(rows.begin(), rows.end(), [](size_t n) { return n > 0; }) == 1;
+    for (size_t run = HASH_JOIN_PARTITIONS; run-- > 0;) {
+        if (rows[run] > 0) pending.push_back(Partition{file, run, single ? HASH_JOIN_MAX_DEPTH - 1 : depth});
+    }
+}
+
+// Loads the next build tuples (the next chunk of the active partition, or
+// the next partition) and opens the probe run to join them with; false
+// once everything was joined.
+bool HashJoin::load_partition() {
+    probe_run.reset();
+    while (true) {
+        if (build_run) {
+            if (load_chunk()) break;
+            build_run.reset();
+        }
+        if (pending.empty()) {
+            table.clear();
+            active = Partition();
+            return false;
+        }
+        active = move(pending.back());
+        pending.pop_back();
+        build_run = make_unique<SpillFile::Reader>(*active.file, active.run);
+        if (!load_chunk()) continue;
+        // Over the budget: split the partition, or else join it in chunks.
+        if (active.depth + 1 < HASH_JOIN_MAX_DEPTH && build_run->next(entry)) {
+            Tuple tuple;
+            decode_tuple(entry, build->output_columns(), tuple);
+            string key = join_key(tuple.values[build_key], as_double);
+            table[move(key)].push_back(move(tuple));
+            repartition();
+            continue;
+        }
+        break;
+    }
+    probe_run = make_unique<SpillFile::Reader>(*active.file, active.run + HASH_JOIN_PARTITIONS);
+    return true;
+}
+
+bool HashJoin::next_probe() {
+    if (!spilled) return probe->next(current);
+    while (true) {
+        if (probe_run && probe_run->next(entry)) {
+            decode_tuple(entry, probe->output_columns(), current);
+            return true;
+        }
+        if (!load_partition()) return false;
+    }
+}
+
+bool HashJoin::next(Tuple& out) {
+    if (!spilled && table.empty()) return false;
+    while (true) {
+        if (matches && cursor < matches->size()) {
+            const Tuple& built = (*matches)[cursor++];
+            if (build_left) {
+                concatenate(built, current, out);
+            } else {
+                concatenate(current, built, out);
+            }
+            return true;
+        }
+        matches = nullptr;
+        if (!next_probe()) return false;
+        const Value& value = current.values[probe_key];
+        if (value.is_null) continue;
+        auto found = table.find(join_key(value, as_double));
+        if (found == table.end()) continue;
+        matches = &found->second;
+        cursor = 0;
+    }
+}
+
+void HashJoin::close() {
+    build->close();
+    probe->close();
+    matches = nullptr;
+    cursor = 0;
+    table.clear();
+    probe_run.reset();
+    build_run.reset();
+    pending.clear();
+    active = Partition();
+    spilled = false;
+}
+
+IndexNestedLoopJoin::IndexNestedLoopJoin(unique_ptr<Operator> outer_input, RecordManager& rm, IndexManager& im,
+                                         const TableSchema& inner_table, shared_ptr<const Snapshot> read_snapshot,
+                                         int outer_column, int inner_column, const Expr* predicate,
+                                         vector<bool> used_columns, bool outer_is_left, vector<Column> joined_columns)
+    : outer(move(outer_input)), record_manager(rm), index_manager(im), inner_schema(inner_table),
+      layout(inner_table.columns), snapshot(move(read_snapshot)), outer_key(outer_column), inner_key(inner_column),
+      inner_predicate(predicate), inner_columns(move(used_columns)), outer_left(outer_is_left),
+      columns(move(joined_columns)) {
+    as_double = outer->output_columns()[outer_key].type == TypeId::DOUBLE ||
+                inner_schema.columns[inner_key].type == TypeId::DOUBLE;
+}
+
+void IndexNestedLoopJoin::open() {
+    outer->open();
+    record_ids.clear();
+    cursor = 0;
+}
+
+// Converts the outer key to the inner column's type, which the index keys
+// are made of, and collects the record ids the index has for it.
+void IndexNestedLoopJoin::probe_index(const Value& key) {
+    record_ids.clear();
+    cursor = 0;
+    const Column& column = inner_schema.columns[inner_key];
+    vector<Value> probes;
+    if (column.type == TypeId::INT || column.type == TypeId::BIGINT) {
+        int64_t number = key.int_value;
+        if (key.type == TypeId::DOUBLE) {
+            double d = key.double_value;
+            if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || d != floor(d)) return;
+            number = static_cast<int64_t>(d);
+        }
+        if (column.type == TypeId::INT && (number < INT32_MIN || number > INT32_MAX)) return;
+        probes.push_back(Value::make_int(number, column.type));
+    } else if (column.type == TypeId::DOUBLE) {
+        double number = key.type == TypeId::DOUBLE ? key.double_value : static_cast<double>(key.int_value);
+        probes.push_back(Value::make_double(number));
+        if (number == 0) probes.push_back(Value::make_double(-number)); // -0.0 has a key of its own
+    } else {
+        probes.push_back(key);
+    }
+
+    for (const Value& probe : probes) {
+        vector<int64_t> found = index_manager.search(inner_schema.table_name, column.name, probe.index_key());
+        record_ids.insert(record_ids.end(), found.begin(), found.end());
+    }
+    sort(record_ids.begin(), record_ids.end());
+    record_ids.erase(unique(record_ids.begin(), record_ids.end()), record_ids.end());
+}
+
+bool IndexNestedLoopJoin::next(Tuple& out) {
+    while (true) {
+        while (cursor < record_ids.size()) {
+            int64_t record_id = record_ids[cursor++];
+            if (!record_manager.get_record(inner_schema.segment_id, record_id, *snapshot, row)) continue;
+            inner.values =
+                record_manager.decode_row(layout, row.data(), inner_columns.empty() ? nullptr : &inner_columns);
+            inner.record_id = record_id;
+            // The index may return keys that only share a long prefix.
+            const Value& value = inner.values[inner_key];
+            if (value.is_null || join_key(value, as_double) != current_key) continue;
+            if (inner_predicate && !inner_predicate->evaluate(inner)) continue;
+            if (outer_left) {
+                concatenate(current, inner, out);
+            } else {
+                concatenate(inner, current, out);
+            }
+            return true;
+        }
+        if (!outer->next(current)) return false;
+        const Value& key = current.values[outer_key];
+        if (key.is_null) {
+            record_ids.clear();
+            continue;
+        }
+        current_key = join_key(key, as_double);
+        probe_index(key);
+    }
+}
+
+void IndexNestedLoopJoin::close() {
+    outer->close();
+    record_ids.clear();
+    record_ids.shrink_to_fit();
+    cursor = 0;
+}
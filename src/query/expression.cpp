@@ -0,0 +1,143 @@
+#include "../../include/query/expression.h"
+#include <stdexcept>
+#include <strings.h>
+
+using namespace std;
+
+namespace {
+
+const char* op_text(CompareOp op) {
+    switch (op) {
+    case CompareOp::EQ: return "=";
+    case CompareOp::NE: return "<>";
+    case CompareOp::LT: return "<";
+    case CompareOp::LE: return "<=";
+    case CompareOp::GT: return ">";
+    case CompareOp::GE: return ">=";
+    }
+    return "?";
+}
+
+string literal_text(const Value& value) {
+    return value.type == TypeId::VARCHAR && !value.is_null ? "'" + value.to_string() + "'" : value.to_string();
+}
+
+} // namespace
+
+Value Literal::bind(const Column& column, const vector<Literal>& parameters) const {
+    if (parameter > 0) {
+        if (parameter > static_cast<int>(parameters.size())) {
+            throw invalid_argument("No value given for parameter $" + std::to_string(parameter));
+        }
+        return parameters[parameter - 1].bind(column, {});
+    }
+    return Value::parse(column, quoted ? "'" + text + "'" : text);
+}
+
+string Literal::to_string() const {
+    if (parameter > 0) return "$" + std::to_string(parameter);
+    return quoted ? "'" + text + "'" : text;
+}
+
+unique_ptr<Expr> Expr::bind(const TableSchema& schema, const vector<Literal>& parameters) const {
+    auto bound = make_unique<Expr>();
+    bound->kind = kind;
+    if (kind == Kind::AND || kind == Kind::OR) {
+        bound->left = left->bind(schema, parameters);
+        bound->right = right->bind(schema, parameters);
+        return bound;
+    }
+
+    bound->column = column;
+    bound->op = op;
+    bound->literals = literals;
+    bound->column_index = schema.column_index(column);
+    if (bound->column_index < 0 && strcasecmp(column.c_str(), RECORD_ID_COLUMN) != 0) {
+        throw invalid_argument("Column '" + column + "' not found in table '" + schema.table_name + "'");
+    }
+    static const Column record_id_column{RECORD_ID_COLUMN, TypeId::BIGINT};
+    const Column& target = bound->column_index < 0 ? record_id_column : schema.columns[bound->column_index];
+    for (const auto& literal : literals) {
+        bound->values.push_back(literal.bind(target, parameters));
+    }
+    return bound;
+}
+
+unique_ptr<Expr> Expr::rename(const function<string(const string&)>& name) const {
+    auto copy = make_unique<Expr>();
+    copy->kind = kind;
+    if (kind == Kind::AND || kind == Kind::OR) {
+        copy->left = left->rename(name);
+        copy->right = right->rename(name);
+        return copy;
+    }
+    copy->column = name(column);
+    copy->op = op;
+    copy->literals = literals;
+    return copy;
+}
+
+void Expr::mark_columns(vector<bool>& columns) const {
+    if (left) left->mark_columns(columns);
+    if (right) right->mark_columns(columns);
+    if (kind != Kind::AND && kind != Kind::OR && column_index >= 0) columns[column_index] = true;
+}
+
+bool Expr::evaluate(const Tuple& tuple) const {
+    switch (kind) {
+    case Kind::AND: return left->evaluate(tuple) && right->evaluate(tuple);
+    case Kind::OR: return left->evaluate(tuple) || right->evaluate(tuple);
+    default: break;
+    }
+
+    Value record_id;
+    if (column_index < 0) record_id = Value::make_int(tuple.record_id, TypeId::BIGINT);
+    const Value& value = column_index < 0 ? record_id : tuple.values[column_index];
+    if (value.is_null) return false;
+
+    if (kind == Kind::BETWEEN) {
+        if (values[0].is_null || values[1].is_null) return false;
+        return value.compare(values[0]) >= 0 && value.compare(values[1]) <= 0;
+    }
+    if (kind == Kind::IN) {
+        for (const auto& candidate : values) {
+            if (!candidate.is_null && value.compare(candidate) == 0) return true;
+        }
+        return false;
+    }
+
+    if (values[0].is_null) return false;
+    int c = value.compare(values[0]);
+    switch (op) {
+    case CompareOp::EQ: return c == 0;
+    case CompareOp::NE: return c != 0;
+    case CompareOp::LT: return c < 0;
+    case CompareOp::LE: return c <= 0;
+    case CompareOp::GT: return c > 0;
+    case CompareOp::GE: return c >= 0;
+    }
+    return false;
+}
+
+string Expr::to_string() const {
+    auto operand = [this](size_t i) {
+        return values.empty() ? literals[i].to_string() : literal_text(values[i]);
+    };
+    switch (kind) {
+    case Kind::AND: return "(" + left->to_string() + " AND " + right->to_string() + ")";
+    case Kind::OR: return "(" + left->to_string() + " OR " + right->to_string() + ")";
+    case Kind::BETWEEN:
+        return column + " BETWEEN " + operand(0) + " AND " + operand(1);
+    case Kind::IN: {
+        string text = column + " IN (";
+        for (size_t i = 0; i < literals.size(); ++i) {
+            if (i > 0) text += ", ";
+            text += operand(i);
+        }
+        return text + ")";
+    }
+    case Kind::COMPARE:
+        return column + " " + op_text(op) + " " + operand(0);
+    }
+    return "";
+}
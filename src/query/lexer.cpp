@@ -0,0 +1,77 @@
+#include "../../include/query/lexer.h"
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+#include <strings.h>
+
+using namespace std;
+
+bool Token::is_keyword(const char* keyword) const {
+    return type == TokenType::IDENTIFIER && strcasecmp(text.c_str(), keyword) == 0;
+}
+
+bool Token::is_symbol(const char* symbol) const {
+    return type == TokenType::SYMBOL && text == symbol;
+}
+
+vector<Token> tokenize(const string& sql) {
+    vector<Token> tokens;
+    size_t i = 0;
+    while (i < sql.size()) {
+        char c = sql[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            while (i < sql.size() && (isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_' || sql[i] == '.')) ++i;
+            tokens.push_back({TokenType::IDENTIFIER, sql.substr(start, i - start), start});
+        } else if (isdigit(static_cast<unsigned char>(c)) ||
+                   ((c == '-' || c == '+' || c == '.') && i + 1 < sql.size() && (isdigit(static_cast<unsigned char>(sql[i + 1])) || sql[i + 1] == '.'))) {
+            ++i;
+            while (i < sql.size() && (isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '.' ||
+                                      ((sql[i] == '-' || sql[i] == '+') && (sql[i - 1] == 'e' || sql[i - 1] == 'E')))) ++i;
+            tokens.push_back({TokenType::NUMBER, sql.substr(start, i - start), start});
+        } else if (c == '$' && i + 1 < sql.size() && isdigit(static_cast<unsigned char>(sql[i + 1]))) {
+            ++i;
+            while (i < sql.size() && isdigit(static_cast<unsigned char>(sql[i]))) ++i;
+            tokens.push_back({TokenType::PARAMETER, sql.substr(start + 1, i - start - 1), start});
+        } else if (c == '\'') {
+            // '' inside a string is an escaped quote
+            string text;
+            ++i;
+            while (true) {
+                if (i >= sql.size()) throw invalid_argument("Unterminated string starting at position " + to_string(start));
+                if (sql[i] == '\'') {
+                    if (i + 1 < sql.size() && sql[i + 1] == '\'') {
+                        text.push_back('\'');
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    break;
+                }
+                text.push_back(sql[i++]);
+            }
+            tokens.push_back({TokenType::STRING, text, start});
+        } else {
+            static const char* two_char[] = {"<>", "!=", "<=", ">="};
+            string symbol(1, c);
+            for (const char* op : two_char) {
+                if (sql.compare(i, 2, op) == 0) {
+                    symbol = op;
+                    break;
+                }
+            }
+            if (symbol.size() == 1 && !strchr("(),;*=<>", c)) {
+                throw invalid_argument(string("Unexpected character '") + c + "' at position " + to_string(start));
+            }
+            i += symbol.size();
+            tokens.push_back({TokenType::SYMBOL, symbol, start});
+        }
+    }
+    tokens.push_back({TokenType::END, "", sql.size()});
+    return tokens;
+}
@@ -0,0 +1,422 @@
+#include "../../include/query/parser.h"
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+unique_ptr<Expr> combine(Expr::Kind kind, unique_ptr<Expr> left, unique_ptr<Expr> right) {
+    auto expr = make_unique<Expr>();
+    expr->kind = kind;
+    expr->left = move(left);
+    expr->right = move(right);
+    return expr;
+}
+
+} // namespace
+
+Parser::Parser(const string& query) : sql(query), tokens(tokenize(query)) {}
+
+void Parser::fail(const string& expected) const {
+    const Token& token = peek();
+    string found = token.type == TokenType::END ? "end of query" : "'" + token.text + "'";
+    throw invalid_argument("Syntax error: expected " + expected + " but found " + found);
+}
+
+bool Parser::accept_keyword(const char* keyword) {
+    if (!peek().is_keyword(keyword)) return false;
+    ++pos;
+    return true;
+}
+
+void Parser::expect_keyword(const char* keyword) {
+    if (!accept_keyword(keyword)) fail(keyword);
+}
+
+void Parser::expect_symbol(const char* symbol) {
+    if (!peek().is_symbol(symbol)) fail(string("'") + symbol + "'");
+    ++pos;
+}
+
+string Parser::expect_identifier(const char* what) {
+    if (peek().type != TokenType::IDENTIFIER) fail(what);
+    return tokens[pos++].text;
+}
+
+Literal Parser::parse_literal() {
+    const Token& token = peek();
+    Literal literal;
+    switch (token.type) {
+    case TokenType::PARAMETER:
+        literal.parameter = stoi(token.text);
+        if (literal.parameter < 1) fail("a parameter number of at least 1");
+        parameter_count = max(parameter_count, literal.parameter);
+        break;
+    case TokenType::STRING:
+        literal.quoted = true;
+        literal.text = token.text;
+        break;
+    case TokenType::NUMBER:
+    case TokenType::IDENTIFIER:
+        literal.text = token.text;
+        break;
+    default:
+        fail("a value");
+    }
+    ++pos;
+    return literal;
+}
+
+// '(' literal, ... ')'
+vector<Literal> Parser::parse_literal_list() {
+    vector<Literal> literals;
+    expect_symbol("(");
+    literals.push_back(parse_literal());
+    while (peek().is_symbol(",")) {
+        ++pos;
+        literals.push_back(parse_literal());
+    }
+    expect_symbol(")");
+    return literals;
+}
+
+unique_ptr<Statement> Parser::parse_statement() {
+    unique_ptr<Statement> statement;
+    if (accept_keyword("CREATE")) {
+        if (accept_keyword("UNIQUE")) {
+            expect_keyword("INDEX");
+            statement = parse_create_index(true);
+        } else if (accept_keyword("INDEX")) {
+            statement = parse_create_index(false);
+        } else {
+            statement = parse_create_table();
+        }
+    } else if (accept_keyword("DROP")) {
+        statement = accept_keyword("INDEX") ? parse_drop_index() : parse_drop_table();
+    } else if (accept_keyword("INSERT")) {
+        statement = parse_insert();
+    } else if (accept_keyword("COPY")) {
+        statement = parse_copy();
+    } else if (accept_keyword("DELETE")) {
+        statement = parse_delete();
+    } else if (accept_keyword("UPDATE")) {
+        statement = parse_update();
+    } else if (accept_keyword("SELECT")) {
+        statement = parse_select();
+    } else if (accept_keyword("VACUUM")) {
+        statement = parse_vacuum();
+    } else if (accept_keyword("PREPARE")) {
+        return parse_prepare(); // the body runs to the end of the query
+    } else if (accept_keyword("EXECUTE")) {
+        statement = parse_execute();
+    } else if (accept_keyword("DEALLOCATE")) {
+        statement = parse_deallocate();
+    } else {
+        fail("a statement");
+    }
+
+    if (peek().is_symbol(";")) ++pos;
+    if (peek().type != TokenType::END) fail("end of statement");
+    statement->parameter_count = parameter_count;
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_create_table() {
+    expect_keyword("TABLE");
+    auto statement = make_unique<CreateTableStatement>();
+    statement->table = expect_identifier("a table name");
+    expect_symbol("(");
+    while (true) {
+        // "name TYPE" or "name TYPE(n)"; columns without a type are VARCHAR(255)
+        string definition = expect_identifier("a column name");
+        if (peek().type == TokenType::IDENTIFIER) {
+            definition += " " + tokens[pos++].text;
+            if (peek().is_symbol("(")) {
+                ++pos;
+                if (peek().type != TokenType::NUMBER) fail("a type length");
+                definition += "(" + tokens[pos++].text + ")";
+                expect_symbol(")");
+            }
+        }
+        statement->columns.push_back(Column::parse_definition(definition));
+        if (!peek().is_symbol(",")) break;
+        ++pos;
+    }
+    expect_symbol(")");
+    if (accept_keyword("WITH")) {
+        expect_symbol("(");
+        expect_keyword("STORAGE");
+        expect_symbol("=");
+        if (accept_keyword("COLUMN")) statement->storage = TableStorage::COLUMN;
+        else if (!accept_keyword("ROW")) fail("ROW or COLUMN");
+        expect_symbol(")");
+    }
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_drop_table() {
+    expect_keyword("TABLE");
+    auto statement = make_unique<DropTableStatement>();
+    statement->table = expect_identifier("a table name");
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_create_index(bool unique) {
+    auto statement = make_unique<CreateIndexStatement>();
+    statement->unique = unique;
+    statement->name = expect_identifier("an index name");
+    expect_keyword("ON");
+    statement->table = expect_identifier("a table name");
+    if (accept_keyword("USING")) {
+        if (accept_keyword("HASH")) statement->type = IndexType::HASH;
+        else if (!accept_keyword("BTREE")) fail("BTREE or HASH");
+    }
+    expect_symbol("(");
+    statement->column = expect_identifier("a column name");
+    expect_symbol(")");
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_drop_index() {
+    auto statement = make_unique<DropIndexStatement>();
+    statement->name = expect_identifier("an index name");
+    return statement;
+}
+
+// Optional '(' column, ... ')' naming the columns values are given for.
+vector<string> Parser::parse_column_list() {
+    vector<string> columns;
+    if (!peek().is_symbol("(")) return columns;
+    ++pos;
+    columns.push_back(expect_identifier("a column name"));
+    while (peek().is_symbol(",")) {
+        ++pos;
+        columns.push_back(expect_identifier("a column name"));
+    }
+    expect_symbol(")");
+    return columns;
+}
+
+unique_ptr<Statement> Parser::parse_insert() {
+    expect_keyword("INTO");
+    auto statement = make_unique<InsertStatement>();
+    statement->table = expect_identifier("a table name");
+    statement->columns = parse_column_list();
+    expect_keyword("VALUES");
+    statement->rows.push_back(parse_literal_list());
+    while (peek().is_symbol(",")) {
+        ++pos;
+        statement->rows.push_back(parse_literal_list());
+    }
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_copy() {
+    auto statement = make_unique<CopyStatement>();
+    statement->table = expect_identifier("a table name");
+    statement->columns = parse_column_list();
+    expect_keyword("FROM");
+    if (peek().type != TokenType::STRING) fail("a quoted file name");
+    statement->path = tokens[pos++].text;
+    if (accept_keyword("WITH")) {
+        expect_keyword("HEADER");
+        statement->header = true;
+    }
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_delete() {
+    expect_keyword("FROM");
+    auto statement = make_unique<DeleteStatement>();
+    statement->table = expect_identifier("a table name");
+    statement->where = parse_where();
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_update() {
+    auto statement = make_unique<UpdateStatement>();
+    statement->table = expect_identifier("a table name");
+    expect_keyword("SET");
+    while (true) {
+        string column = expect_identifier("a column name");
+        expect_symbol("=");
+        statement->assignments.emplace_back(column, parse_literal());
+        if (!peek().is_symbol(",")) break;
+        ++pos;
+    }
+    statement->where = parse_where();
+    return statement;
+}
+
+// column | aggregate '(' ('*' | column) ')'
+SelectItem Parser::parse_select_item() {
+    SelectItem item;
+    if (peek().type != TokenType::IDENTIFIER || !tokens[pos + 1].is_symbol("(")) {
+        item.column = expect_identifier("a column name");
+        return item;
+    }
+
+    static const pair<const char*, AggregateFunction> functions[] = {
+        {"COUNT", AggregateFunction::COUNT}, {"SUM", AggregateFunction::SUM}, {"AVG", AggregateFunction::AVG},
+        {"MIN", AggregateFunction::MIN}, {"MAX", AggregateFunction::MAX}};
+    for (const auto& [name, function] : functions) {
+        if (accept_keyword(name)) {
+            expect_symbol("(");
+            item.aggregate = true;
+            item.function = function;
+            if (function == AggregateFunction::COUNT && peek().is_symbol("*")) {
+                ++pos;
+            } else {
+                item.column = expect_identifier("a column name");
+            }
+            expect_symbol(")");
+            return item;
+        }
+    }
+    fail("COUNT, SUM, AVG, MIN or MAX");
+}
+
+unique_ptr<Statement> Parser::parse_select() {
+    auto statement = make_unique<SelectStatement>();
+    if (peek().is_symbol("*")) {
+        ++pos;
+    } else {
+        if (peek().type != TokenType::IDENTIFIER) fail("'*' or a column name");
+        statement->items.push_back(parse_select_item());
+        while (peek().is_symbol(",")) {
+            ++pos;
+            statement->items.push_back(parse_select_item());
+        }
+    }
+    expect_keyword("FROM");
+    statement->table = expect_identifier("a table name");
+    bool join = accept_keyword("JOIN");
+    if (!join && accept_keyword("INNER")) {
+        expect_keyword("JOIN");
+        join = true;
+    }
+    if (join) {
+        statement->join_table = expect_identifier("a table name");
+        expect_keyword("ON");
+        statement->join_left = expect_identifier("a column name");
+        expect_symbol("=");
+        statement->join_right = expect_identifier("a column name");
+    }
+    statement->where = parse_where();
+    if (accept_keyword("GROUP")) {
+        expect_keyword("BY");
+        statement->group_by.push_back(expect_identifier("a column name"));
+        while (peek().is_symbol(",")) {
+            ++pos;
+            statement->group_by.push_back(expect_identifier("a column name"));
+        }
+    }
+    if (accept_keyword("HAVING")) {
+        having = statement.get();
+        statement->having = parse_or();
+        having = nullptr;
+    }
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_prepare() {
+    auto statement = make_unique<PrepareStatement>();
+    statement->name = expect_identifier("a statement name");
+    expect_keyword("AS");
+    if (peek().type == TokenType::END) fail("a statement");
+    statement->body = sql.substr(peek().position);
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_execute() {
+    auto statement = make_unique<ExecuteStatement>();
+    statement->name = expect_identifier("a statement name");
+    if (peek().is_symbol("(")) {
+        statement->arguments = parse_literal_list();
+        for (const auto& argument : statement->arguments) {
+            if (argument.parameter > 0) throw invalid_argument("EXECUTE arguments must be constants");
+        }
+    }
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_vacuum() {
+    auto statement = make_unique<VacuumStatement>();
+    if (peek().type == TokenType::IDENTIFIER) statement->table = tokens[pos++].text;
+    return statement;
+}
+
+unique_ptr<Statement> Parser::parse_deallocate() {
+    accept_keyword("PREPARE");
+    auto statement = make_unique<DeallocateStatement>();
+    statement->name = expect_identifier("a statement name");
+    return statement;
+}
+
+// ---------- WHERE ----------
+
+unique_ptr<Expr> Parser::parse_where() {
+    if (!accept_keyword("WHERE")) return nullptr;
+    return parse_or();
+}
+
+unique_ptr<Expr> Parser::parse_or() {
+    unique_ptr<Expr> expr = parse_and();
+    while (accept_keyword("OR")) {
+        expr = combine(Expr::Kind::OR, move(expr), parse_and());
+    }
+    return expr;
+}
+
+unique_ptr<Expr> Parser::parse_and() {
+    unique_ptr<Expr> expr = parse_primary();
+    while (accept_keyword("AND")) {
+        expr = combine(Expr::Kind::AND, move(expr), parse_primary());
+    }
+    return expr;
+}
+
+unique_ptr<Expr> Parser::parse_primary() {
+    if (peek().is_symbol("(")) {
+        ++pos;
+        unique_ptr<Expr> expr = parse_or();
+        expect_symbol(")");
+        return expr;
+    }
+
+    auto expr = make_unique<Expr>();
+    if (having) {
+        // Aggregates are output columns of the grouping, named like them.
+        SelectItem item = parse_select_item();
+        expr->column = item.name();
+        if (item.aggregate) having->having_aggregates.push_back(item);
+    } else {
+        expr->column = expect_identifier("a column name");
+    }
+    if (accept_keyword("BETWEEN")) {
+        expr->kind = Expr::Kind::BETWEEN;
+        expr->literals.push_back(parse_literal());
+        expect_keyword("AND");
+        expr->literals.push_back(parse_literal());
+        return expr;
+    }
+    if (accept_keyword("IN")) {
+        expr->kind = Expr::Kind::IN;
+        expr->literals = parse_literal_list();
+        return expr;
+    }
+
+    static const pair<const char*, CompareOp> ops[] = {
+        {"=", CompareOp::EQ}, {"<>", CompareOp::NE}, {"!=", CompareOp::NE}, {"<", CompareOp::LT},
+        {"<=", CompareOp::LE}, {">", CompareOp::GT}, {">=", CompareOp::GE}};
+    for (const auto& [text, op] : ops) {
+        if (peek().is_symbol(text)) {
+            ++pos;
+            expr->kind = Expr::Kind::COMPARE;
+            expr->op = op;
+            expr->literals.push_back(parse_literal());
+            return expr;
+        }
+    }
+    fail("a comparison operator");
+}
@@ -0,0 +1,196 @@
+#include "../../include/query/planner.h"
+#include "../../include/logger.h"
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Higher ranks select fewer rows: point lookups beat closed ranges beat
+// open ranges. NONE means the expression cannot use an index.
+enum Rank { NONE = 0, OPEN_RANGE = 1, CLOSED_RANGE = 2, POINT = 3 };
+
+struct AccessPath {
+    Rank rank = NONE;
+    vector<IndexProbe> probes;
+};
+
+AccessPath choose_leaf(IndexManager& im, const TableSchema& schema, const Expr& expr) {
+    AccessPath path;
+    for (const auto& value : expr.values) {
+        if (value.is_null) return path; // matches nothing; not worth a probe
+    }
+
+    if (expr.column_index < 0) {
+        // record_id is the heap location itself, no index needed
+        if (expr.kind == Expr::Kind::IN || (expr.kind == Expr::Kind::COMPARE && expr.op == CompareOp::EQ)) {
+            path.rank = POINT;
+            for (const auto& value : expr.values) {
+                IndexProbe probe;
+                probe.record_id = value.int_value;
+                path.probes.push_back(probe);
+            }
+        }
+        return path;
+    }
+
+    const string& column = schema.columns[expr.column_index].name;
+    if (!im.has_index(schema.table_name, column)) return path;
+    // Hash indexes answer equality only.
+    bool ordered = im.has_ordered_index(schema.table_name, column);
+
+    IndexProbe probe;
+    probe.column = column;
+    switch (expr.kind) {
+    case Expr::Kind::IN:
+        path.rank = POINT;
+        probe.exact = true;
+        for (const auto& value : expr.values) {
+            probe.low_key = value.index_key();
+            path.probes.push_back(probe);
+        }
+        return path;
+    case Expr::Kind::BETWEEN:
+        if (!ordered) return path;
+        path.rank = CLOSED_RANGE;
+        probe.low_key = expr.values[0].index_key();
+        probe.high_key = expr.values[1].index_key();
+        probe.has_high = true;
+        break;
+    case Expr::Kind::COMPARE:
+        switch (expr.op) {
+        case CompareOp::EQ:
+            path.rank = POINT;
+            probe.low_key = expr.values[0].index_key();
+            probe.exact = true;
+            break;
+        case CompareOp::LT:
+        case CompareOp::LE:
+            if (!ordered) return path;
+            path.rank = OPEN_RANGE;
+            probe.high_key = expr.values[0].index_key();
+            probe.has_high = true;
+            break;
+        case CompareOp::GT:
+        case CompareOp::GE:
+            if (!ordered) return path;
+            path.rank = OPEN_RANGE;
+            probe.low_key = expr.values[0].index_key();
+            break;
+        case CompareOp::NE:
+            return path;
+        }
+        break;
+    default:
+        return path;
+    }
+    path.probes.push_back(probe);
+    return path;
+}
+
+AccessPath choose(IndexManager& im, const TableSchema& schema, const Expr& expr) {
+    if (expr.kind == Expr::Kind::AND) {
+        AccessPath left = choose(im, schema, *expr.left);
+        AccessPath right = choose(im, schema, *expr.right);
+        return right.rank > left.rank ? right : left;
+    }
+    if (expr.kind == Expr::Kind::OR) {
+        AccessPath left = choose(im, schema, *expr.left);
+        AccessPath right = choose(im, schema, *expr.right);
+        if (left.rank == NONE || right.rank == NONE) return AccessPath();
+        left.rank = min(left.rank, right.rank);
+        left.probes.insert(left.probes.end(), right.probes.begin(), right.probes.end());
+        return left;
+    }
+    return choose_leaf(im, schema, expr);
+}
+
+} // namespace
+
+size_t scan_threads(RecordManager& rm, const TableSchema& schema) {
+    if (rm.get_segment_pages(schema.segment_id).size() < PARALLEL_SCAN_MIN_PAGES) return 1;
+    return parallel_scan_threads();
+}
+
+unique_ptr<Operator> plan_scan(RecordManager& rm, IndexManager& im, ColumnStore& cs, const TableSchema& schema,
+                               shared_ptr<const Snapshot> snapshot, const Expr* predicate, const vector<bool>& columns) {
+    if (schema.storage == TableStorage::COLUMN) {
+        LOG_DEBUG(QUERY, "Table '" << schema.table_name << "': column scan"
+                                    << (predicate ? ", filter " + predicate->to_string() : string()));
+        return make_unique<ColumnScan>(cs.open_table(schema.segment_id, schema.column_meta_page), schema, snapshot,
+                                       predicate, columns);
+    }
+
+    AccessPath path = predicate ? choose(im, schema, *predicate) : AccessPath();
+    if (path.rank == NONE) {
+        size_t threads = scan_threads(rm, schema);
+        if (threads > 1) {
+            LOG_DEBUG(QUERY, "Table '" << schema.table_name << "': parallel scan"
+                                        << (predicate ? ", filter " + predicate->to_string() : string()));
+            return make_unique<ParallelScan>(rm, schema, snapshot, predicate, threads, columns);
+        }
+    }
+
+    if (!predicate) {
+        LOG_DEBUG(QUERY, "Table '" << schema.table_name << "': sequential scan");
+        return make_unique<SeqScan>(rm, schema, snapshot, columns);
+    }
+
+    unique_ptr<Operator> input;
+    if (path.rank == NONE) {
+        LOG_DEBUG(QUERY, "Table '" << schema.table_name << "': sequential scan, filter "
+                                    << predicate->to_string());
+        input = make_unique<SeqScan>(rm, schema, snapshot, columns);
+    } else {
+        LOG_DEBUG(QUERY, "Table '" << schema.table_name << "': index scan with "
+                                    << path.probes.size() << " probe(s), filter " << predicate->to_string());
+        input = make_unique<IndexScan>(rm, im, schema, snapshot, move(path.probes), columns);
+    }
+    return make_unique<Filter>(move(input), predicate);
+}
+
+unique_ptr<Operator> plan_join(RecordManager& rm, IndexManager& im, ColumnStore& cs, const TableSchema& left,
+                               const TableSchema& right, int left_key, int right_key,
+                               shared_ptr<const Snapshot> snapshot, const Expr* left_predicate,
+                               const Expr* right_predicate, const vector<bool>& left_columns,
+                               const vector<bool>& right_columns) {
+    const Column& left_column = left.columns[left_key];
+    const Column& right_column = right.columns[right_key];
+    if (!joinable(left_column.type, right_column.type)) {
+        throw invalid_argument("Cannot join " + left.table_name + "." + left_column.name + " (" +
+                               left_column.type_name() + ") with " + right.table_name + "." + right_column.name +
+                               " (" + right_column.type_name() + ")");
+    }
+
+    vector<Column> columns;
+    for (const TableSchema* schema : {&left, &right}) {
+        for (Column column : schema->columns) {
+            column.name = schema->table_name + "." + column.name;
+            columns.push_back(column);
+        }
+    }
+
+    auto indexed = [&](const TableSchema& schema, const Column& column) {
+        return schema.storage == TableStorage::ROW && im.has_index(schema.table_name, column.name);
+    };
+    bool right_inner = indexed(right, right_column);
+    if (right_inner || indexed(left, left_column)) {
+        const TableSchema& inner = right_inner ? right : left;
+        const TableSchema& outer = right_inner ? left : right;
+        LOG_DEBUG(QUERY, "Join of '" << left.table_name << "' and '" << right.table_name
+                                     << "': index nested-loop join probing '" << inner.table_name << "'");
+        return make_unique<IndexNestedLoopJoin>(
+            plan_scan(rm, im, cs, outer, snapshot, right_inner ? left_predicate : right_predicate,
+                      right_inner ? left_columns : right_columns),
+            rm, im, inner, snapshot, right_inner ? left_key : right_key, right_inner ? right_key : left_key,
+            right_inner ? right_predicate : left_predicate, right_inner ? right_columns : left_columns, right_inner,
+            move(columns));
+    }
+
+    bool build_left = rm.get_segment_pages(left.segment_id).size() < rm.get_segment_pages(right.segment_id).size();
+    LOG_DEBUG(QUERY, "Join of '" << left.table_name << "' and '" << right.table_name << "': hash join building on '"
+                                 << (build_left ? left : right).table_name << "'");
+    return make_unique<HashJoin>(plan_scan(rm, im, cs, left, snapshot, left_predicate, left_columns),
+                                 plan_scan(rm, im, cs, right, snapshot, right_predicate, right_columns), left_key,
+                                 right_key, build_left, join_memory_budget(), move(columns));
+}
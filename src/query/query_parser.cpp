@@ -1,102 +1,90 @@
 #include "../../include/query/query_parser.h"
-#include <sstream>
-#include <iostream>
+#include "../../include/logger.h"
+#include "../../include/query/csv_reader.h"
 #include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <strings.h>
 
 using namespace std;
 
+// COPY hands rows to the table manager in batches of this many.
+const size_t COPY_BATCH_ROWS = 65536;
+
 QueryParser::QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im)
     : catalog_manager(cm), table_manager(tm), index_manager(im) {}
 
 
 bool QueryParser::execute_query(const std::string& query) {
-    string q = query;
-    transform(q.begin(), q.end(), q.begin(), ::tolower);
-
-    if (q.find("create table") == 0) {
-        return parse_create_table(query);
-    } else if (q.find("drop table") == 0) {
-        return parse_drop_table(query);
-    } else if (q.find("insert into") == 0) {
-        return parse_insert(query);
-    } else if (q.find("delete from") == 0) {
-        return parse_delete(query);
-    } else if (q.find("update") == 0) {
-        return parse_update(query);
-    } else if (q.find("select * from") == 0) {
-        return parse_print_table(query);
-    } else if (q.find("select") == 0) {
-        return parse_select(query);
+    try {
+        shared_ptr<const Statement> statement = statement_cache.get(query);
+        if (statement->parameter_count > 0) {
+            cout << "[ERROR] Parameters ($n) can only be used in PREPARE." << endl;
+            return false;
+        }
+        return execute(*statement, {});
+    } catch (const std::exception& e) {
+        cout << "[ERROR] " << e.what() << endl;
+        return false;
+    }
+}
+
+bool QueryParser::execute(const Statement& statement, const vector<Literal>& parameters) {
+    unique_lock<mutex> writer;
+    if (changes_database(statement.type)) writer = unique_lock<mutex>(table_manager.write_latch());
+
+    switch (statement.type) {
+    case StatementType::CREATE_TABLE:
+        return execute_create_table(static_cast<const CreateTableStatement&>(statement));
+    case StatementType::DROP_TABLE:
+        return execute_drop_table(static_cast<const DropTableStatement&>(statement));
+    case StatementType::CREATE_INDEX:
+        return execute_create_index(static_cast<const CreateIndexStatement&>(statement));
+    case StatementType::DROP_INDEX:
+        return execute_drop_index(static_cast<const DropIndexStatement&>(statement));
+    case StatementType::INSERT:
+        return execute_insert(static_cast<const InsertStatement&>(statement), parameters);
+    case StatementType::DELETE:
+        return execute_delete(static_cast<const DeleteStatement&>(statement), parameters);
+    case StatementType::UPDATE:
+        return execute_update(static_cast<const UpdateStatement&>(statement), parameters);
+    case StatementType::SELECT:
+        return execute_select(static_cast<const SelectStatement&>(statement), parameters);
+    case StatementType::PREPARE:
+        return execute_prepare(static_cast<const PrepareStatement&>(statement));
+    case StatementType::EXECUTE:
+        return execute_execute(static_cast<const ExecuteStatement&>(statement));
+    case StatementType::DEALLOCATE:
+        return execute_deallocate(static_cast<const DeallocateStatement&>(statement));
+    case StatementType::COPY:
+        return execute_copy(static_cast<const CopyStatement&>(statement));
+    case StatementType::VACUUM:
+        return execute_vacuum(static_cast<const VacuumStatement&>(statement));
     }
 
     cout << "[ERROR] Unsupported or invalid query." << endl;
     return false;
 }
 
-void QueryParser::trim(string& s) {
-    const char* whitespace = " \t\n\r";
-    size_t start = s.find_first_not_of(whitespace);
-    size_t end = s.find_last_not_of(whitespace);
-    if (start == string::npos || end == string::npos) {
-        s = "";
-    } else {
-        s = s.substr(start, end - start + 1);
-    }
+bool QueryParser::changes_database(StatementType type) {
+    return type != StatementType::SELECT && type != StatementType::PREPARE && type != StatementType::EXECUTE &&
+           type != StatementType::DEALLOCATE;
 }
 
-vector<string> QueryParser::split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter)) {
-        trim(token);
-        tokens.push_back(token);
+TableSchema QueryParser::get_table(const string& table_name) {
+    TableSchema schema = catalog_manager.get_schema(table_name);
+    if (schema.table_name.empty()) {
+        throw invalid_argument("Table '" + table_name + "' does not exist");
     }
-    return tokens;
+    return schema;
 }
 
 
-bool QueryParser::parse_create_table(const std::string& query) {
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos1 = query_lower.find("table");
-    if (pos1 == std::string::npos) {
-        cout << "[ERROR] Syntax error in CREATE TABLE." << endl;
-        return false;
-    }
-
-    // Use pos1 to slice the original query to preserve case
-    std::string after_table = query.substr(pos1 + 5);
-    trim(after_table);
-
-    size_t pos_paren_open = after_table.find('(');
-    size_t pos_paren_close = after_table.find(')');
-
-    if (pos_paren_open == std::string::npos || pos_paren_close == std::string::npos || pos_paren_close < pos_paren_open) {
-        cout << "[ERROR] Syntax error: missing parentheses in CREATE TABLE." << endl;
-        return false;
-    }
-
-    std::string table_name = after_table.substr(0, pos_paren_open);
-    trim(table_name);
-
-    std::string cols_str = after_table.substr(pos_paren_open + 1, pos_paren_close - pos_paren_open - 1);
-
-    // Remove trailing semicolon if present
-    if (!cols_str.empty() && cols_str.back() == ';') {
-        cols_str.pop_back();
-    }
-
-    vector<string> columns = split(cols_str, ',');
-    if (columns.empty()) {
-        cout << "[ERROR] No columns specified for CREATE TABLE." << endl;
-        return false;
-    }
-
-    bool success = catalog_manager.create_table(table_name, columns);
+bool QueryParser::execute_create_table(const CreateTableStatement& statement) {
+    bool success = catalog_manager.create_table(statement.table, statement.columns, statement.storage);
     if (success) {
-        cout << "[INFO] Table '" << table_name << "' created." << endl;
+        cout << "[INFO] Table '" << statement.table << "' created." << endl;
     } else {
         cout << "[ERROR] Table creation failed. Table may already exist." << endl;
     }
@@ -104,373 +92,518 @@ bool QueryParser::parse_create_table(const std::string& query) {
 }
 
 
-bool QueryParser::parse_drop_table(const std::string& query) {
-    // Expected format: DROP TABLE table_name;
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos1 = query_lower.find("table");
-    if (pos1 == string::npos) {
-        cout << "[ERROR] Syntax error in DROP TABLE." << endl;
-        return false;
-    }
-    string after_table = query.substr(pos1 + 5);
-    trim(after_table);
-
-    string table_name = after_table;
-    // Remove trailing semicolon if exists
-    if (!table_name.empty() && table_name.back() == ';') {
-        table_name.pop_back();
-        trim(table_name);
-    }
-
-    bool success = catalog_manager.drop_table(table_name);
+bool QueryParser::execute_drop_table(const DropTableStatement& statement) {
+    bool success = catalog_manager.drop_table(statement.table);
     if (success) {
-        cout << "[INFO] Table '" << table_name << "' dropped." << endl;
+        cout << "[INFO] Table '" << statement.table << "' dropped." << endl;
     } else {
         cout << "[ERROR] Table drop failed. Table may not exist." << endl;
     }
     return success;
 }
 
-bool QueryParser::parse_insert(const std::string& query) {
-    // Expected format:
-    // INSERT INTO table_name [(col1, col2, ...)] VALUES (val1, val2, ...);
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
+bool QueryParser::execute_create_index(const CreateIndexStatement& statement) {
+    size_t entries = table_manager.create_index(statement.name, statement.table, statement.column, statement.unique, statement.type);
+    cout << "[INFO] Index '" << statement.name << "' created on " << statement.table << "(" << statement.column
+         << ") with " << entries << " entries." << endl;
+    return true;
+}
 
-    size_t pos_into = query_lower.find("into");
-    if (pos_into == string::npos) {
-        cout << "[ERROR] Syntax error in INSERT INTO." << endl;
-        return false;
+bool QueryParser::execute_drop_index(const DropIndexStatement& statement) {
+    bool success = catalog_manager.drop_index(statement.name);
+    if (success) {
+        cout << "[INFO] Index '" << statement.name << "' dropped." << endl;
+    } else {
+        cout << "[ERROR] Index '" << statement.name << "' does not exist." << endl;
     }
-    string after_into = query.substr(pos_into + 4);
-    trim(after_into);
+    return success;
+}
 
-    size_t pos_values = query_lower.substr(pos_into + 4).find("values");
-    if (pos_values == string::npos) {
-        cout << "[ERROR] Syntax error: missing VALUES clause." << endl;
-        return false;
+// Without a column list, values are in schema order. Otherwise they are
+// reordered to match the schema; columns left out are NULL.
+vector<int> QueryParser::target_columns(const TableSchema& schema, const vector<string>& columns) {
+    vector<int> targets;
+    if (columns.empty()) {
+        for (size_t i = 0; i < schema.columns.size(); ++i) targets.push_back(static_cast<int>(i));
+        return targets;
     }
-
-    // Extract table name and optional column list
-    string table_and_cols = after_into.substr(0, pos_values);
-    trim(table_and_cols);
-
-    string table_name;
-    vector<string> column_list;
-    size_t paren_open = table_and_cols.find('(');
-    size_t paren_close = table_and_cols.find(')');
-    if (paren_open != string::npos && paren_close != string::npos && paren_close > paren_open) {
-        // There is a column list
-        table_name = table_and_cols.substr(0, paren_open);
-        trim(table_name);
-        string cols_str = table_and_cols.substr(paren_open + 1, paren_close - paren_open - 1);
-        column_list = split(cols_str, ',');
-    } else {
-        // No column list
-        table_name = table_and_cols;
-        trim(table_name);
+    for (const auto& column : columns) {
+        int idx = schema.column_index(column);
+        if (idx < 0) {
+            throw invalid_argument("Column '" + column + "' not found in table '" + schema.table_name + "'.");
+        }
+        targets.push_back(idx);
     }
+    return targets;
+}
 
-    string after_values = after_into.substr(pos_values + 6);
-    trim(after_values);
-
-    if (after_values.empty() || after_values.front() != '(' || (after_values.back() != ';' && after_values.back() != ')')) {
-        cout << "[ERROR] Syntax error in VALUES clause." << endl;
-        return false;
+vector<Value> QueryParser::bind_row(const TableSchema& schema, const vector<int>& targets,
+                                    const vector<Literal>& literals, const vector<Literal>& parameters) {
+    if (literals.size() != targets.size()) {
+        throw invalid_argument("Number of columns and values do not match.");
     }
-
-    // remove trailing ';' if exists
-    if (after_values.back() == ';') {
-        after_values.pop_back();
+    vector<Value> values;
+    values.reserve(schema.columns.size());
+    for (const auto& column : schema.columns) {
+        values.push_back(Value::make_null(column.type));
     }
-
-    if (after_values.front() == '(' && after_values.back() == ')') {
-        after_values = after_values.substr(1, after_values.size() - 2);
+    for (size_t i = 0; i < targets.size(); ++i) {
+        values[targets[i]] = literals[i].bind(schema.columns[targets[i]], parameters);
     }
+    return values;
+}
 
-    vector<string> values = split(after_values, ',');
+bool QueryParser::execute_insert(const InsertStatement& statement, const vector<Literal>& parameters) {
+    TableSchema schema = get_table(statement.table);
+    vector<int> targets = target_columns(schema, statement.columns);
 
-    // If column_list is empty, assume all columns in schema order
-    // Otherwise, reorder values to match schema order
-    if (!column_list.empty()) {
-        auto schema = catalog_manager.get_schema(table_name);
-        if (schema.columns.size() != values.size() || column_list.size() != values.size()) {
-            cout << "[ERROR] Number of columns and values do not match." << endl;
+    if (statement.rows.size() == 1) {
+        int64_t record_id = table_manager.insert_into(schema.table_name, bind_row(schema, targets, statement.rows[0], parameters));
+        if (record_id == -1) {
+            cout << "[ERROR] Insert failed." << endl;
             return false;
         }
-        // Map column_list to schema order
-        vector<string> reordered_values(schema.columns.size());
-        for (size_t i = 0; i < column_list.size(); ++i) {
-            string col = column_list[i];
-            trim(col);
-            auto it = std::find(schema.columns.begin(), schema.columns.end(), col);
-            if (it == schema.columns.end()) {
-                cout << "[ERROR] Column '" << col << "' not found in table '" << table_name << "'." << endl;
-                return false;
-            }
-            size_t idx = std::distance(schema.columns.begin(), it);
-            reordered_values[idx] = values[i];
-        }
-        values = reordered_values;
+        cout << "[INFO] Inserted record ID: " << record_id << endl;
+        return true;
     }
 
-    int record_id = table_manager.insert_into(table_name, values);
-    if (record_id == -1) {
-        cout << "[ERROR] Insert failed." << endl;
-        return false;
+    // Every row is bound before anything is written, so a bad value in any
+    // row leaves the table unchanged.
+    vector<vector<Value>> rows;
+    rows.reserve(statement.rows.size());
+    for (const auto& literals : statement.rows) {
+        rows.push_back(bind_row(schema, targets, literals, parameters));
     }
-
-    cout << "[INFO] Inserted record ID: " << record_id << endl;
+    size_t inserted = table_manager.insert_rows(schema.table_name, rows);
+    cout << "[INFO] Inserted " << inserted << " records." << endl;
     return true;
 }
 
-bool QueryParser::parse_delete(const std::string& query) {
-    // Expected format:
-    // DELETE FROM table_name WHERE record_id = some_id;
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos_from = query_lower.find("from");
-    if (pos_from == string::npos) {
-        cout << "[ERROR] Syntax error in DELETE." << endl;
-        return false;
-    }
-    string after_from = query.substr(pos_from + 4);
-    trim(after_from);
-
-    size_t pos_where = query_lower.substr(pos_from + 4).find("where");
-    if (pos_where == string::npos) {
-        cout << "[ERROR] DELETE requires WHERE clause." << endl;
-        return false;
+bool QueryParser::execute_copy(const CopyStatement& statement) {
+    TableSchema schema = get_table(statement.table);
+    vector<int> targets = target_columns(schema, statement.columns);
+    CsvReader reader(statement.path);
+
+    vector<Literal> fields;
+    if (statement.header) reader.next_row(fields);
+
+    // Rows go in batch by batch; an error stops the load but keeps the
+    // batches already written.
+    vector<vector<Value>> batch;
+    size_t copied = 0;
+    try {
+        while (reader.next_row(fields)) {
+            try {
+                batch.push_back(bind_row(schema, targets, fields, {}));
+            } catch (const invalid_argument& e) {
+                throw invalid_argument("Line " + to_string(reader.row_line()) + " of '" + statement.path + "': " + e.what());
+            }
+            if (batch.size() == COPY_BATCH_ROWS) {
+                copied += table_manager.insert_rows(schema.table_name, batch);
+                batch.clear();
+            }
+        }
+        if (!batch.empty()) copied += table_manager.insert_rows(schema.table_name, batch);
+    } catch (const exception&) {
+        if (copied > 0) cout << "[INFO] " << copied << " rows were copied before the error." << endl;
+        throw;
     }
-    string table_name = after_from.substr(0, pos_where);
-    trim(table_name);
 
-    string where_clause = after_from.substr(pos_where + 5);
-    trim(where_clause);
+    cout << "[INFO] Copied " << copied << " rows into '" << schema.table_name << "'." << endl;
+    return true;
+}
 
-    // Currently support only WHERE record_id = <id>
-    string prefix = "record_id =";
-    if (where_clause.find(prefix) != 0) {
-        cout << "[ERROR] DELETE only supports WHERE record_id = <id> for now." << endl;
+bool QueryParser::execute_delete(const DeleteStatement& statement, const vector<Literal>& parameters) {
+    TableSchema schema = get_table(statement.table);
+    if (!statement.where) {
+        cout << "[ERROR] DELETE requires WHERE clause." << endl;
         return false;
     }
-    string id_str = where_clause.substr(prefix.size());
-    trim(id_str);
+    unique_ptr<Expr> where = statement.where->bind(schema, parameters);
 
-    // remove trailing ';' if any
-    if (!id_str.empty() && id_str.back() == ';') {
-        id_str.pop_back();
+    // Collect first, so the scan never sees its own deletions.
+    vector<int64_t> record_ids;
+    unique_ptr<Operator> plan = table_manager.scan(schema.table_name, where.get());
+    Tuple tuple;
+    plan->open();
+    while (plan->next(tuple)) {
+        record_ids.push_back(tuple.record_id);
     }
+    plan->close();
 
-    int record_id = stoi(id_str);
-
-    bool success = table_manager.delete_from(table_name, record_id);
-    if (!success) {
-        cout << "[ERROR] Delete failed." << endl;
-    } else {
-        cout << "[INFO] Record deleted successfully." << endl;
-    }
-    return success;
+    size_t deleted = table_manager.delete_rows(schema.table_name, record_ids);
+    cout << "[INFO] " << deleted << " record(s) deleted." << endl;
+    return true;
 }
 
-bool QueryParser::parse_update(const std::string& query) {
-    // Expected format:
-    // UPDATE table_name SET col1 = val1, col2 = val2 WHERE record_id = some_id;
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos_set = query_lower.find("set");
-    if (pos_set == string::npos) {
-        cout << "[ERROR] Syntax error in UPDATE: missing SET." << endl;
+bool QueryParser::execute_update(const UpdateStatement& statement, const vector<Literal>& parameters) {
+    TableSchema schema = get_table(statement.table);
+    if (!statement.where) {
+        cout << "[ERROR] UPDATE requires WHERE clause." << endl;
         return false;
     }
-    string before_set = query.substr(6, pos_set - 6); // 6 is length of "update"
-    trim(before_set);
-    string table_name = before_set;
 
-    size_t pos_where = query_lower.find("where");
-    if (pos_where == string::npos) {
-        cout << "[ERROR] UPDATE requires WHERE clause." << endl;
-        return false;
+    vector<pair<int, Value>> assignments;
+    for (const auto& [col, literal] : statement.assignments) {
+        int col_idx = schema.column_index(col);
+        if (col_idx < 0) {
+            cout << "[ERROR] Column '" << col << "' not found in table '" << schema.table_name << "'." << endl;
+            return false;
+        }
+        assignments.emplace_back(col_idx, literal.bind(schema.columns[col_idx], parameters));
+    }
+    unique_ptr<Expr> where = statement.where->bind(schema, parameters);
+
+    // Collect the new rows first; a row that moves must not be seen twice.
+    vector<Tuple> rows;
+    unique_ptr<Operator> plan = table_manager.scan(schema.table_name, where.get());
+    Tuple tuple;
+    plan->open();
+    while (plan->next(tuple)) {
+        for (const auto& [col_idx, value] : assignments) {
+            tuple.values[col_idx] = value;
+        }
+        rows.push_back(tuple);
     }
-    string set_clause = query.substr(pos_set + 3, pos_where - (pos_set + 3));
-    trim(set_clause);
+    plan->close();
 
-    string where_clause = query.substr(pos_where + 5);
-    trim(where_clause);
+    size_t updated = table_manager.update_rows(schema.table_name, rows);
+    cout << "[INFO] " << updated << " record(s) updated." << endl;
+    return true;
+}
 
-    // parse record_id from WHERE clause (support only record_id = <id>)
-    string prefix = "record_id =";
-    if (where_clause.find(prefix) != 0) {
-        cout << "[ERROR] UPDATE only supports WHERE record_id = <id> for now." << endl;
-        return false;
-    }
-    string id_str = where_clause.substr(prefix.size());
-    trim(id_str);
-    if (!id_str.empty() && id_str.back() == ';') {
-        id_str.pop_back();
-    }
-    int record_id = stoi(id_str);
+int QueryParser::SelectSource::find_column(const string& name) const {
+    int index = schema.column_index(name);
+    if (index >= 0) return index;
+    if (!join) {
+        const string prefix = schema.table_name + ".";
+        return name.compare(0, prefix.size(), prefix) == 0 ? schema.column_index(name.substr(prefix.size())) : -1;
+    }
+    const string suffix = "." + name;
+    for (size_t i = 0; i < schema.columns.size(); ++i) {
+        const string& column = schema.columns[i].name;
+        if (column.size() <= suffix.size()) continue;
+        if (column.compare(column.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+        if (index >= 0) throw invalid_argument("Column '" + name + "' is ambiguous; write it as table.column");
+        index = static_cast<int>(i);
+    }
+    return index;
+}
 
-    // parse set clause: col1=val1, col2=val2
-    vector<string> assignments = split(set_clause, ',');
-    if (assignments.empty()) {
-        cout << "[ERROR] No assignments in SET clause." << endl;
-        return false;
+QueryParser::SelectSource QueryParser::open_source(const SelectStatement& statement,
+                                                   const vector<Literal>& parameters) {
+    SelectSource source;
+    source.left = get_table(statement.table);
+    if (statement.join_table.empty()) {
+        source.schema = source.left;
+    } else {
+        source.join = true;
+        source.right = get_table(statement.join_table);
+        if (source.right.table_name == source.left.table_name) {
+            throw invalid_argument("Table '" + source.left.table_name + "' cannot be joined with itself");
+        }
+        source.schema.table_name = source.left.table_name + " JOIN " + source.right.table_name;
+        for (const TableSchema* table : {&source.left, &source.right}) {
+            for (Column column : table->columns) {
+                column.name = table->table_name + "." + column.name;
+                source.schema.columns.push_back(column);
+            }
+        }
     }
+    // Names as they appear in source.schema
+    auto qualify = [&](const string& name) {
+        int index = source.find_column(name);
+        if (index >= 0) return source.schema.columns[index].name;
+        if (source.join && strcasecmp(name.c_str(), RECORD_ID_COLUMN) == 0) {
+            throw invalid_argument(string(RECORD_ID_COLUMN) + " is ambiguous in a join; write it as table." +
+                                   RECORD_ID_COLUMN);
+        }
+        return name;
+    };
 
-    // fetch current record and schema
-    auto schema = catalog_manager.get_schema(table_name);
-    if (schema.columns.empty()) {
-        cout << "[ERROR] Table '" << table_name << "' does not exist." << endl;
-        return false;
+    if (!source.join) {
+        if (statement.where) source.where = statement.where->rename(qualify)->bind(source.schema, parameters);
+        return source;
     }
 
-    // Get the current record data as vector<string>
-    Record rec = table_manager.select(table_name, record_id);
-    vector<string> current_record;
-    for (const auto& c : rec.data) {
-        current_record.push_back(string(1, c));
+    const int left_count = static_cast<int>(source.left.columns.size());
+    int left_key = source.find_column(statement.join_left);
+    int right_key = source.find_column(statement.join_right);
+    for (const auto& [key, name] :
+         {make_pair(left_key, statement.join_left), make_pair(right_key, statement.join_right)}) {
+        if (key < 0) {
+            throw invalid_argument("Column '" + name + "' not found in table '" + source.schema.table_name + "'");
+        }
     }
-    if (current_record.empty()) {
-        cout << "[ERROR] Record ID " << record_id << " not found." << endl;
-        return false;
+    if ((left_key < left_count) == (right_key < left_count)) {
+        throw invalid_argument("JOIN ... ON must compare a column of '" + source.left.table_name + "' with one of '" +
+                               source.right.table_name + "'");
+    }
+    if (left_key >= left_count) swap(left_key, right_key);
+    source.left_key = left_key;
+    source.right_key = right_key - left_count;
+    if (!statement.where) return source;
+
+    // Split the WHERE into its top-level conjuncts and hand each to the
+    // table it reads, if it reads one only.
+    vector<unique_ptr<Expr>> conjuncts;
+    vector<unique_ptr<Expr>> pending;
+    pending.push_back(statement.where->rename(qualify));
+    while (!pending.empty()) {
+        unique_ptr<Expr> expr = move(pending.back());
+        pending.pop_back();
+        if (expr->kind == Expr::Kind::AND) {
+            pending.push_back(move(expr->left));
+            pending.push_back(move(expr->right));
+        } else {
+            conjuncts.push_back(move(expr));
+        }
     }
-
-    // update fields
-    for (const string& assign : assignments) {
-        size_t eq_pos = assign.find('=');
-        if (eq_pos == string::npos) {
-            cout << "[ERROR] Invalid assignment: " << assign << endl;
-            return false;
+    auto conjoin = [](unique_ptr<Expr> all, unique_ptr<Expr> expr) {
+        if (!all) return expr;
+        auto both = make_unique<Expr>();
+        both->kind = Expr::Kind::AND;
+        both->left = move(all);
+        both->right = move(expr);
+        return both;
+    };
+    // 0: left, 1: right, -1: a column of the join or an unknown one
+    auto side = [&](const string& column) {
+        for (int i = 0; i < 2; ++i) {
+            const TableSchema& table = i == 0 ? source.left : source.right;
+            if (column == table.table_name + "." + RECORD_ID_COLUMN) return i;
         }
-        string col = assign.substr(0, eq_pos);
-        string val = assign.substr(eq_pos + 1);
-        trim(col);
-        trim(val);
-
-        // find index of column in schema
-        auto it = find(schema.columns.begin(), schema.columns.end(), col);
-        if (it == schema.columns.end()) {
-            cout << "[ERROR] Column '" << col << "' not found in table '" << table_name << "'." << endl;
-            return false;
+        int index = source.schema.column_index(column);
+        return index < 0 ? -1 : (index < left_count ? 0 : 1);
+    };
+
+    unique_ptr<Expr> table_where[2];
+    unique_ptr<Expr> rest;
+    for (auto& conjunct : conjuncts) {
+        int table = -2; // none seen yet
+        vector<const Expr*> leaves{conjunct.get()};
+        while (!leaves.empty()) {
+            const Expr* expr = leaves.back();
+            leaves.pop_back();
+            if (expr->left) {
+                leaves.push_back(expr->left.get());
+                leaves.push_back(expr->right.get());
+                continue;
+            }
+            int leaf = side(expr->column);
+            table = table == -2 || table == leaf ? leaf : -1;
         }
-        int col_idx = distance(schema.columns.begin(), it);
-        current_record[col_idx] = val;
-    }
-
-    // update record in table
-    bool success = table_manager.update(table_name, record_id, current_record);
-    if (success) {
-        cout << "[INFO] Record updated successfully." << endl;
-    } else {
-        cout << "[ERROR] Update failed." << endl;
-    }
-    return success;
+        if (table < 0) {
+            rest = conjoin(move(rest), move(conjunct));
+            continue;
+        }
+        size_t prefix = (table == 0 ? source.left : source.right).table_name.size() + 1;
+        table_where[table] = conjoin(move(table_where[table]),
+                                     conjunct->rename([prefix](const string& name) { return name.substr(prefix); }));
+    }
+    if (table_where[0]) source.left_where = table_where[0]->bind(source.left, parameters);
+    if (table_where[1]) source.right_where = table_where[1]->bind(source.right, parameters);
+    if (rest) source.where = rest->bind(source.schema, parameters);
+    return source;
 }
 
-bool QueryParser::parse_select(const std::string& query) {
-    // Support only:
-    // SELECT * FROM table_name WHERE record_id = some_id;
-    // or
-    // SELECT * FROM table_name;
-    std::string query_lower = query;
-    std::transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos_from = query_lower.find("from");
-    if (pos_from == string::npos) {
-        cout << "[ERROR] Syntax error in SELECT: missing FROM." << endl;
-        return false;
-    }
+unique_ptr<Operator> QueryParser::plan_source(const SelectSource& source, const vector<bool>& used) {
+    if (!source.join) return table_manager.scan(source.left.table_name, source.where.get(), used);
+
+    vector<bool> left_used;
+    vector<bool> right_used;
+    if (!used.empty()) {
+        left_used.assign(used.begin(), used.begin() + source.left.columns.size());
+        right_used.assign(used.begin() + source.left.columns.size(), used.end());
+        left_used[source.left_key] = true;
+        right_used[source.right_key] = true;
+        if (source.left_where) source.left_where->mark_columns(left_used);
+        if (source.right_where) source.right_where->mark_columns(right_used);
+    }
+    unique_ptr<Operator> plan =
+        table_manager.join(source.left, source.right, source.left_key, source.right_key, source.left_where.get(),
+                           source.right_where.get(), left_used, right_used);
+    if (source.where) plan = make_unique<Filter>(move(plan), source.where.get());
+    return plan;
+}
 
-    string after_from = query.substr(pos_from + 4);
-    trim(after_from);
+bool QueryParser::execute_select(const SelectStatement& statement, const vector<Literal>& parameters) {
+    SelectSource source = open_source(statement, parameters);
+    const TableSchema& schema = source.schema;
+    if (statement.aggregates()) return execute_aggregate(statement, source, parameters);
 
-    // Check for WHERE clause
-    size_t pos_where = query_lower.substr(pos_from + 4).find("where");
-    string table_name;
-    string where_clause;
-    if (pos_where == string::npos) {
-        // No WHERE, select all
-        table_name = after_from;
-        // Remove trailing semicolon if exists
-        if (!table_name.empty() && table_name.back() == ';') {
-            table_name.pop_back();
+    unique_ptr<Operator> plan;
+    if (statement.items.empty()) {
+        plan = plan_source(source, {});
+    } else {
+        // Only the projected and filtered columns are decoded.
+        vector<int> indexes;
+        vector<bool> used(schema.columns.size(), false);
+        for (const auto& item : statement.items) {
+            const string& col = item.column;
+            int idx = source.find_column(col);
+            if (idx < 0) {
+                cout << "[ERROR] Column '" << col << "' not found in table '" << schema.table_name << "'." << endl;
+                return false;
+            }
+            indexes.push_back(idx);
+            used[idx] = true;
         }
-        trim(table_name);
+        if (source.where) source.where->mark_columns(used);
+        plan = make_unique<Projection>(plan_source(source, used), move(indexes));
+    }
 
-        vector<Record> records = table_manager.scan(table_name);
-        if (records.empty()) {
-            cout << "[INFO] No records found in '" << table_name << "'." << endl;
-            return true;
-        }
+    table_manager.print(*plan);
+    return true;
+}
 
-        // Print header
-        auto schema = catalog_manager.get_schema(table_name);
-        for (const auto& col : schema.columns) {
-            cout << col << "\t";
+// source -> HashAggregate -> Filter (HAVING) -> Projection. The aggregate
+// computes the group columns, the listed aggregates and those only HAVING
+// uses; the projection puts the listed ones in SELECT order.
+bool QueryParser::execute_aggregate(const SelectStatement& statement, const SelectSource& source,
+                                    const vector<Literal>& parameters) {
+    const TableSchema& schema = source.schema;
+    if (statement.items.empty()) {
+        cout << "[ERROR] SELECT * cannot be used with aggregates or GROUP BY." << endl;
+        return false;
+    }
+    auto resolve = [&](const string& column) {
+        int index = source.find_column(column);
+        if (index < 0) {
+            throw invalid_argument("Column '" + column + "' not found in table '" + schema.table_name + "'");
         }
-        cout << endl;
-
-        // Print rows
-        for (const auto& rec : records) {
-            string rec_str(rec.data.begin(), rec.data.end());
-            vector<string> row = split(rec_str, '|');
-            for (const auto& val : row) {
-                cout << val << "\t";
+        return index;
+    };
+
+    vector<bool> used(schema.columns.size(), false);
+    vector<int> group_by;
+    for (const auto& column : statement.group_by) {
+        group_by.push_back(resolve(column));
+        used[group_by.back()] = true;
+    }
+
+    vector<AggregateSpec> aggregates;
+    auto add_aggregate = [&](const SelectItem& item) {
+        AggregateSpec spec{item.function, item.column.empty() ? -1 : resolve(item.column)};
+        for (size_t i = 0; i < aggregates.size(); ++i) {
+            if (aggregates[i].function == spec.function && aggregates[i].column == spec.column) {
+                return static_cast<int>(group_by.size() + i);
             }
-            cout << endl;
         }
-        return true;
-    } else {
-        table_name = after_from.substr(0, pos_where);
-        trim(table_name);
-        where_clause = after_from.substr(pos_where + 5);
-        trim(where_clause);
-
-        // Remove trailing semicolon if any
-        if (!where_clause.empty() && where_clause.back() == ';') {
-            where_clause.pop_back();
+        if (spec.column >= 0) used[spec.column] = true;
+        aggregates.push_back(spec);
+        return static_cast<int>(group_by.size() + aggregates.size() - 1);
+    };
+
+    vector<int> indexes;
+    for (const auto& item : statement.items) {
+        if (item.aggregate) {
+            indexes.push_back(add_aggregate(item));
+            continue;
         }
-
-        // Only support WHERE record_id = <id>
-        string prefix = "record_id =";
-        if (where_clause.find(prefix) != 0) {
-            cout << "[ERROR] SELECT only supports WHERE record_id = <id> for now." << endl;
+        auto position = find(group_by.begin(), group_by.end(), resolve(item.column));
+        if (position == group_by.end()) {
+            cout << "[ERROR] Column '" << item.column << "' must appear in GROUP BY or be used in an aggregate."
+                 << endl;
             return false;
         }
+        indexes.push_back(static_cast<int>(position - group_by.begin()));
+    }
+    for (const auto& item : statement.having_aggregates) add_aggregate(item);
+    if (source.where) source.where->mark_columns(used);
+
+    // Small tables are aggregated on one thread, as plan_scan scans them.
+    size_t threads = table_manager.scan_threads(source.left);
+    if (source.join) threads = max(threads, table_manager.scan_threads(source.right));
+    unique_ptr<Operator> plan = make_unique<HashAggregate>(plan_source(source, used), move(group_by),
+                                                           move(aggregates), threads);
+    unique_ptr<Expr> having;
+    if (statement.having) {
+        // HAVING names columns and aggregates as written; the output names
+        // them after the schema's columns.
+        TableSchema grouped{schema.table_name, -1, plan->output_columns()};
+        unique_ptr<Expr> renamed = statement.having->rename([&](const string& name) {
+            for (const auto& item : statement.having_aggregates) {
+                if (item.name() == name && !item.column.empty()) {
+                    return aggregate_name(item.function, schema.columns[resolve(item.column)].name);
+                }
+            }
+            int index = source.find_column(name);
+            return index < 0 ? name : schema.columns[index].name;
+        });
+        vector<const Expr*> pending{renamed.get()};
+        while (!pending.empty()) {
+            const Expr* expr = pending.back();
+            pending.pop_back();
+            if (expr->left) pending.push_back(expr->left.get());
+            if (expr->right) pending.push_back(expr->right.get());
+            if (expr->kind == Expr::Kind::AND || expr->kind == Expr::Kind::OR) continue;
+            if (grouped.column_index(expr->column) < 0) {
+                cout << "[ERROR] Column '" << expr->column << "' must appear in GROUP BY or be used in an aggregate."
+                     << endl;
+                return false;
+            }
+        }
+        having = renamed->bind(grouped, parameters);
+        plan = make_unique<Filter>(move(plan), having.get());
+    }
+    plan = make_unique<Projection>(move(plan), move(indexes));
 
-        string id_str = where_clause.substr(prefix.size());
-        trim(id_str);
+    table_manager.print(*plan);
+    return true;
+}
 
-        int record_id = stoi(id_str);
+bool QueryParser::execute_vacuum(const VacuumStatement& statement) {
+    vector<string> tables;
+    if (statement.table.empty()) {
+        tables = catalog_manager.list_tables();
+    } else {
+        tables.push_back(get_table(statement.table).table_name);
+    }
 
-        Record rec = table_manager.select(table_name, record_id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> record = split(rec_str, '|');
-        if (record.empty()) {
-            cout << "[INFO] No record found with ID " << record_id << endl;
-            return true;
-        }
+    for (const auto& table : tables) {
+        VacuumStats stats = table_manager.vacuum(table);
+        cout << "[INFO] Vacuumed '" << table << "': " << stats.versions_removed << " dead versions removed, "
+             << stats.pages << " pages, " << stats.compacted << " compacted, " << stats.released << " released, "
+             << stats.bytes_reclaimed << " bytes reclaimed." << endl;
+    }
+    return true;
+}
 
-        auto schema = catalog_manager.get_schema(table_name);
-        // Print header
-        for (const auto& col : schema.columns) {
-            cout << col << "\t";
-        }
-        cout << endl;
+bool QueryParser::execute_prepare(const PrepareStatement& statement) {
+    shared_ptr<const Statement> body = statement_cache.get(statement.body);
+    if (body->type == StatementType::PREPARE || body->type == StatementType::EXECUTE ||
+        body->type == StatementType::DEALLOCATE) {
+        cout << "[ERROR] Cannot prepare a PREPARE, EXECUTE or DEALLOCATE statement." << endl;
+        return false;
+    }
+    prepared_statements[statement.name] = body;
+    cout << "[INFO] Statement '" << statement.name << "' prepared with " << body->parameter_count << " parameter(s)." << endl;
+    return true;
+}
 
-        // Print record
-        for (const auto& val : record) {
-            cout << val << "\t";
-        }
-        cout << endl;
+bool QueryParser::execute_execute(const ExecuteStatement& statement) {
+    auto it = prepared_statements.find(statement.name);
+    if (it == prepared_statements.end()) {
+        cout << "[ERROR] Prepared statement '" << statement.name << "' does not exist." << endl;
+        return false;
+    }
+    shared_ptr<const Statement> body = it->second; // survives a DEALLOCATE while running
+    if (static_cast<int>(statement.arguments.size()) != body->parameter_count) {
+        cout << "[ERROR] Statement '" << statement.name << "' takes " << body->parameter_count
+             << " parameter(s) but " << statement.arguments.size() << " were given." << endl;
+        return false;
+    }
+    return execute(*body, statement.arguments);
+}
 
-        return true;
+bool QueryParser::execute_deallocate(const DeallocateStatement& statement) {
+    if (prepared_statements.erase(statement.name) == 0) {
+        cout << "[ERROR] Prepared statement '" << statement.name << "' does not exist." << endl;
+        return false;
     }
+    cout << "[INFO] Statement '" << statement.name << "' deallocated." << endl;
+    return true;
 }
 
 
@@ -479,7 +612,9 @@ void QueryParser::run_interactive() {
     std::cout << "Enter SQL queries (type 'exit' to quit):\n";
     while (true) {
         std::cout << "SQL> ";
-        std::getline(std::cin, query);
+        if (!std::getline(std::cin, query)) {
+            break;
+        }
 
         if (query == "exit" || query == "quit") {
             std::cout << "Exiting interactive mode.\n";
@@ -490,34 +625,9 @@ void QueryParser::run_interactive() {
         }
 
         bool success = this->execute_query(query);
+        Logger::instance().flush();
         if (!success) {
             std::cout << "[ERROR] Failed to execute query.\n";
         }
     }
-}
-
-bool QueryParser::parse_print_table(const std::string& query) {
-    std::string q = query;
-    std::transform(q.begin(), q.end(), q.begin(), ::tolower);
-    
-    // Extract table name
-    size_t pos = q.find("select * from ");
-    if (pos == std::string::npos) return false;
-    
-    std::string tableName = query.substr(pos + 13); // "print table" is 11 chars
-    trim(tableName);
-    
-    // Remove trailing semicolon
-    if (!tableName.empty() && tableName.back() == ';') {
-        tableName.pop_back();
-    }
-    trim(tableName);
-    
-    if (tableName.empty()) {
-        std::cout << "[ERROR] Missing table name" << std::endl;
-        return false;
-    }
-    
-    table_manager.printTable(tableName);
-    return true;
 }
\ No newline at end of file
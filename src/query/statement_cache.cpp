@@ -0,0 +1,32 @@
+#include "../../include/query/statement_cache.h"
+#include "../../include/logger.h"
+#include "../../include/query/parser.h"
+
+using namespace std;
+
+StatementCache::StatementCache(size_t max_entries) : capacity(max_entries) {}
+
+shared_ptr<const Statement> StatementCache::get(const string& sql) {
+    auto it = lookup.find(sql);
+    if (it != lookup.end()) {
+        hits++;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    misses++;
+    shared_ptr<const Statement> statement = Parser(sql).parse_statement();
+    // EXECUTE text differs with every argument list and is cheap to parse;
+    // caching it would only push useful entries out.
+    if (statement->type == StatementType::EXECUTE) return statement;
+
+    entries.emplace_front(sql, statement);
+    lookup[sql] = entries.begin();
+    if (entries.size() > capacity) {
+        lookup.erase(entries.back().first);
+        entries.pop_back();
+    }
+    LOG_DEBUG(QUERY, "Parsed new statement (" << entries.size() << " cached, "
+                                               << hits << " hits, " << misses << " misses)");
+    return statement;
+}
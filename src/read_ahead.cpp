@@ -0,0 +1,91 @@
+#include "../include/read_ahead.h"
+#include "../include/logger.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+ReadAhead::ReadAhead(DiskManager& dm, int threads) : disk(dm), stopping(false), reads(0), used(0) {
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&ReadAhead::worker_loop, this);
+    }
+    LOG_DEBUG(BUFFER_POOL, "Read-ahead started with " << threads << " I/O threads.");
+}
+
+ReadAhead::~ReadAhead() {
+    {
+        lock_guard<mutex> lock(latch);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& worker : workers) worker.join();
+    LOG_DEBUG(BUFFER_POOL, "Read-ahead stopped. reads=" << reads << ", used=" << used);
+}
+
+void ReadAhead::worker_loop() {
+    unique_lock<mutex> lock(latch);
+    while (true) {
+        work_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+
+        int page_id = queue.front();
+        queue.pop_front();
+        Request* request = requests.at(page_id).get();
+        request->started = true;
+
+        // The buffer is only touched by this thread until `done` is set.
+        lock.unlock();
+        bool ok = disk.pread_page(page_id, request->data.data());
+        lock.lock();
+
+        request->ok = ok;
+        request->done = true;
+        reads++;
+        read_done.notify_all();
+    }
+}
+
+void ReadAhead::request(int page_id) {
+    {
+        lock_guard<mutex> lock(latch);
+        if (requests.count(page_id)) return;
+
+        if (requests.size() >= READ_AHEAD_MAX_PAGES) {
+            auto stale = requests.begin();
+            while (stale != requests.end() && !stale->second->done) ++stale;
+            if (stale == requests.end()) return;
+            requests.erase(stale);
+        }
+
+        auto request = make_unique<Request>();
+        request->data.resize(PAGE_SIZE);
+        requests.emplace(page_id, move(request));
+        queue.push_back(page_id);
+    }
+    work_ready.notify_one();
+}
+
+bool ReadAhead::take(int page_id, char* data) {
+    unique_lock<mutex> lock(latch);
+    auto it = requests.find(page_id);
+    if (it == requests.end()) return false;
+
+    Request* request = it->second.get();
+    if (!request->started) {
+        // Reading it here is as fast as waiting for a worker.
+        queue.erase(find(queue.begin(), queue.end(), page_id));
+        requests.erase(it);
+        return false;
+    }
+    read_done.wait(lock, [request] { return request->done; });
+
+    bool ok = request->ok;
+    if (ok) {
+        memcpy(data, request->data.data(), PAGE_SIZE);
+        used++;
+    } else {
+        LOG_WARN(BUFFER_POOL, "Read-ahead of page " << page_id << " failed; reading it again.");
+    }
+    requests.erase(page_id);
+    return ok;
+}
@@ -1,146 +1,121 @@
 #include "../include/record_iterator.h"
-#include <iostream>
+#include "../include/logger.h"
+#include <algorithm>
 
 using namespace std;
 
-#define DEBUG_PREFIX "[DEBUG][RECORD_ITERATOR] "
-#define COLOR_RED    "\033[31m"
-#define COLOR_GREEN  "\033[32m"
-#define COLOR_RESET  "\033[0m"
 
-// Remove 'valid' member and all logic related to it
-
-RecordIterator::RecordIterator(DiskManager& disk_manager) 
-    : disk(disk_manager), current_page_id(0), current_slot_id(0) {
-    try {
-        page = disk.read_page(current_page_id);
-        cout << COLOR_GREEN << DEBUG_PREFIX << "Initialized at page " << current_page_id << "." << COLOR_RESET << endl;
+RecordIterator::RecordIterator(RecordManager& rm, int segment_id, const Snapshot* snapshot)
+    : buffer_pool(rm.get_buffer_pool()), pages(rm.get_segment_pages(segment_id)),
+      page_index(0), prefetch_index(1), current_page_id(-1), current_slot_id(0), snapshot(snapshot) {
+    if (load_page(0)) {
+        LOG_TRACE(RECORD, "Initialized at page " << current_page_id << " of segment " << segment_id << " (" << pages.size() << " pages).");
         load_next_valid_record();
-    } catch (...) {
-        cout << COLOR_RED << DEBUG_PREFIX << "No pages available at initialization." << COLOR_RESET << endl;
-        current_page_id = -1; // No valid page => end iterator
+    } else {
+        LOG_TRACE(RECORD, "Segment " << segment_id << " has no pages.");
     }
 }
 
-void RecordIterator::load_next_valid_record() {
-    while (current_page_id >= 0) {
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-        uint16_t slot_count = header_ptr[0];
-
-        cout << COLOR_GREEN << DEBUG_PREFIX << "Scanning page " << current_page_id << " with " << slot_count << " slots." << COLOR_RESET << endl;
-
-        // Scan slots in current page
-        while (current_slot_id < slot_count) {
-            uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
-            uint16_t offset = slot_entry[0];
-            uint16_t size = slot_entry[1];
+// Pins the index-th page of the segment in place of the current page.
+// Returns false (and ends the iteration) past the segment's last page.
+bool RecordIterator::load_page(size_t index) {
+    page.release();
+    if (index >= pages.size()) {
+        current_page_id = -1; // mark iteration end
+        return false;
+    }
+    page_index = index;
+    size_t ahead = min(pages.size(), index + 1 + READ_AHEAD_PAGES);
+    for (prefetch_index = max(prefetch_index, index + 1); prefetch_index < ahead; ++prefetch_index) {
+        buffer_pool.prefetch(pages[prefetch_index]);
+    }
+    page = PageGuard(buffer_pool, pages[index], LatchMode::NONE);
+    current_page_id = pages[index];
+    current_slot_id = 0;
+    return true;
+}
 
-            cout << COLOR_GREEN << DEBUG_PREFIX << "Checking slot " << current_slot_id << ": offset=" << offset << ", size=" << size << "." << COLOR_RESET << endl;
+// Whether the slot under the cursor holds a record to return. The caller
+// holds the page latch.
+bool RecordIterator::yields(const char* data, uint16_t slot_count) const {
+    if (current_slot_id >= slot_count) return false;
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&data[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
+    if (slot_entry[0] == INVALID_SLOT || slot_entry[1] == 0) return false;
+    return !snapshot || (slot_entry[1] >= VERSION_HEADER_SIZE && snapshot->sees(data + slot_entry[0]));
+}
 
-            if (offset != INVALID_SLOT && size > 0) {
-                // Found valid record to yield next
-                cout << COLOR_GREEN << DEBUG_PREFIX << "Found valid record at page " << current_page_id << ", slot " << current_slot_id << "." << COLOR_RESET << endl;
-                return;
+void RecordIterator::load_next_valid_record() {
+    while (current_page_id >= 0) {
+        {
+            shared_lock<shared_mutex> latch(page.latch());
+            const char* data = page.data();
+            uint16_t slot_count = reinterpret_cast<const uint16_t*>(data)[0];
+
+            LOG_TRACE(RECORD, "Scanning page " << current_page_id << " with " << slot_count << " slots.");
+
+            // Scan slots in current page
+            while (current_slot_id < slot_count) {
+                if (yields(data, slot_count)) {
+                    // Found valid record to yield next
+                    LOG_TRACE(RECORD, "Found valid record at page " << current_page_id << ", slot " << current_slot_id << ".");
+                    return;
+                }
+                current_slot_id++;
             }
-            current_slot_id++;
         }
 
         // No valid slot found in current page, advance to next page
-        cout << COLOR_RED << DEBUG_PREFIX << "No valid record found in page " << current_page_id << ". Moving to next page." << COLOR_RESET << endl;
-        try {
-            current_page_id++;
-            page = disk.read_page(current_page_id);
-            current_slot_id = 0;
-        } catch (...) {
-            cout << COLOR_RED << DEBUG_PREFIX << "No more pages available after page " << current_page_id - 1 << "." << COLOR_RESET << endl;
-            current_page_id = -1; // mark iteration end
+        LOG_TRACE(RECORD, "No valid record found in page " << current_page_id << ". Moving to next page.");
+        if (!load_page(page_index + 1)) {
+            LOG_TRACE(RECORD, "No more pages available.");
             return;
         }
     }
 }
 
 bool RecordIterator::has_next() const {
-    cout << COLOR_GREEN << DEBUG_PREFIX << "has_next called. current_page_id=" << current_page_id << "." << COLOR_RESET << endl;
     return current_page_id >= 0;
 }
 
 Record RecordIterator::next() {
-    if (!has_next()) {
-        cout << COLOR_RED << DEBUG_PREFIX << "No more records available. Returning empty record." << COLOR_RESET << endl;
-        return Record(vector<char>()); // Return empty record
-    }
-
-    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-    uint16_t slot_count = header_ptr[0];
-
-    if (current_slot_id >= slot_count) {
-        cout << COLOR_RED << DEBUG_PREFIX << "No more records in the current page. Returning empty record." << COLOR_RESET << endl;
-        return Record(vector<char>());
-    }
-
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
-    uint16_t offset = slot_entry[0];
-    uint16_t size = slot_entry[1];
-
-    if (offset == INVALID_SLOT || size == 0) {
-        cout << COLOR_RED << DEBUG_PREFIX << "Invalid record at current slot. Returning empty record." << COLOR_RESET << endl;
-        return Record(vector<char>());
-    }
-
-    vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
-    Record record(record_data);
-
-    cout << COLOR_GREEN << DEBUG_PREFIX << "Returning record from page " << current_page_id << ", slot " << current_slot_id << "." << COLOR_RESET << endl;
-
-    current_slot_id++;
-    load_next_valid_record();
-
+    auto [record, page_id, slot_id] = next_with_location();
     return record;
 }
 
+// The cursor rests on a slot that was live when it got there, so the
+// record is copied out and the cursor advanced to the next live slot. If
+// the slot was emptied (or reused by a version the snapshot does not see)
+// since, the cursor moves on first.
 std::tuple<Record, int, int> RecordIterator::next_with_location() {
-    while (true) {
-        if (!has_next()) {
-            cout << COLOR_RED << DEBUG_PREFIX << "No more records available. Returning empty tuple." << COLOR_RESET << endl;
-            return {Record(vector<char>()), -1, -1};
-        }
-
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-        uint16_t slot_count = header_ptr[0];
-
-        if (current_slot_id >= slot_count) {
-            // No more slots on current page; try to load next page
-            try {
-                current_page_id++;
-                page = disk.read_page(current_page_id);
-                current_slot_id = 0;
-            } catch (...) {
-                cout << COLOR_RED << DEBUG_PREFIX << "No more pages available after page " << current_page_id - 1 << "." << COLOR_RESET << endl;
-                current_page_id = -1;
-                continue;  // loop again and will return empty tuple on next iteration
+    vector<char> record_data;
+    while (has_next()) {
+        {
+            shared_lock<shared_mutex> latch(page.latch());
+            const char* data = page.data();
+            uint16_t slot_count = reinterpret_cast<const uint16_t*>(data)[0];
+            if (yields(data, slot_count)) {
+                const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&data[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
+                size_t skip = snapshot ? VERSION_HEADER_SIZE : 0;
+                record_data.assign(data + slot_entry[0] + skip, data + slot_entry[0] + slot_entry[1]);
+                break;
             }
-            continue;
         }
+        load_next_valid_record();
+    }
+    if (!has_next()) {
+        LOG_TRACE(RECORD, "No more records available. Returning empty tuple.");
+        return {Record(vector<char>()), -1, -1};
+    }
 
-        uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
-        uint16_t offset = slot_entry[0];
-        uint16_t size = slot_entry[1];
-
-        int slot_id = current_slot_id;
-        int page_id = current_page_id;
-        current_slot_id++;
+    int page_id = current_page_id;
+    int slot_id = current_slot_id;
+    RecordID rid(page_id, slot_id);
+    Record rec(record_data, rid);
 
-        if (offset == INVALID_SLOT || size == 0) {
-            cout << COLOR_RED << DEBUG_PREFIX << "Invalid record at page " << page_id << ", slot " << slot_id << ". Skipping." << COLOR_RESET << endl;
-            continue; // skip invalid slot
-        }
+    LOG_TRACE(RECORD, "Returning record from page " << page_id << ", slot " << slot_id << ".");
 
-        vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
-        RecordID rid(page_id, slot_id);
-        Record rec(record_data, rid);
-
-        cout << COLOR_GREEN << DEBUG_PREFIX << "Returning record from page " << page_id << ", slot " << slot_id << "." << COLOR_RESET << endl;
+    current_slot_id++;
+    load_next_valid_record();
 
-        return {rec, page_id, slot_id};
-    }
+    return {rec, page_id, slot_id};
 }
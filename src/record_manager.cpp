@@ -1,190 +1,435 @@
 #include "../include/record_manager.h"
-#include <iostream>
+#include "../include/logger.h"
 #include <iomanip> // for std::hex and std::setw
 #include "../include/record_id.h"
+#include <algorithm>
+#include <tuple>
 
-#define RM_DEBUG_PREFIX "[DEBUG][RECORD_MANAGER] "
+RecordManager::RecordManager(BufferPoolManager& bpm)
+    : buffer_pool(bpm), free_space_map(bpm), transactions(bpm), next_page_id(0) {
+    LOG_DEBUG(RECORD, "RecordManager initialized.");
+}
+
+const int VACUUM_COMMIT_PAGES = 64; // VACUUM commits after this many changed pages
 
-RecordManager::RecordManager(DiskManager& dm) : disk(dm), next_page_id(0) {
-    std::cout << RM_DEBUG_PREFIX << "RecordManager initialized." << std::endl;
+int RecordManager::page_free_space(const char* page) {
+    const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page);
+    uint16_t slot_count = header_ptr[0];
+    int used = HEADER_SIZE + slot_count * SLOT_SIZE;
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+        if (slot_entry[0] != INVALID_SLOT) used += slot_entry[1];
+    }
+    return used < PAGE_SIZE ? PAGE_SIZE - used : 0;
 }
 
-int RecordManager::find_free_page() {
-    int page_id = 0;
-    std::cout << RM_DEBUG_PREFIX << "Searching for free page starting at page_id = 0" << std::endl;
-    while (true) {
-        std::vector<char> page;
-        bool page_exists = true;
-
-        try {
-            page = disk.read_page(page_id);
-            std::cout << RM_DEBUG_PREFIX << "Read page " << page_id << std::endl;
-        } catch (...) {
-            std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " does not exist yet. Allocating new page." << std::endl;
-            page_id = disk.allocate_page();
-            page = vector<char>(PAGE_SIZE, 0);
-            page_exists = false;
-        }
+int RecordManager::contiguous_free_space(const char* page) {
+    const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page);
+    uint16_t slot_count = header_ptr[0];
+    uint16_t free_offset = header_ptr[1];
+    int available = free_offset - (HEADER_SIZE + slot_count * SLOT_SIZE);
+    return available > 0 ? available : 0;
+}
 
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-        uint16_t slot_count = header_ptr[0];
-        uint16_t free_offset = header_ptr[1];
-
-        if (!page_exists) {
-            std::cout << RM_DEBUG_PREFIX << "Initializing header for new page " << page_id << std::endl;
-            slot_count = 0;
-            free_offset = PAGE_SIZE;
-            header_ptr[0] = slot_count;
-            header_ptr[1] = free_offset;
-            bool success = disk.write_page(page_id, page);
-            if (!success) {
-                std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << std::endl;
-                throw std::runtime_error("Failed to write page");
-            }
-            return page_id;
+uint16_t RecordManager::find_free_slot(const char* page) {
+    uint16_t slot_count = reinterpret_cast<const uint16_t*>(page)[0];
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+        if (slot_entry[0] == INVALID_SLOT) return slot_id;
+    }
+    return slot_count;
+}
+
+void RecordManager::init_heap_page(char* page) {
+    memset(page, 0, PAGE_SIZE);
+    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+    header_ptr[0] = 0;          // slot_count
+    header_ptr[1] = PAGE_SIZE;  // free_offset
+}
+
+// Stores `data` at the end of the free area and points `slot_id` at it,
+// which is either a dead slot or the next one past the slot array.
+void RecordManager::insert_into_page(char* page, uint16_t slot_id, const char* data, uint16_t size) {
+    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+    uint16_t free_offset = header_ptr[1] - size;
+    memcpy(&page[free_offset], data, size);
+
+    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+    slot_entry[0] = free_offset;
+    slot_entry[1] = size;
+    if (slot_id >= header_ptr[0]) header_ptr[0] = slot_id + 1;
+    header_ptr[1] = free_offset;
+}
+
+void RecordManager::compact_page(char* page, bool trim_slots) {
+    char copy[PAGE_SIZE];
+    memcpy(copy, page, PAGE_SIZE);
+
+    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+    uint16_t slot_count = header_ptr[0];
+    uint16_t free_offset = PAGE_SIZE;
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+        if (slot_entry[0] == INVALID_SLOT) continue;
+        free_offset -= slot_entry[1];
+        memcpy(&page[free_offset], &copy[slot_entry[0]], slot_entry[1]);
+        slot_entry[0] = free_offset;
+    }
+
+    if (trim_slots) {
+        while (slot_count > 0) {
+            const uint16_t* last = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + (slot_count - 1) * SLOT_SIZE]);
+            if (last[0] != INVALID_SLOT) break;
+            slot_count--;
         }
+        header_ptr[0] = slot_count;
+    }
+    header_ptr[1] = free_offset;
+}
 
-        int available = free_offset - (HEADER_SIZE + slot_count * SLOT_SIZE);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " available space for record + slot: " << available << std::endl;
+void RecordManager::delete_from_page(char* page, uint16_t slot_id) {
+    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+    slot_entry[0] = INVALID_SLOT;
+    slot_entry[1] = 0;
+}
+
+void RecordManager::update_in_page(char* page, uint16_t slot_id, const char* data, uint16_t size) {
+    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+    memcpy(&page[slot_entry[0]], data, size);
+    slot_entry[1] = size;
+}
+
+void RecordManager::stamp_in_page(char* page, uint16_t slot_id, TxnId xmax) {
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+    memcpy(&page[slot_entry[0] + VERSION_XMAX_OFFSET], &xmax, sizeof(xmax));
+}
+
+uint64_t RecordManager::get_page_lsn(const char* page) {
+    uint64_t lsn;
+    memcpy(&lsn, page + PAGE_LSN_OFFSET, sizeof(lsn));
+    return lsn;
+}
 
-        if (available >= 4 + SLOT_SIZE) { // minimum record size + slot size
-            std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " has enough space. Using this page." << std::endl;
-            return page_id;
+void RecordManager::set_page_lsn(char* page, uint64_t lsn) {
+    memcpy(page + PAGE_LSN_OFFSET, &lsn, sizeof(lsn));
+}
+
+// Appends the log record for a change already applied to the page and
+// stamps the page with its LSN.
+void RecordManager::log_heap_change(PageGuard& guard, LogRecordType type, uint16_t slot_id, const char* data, size_t size) {
+    LogRecord record;
+    record.type = type;
+    record.page_id = guard.page_id();
+    record.slot_id = slot_id;
+    if (size > 0) record.data.assign(data, data + size);
+    uint64_t lsn = buffer_pool.get_log_manager().append(record);
+    set_page_lsn(guard.data(), lsn);
+    guard.set_lsn(lsn);
+}
+
+void RecordManager::compact(PageGuard& guard, bool trim_slots) {
+    compact_page(guard.data(), trim_slots);
+    char flag = trim_slots ? 1 : 0;
+    log_heap_change(guard, LogRecordType::HEAP_COMPACT, 0, &flag, 1);
+    LOG_TRACE(RECORD, "Compacted page " << guard.page_id());
+}
+
+void RecordManager::commit() {
+    LogManager& log = buffer_pool.get_log_manager();
+    log.commit();
+    transactions.commit();
+    if (log.needs_checkpoint()) {
+        LOG_DEBUG(RECORD, "Log is large, checkpointing.");
+        buffer_pool.checkpoint();
+    }
+}
+
+int RecordManager::create_segment() {
+    return free_space_map.allocate_segment();
+}
+
+// ---------- Overflow values ----------
+
+// The chain is written front to back; each page is logged as a raw write.
+OverflowPointer RecordManager::store_overflow(int segment_id, const string& value) {
+    size_t page_count = max<size_t>(1, (value.size() + OVERFLOW_DATA_SIZE - 1) / OVERFLOW_DATA_SIZE);
+    vector<int> page_ids;
+    for (size_t i = 0; i < page_count; ++i) {
+        int page_id = free_space_map.take_free_page();
+        if (page_id == INVALID_PAGE_ID) {
+            buffer_pool.new_page(page_id);
+            buffer_pool.unpin_page(page_id, true);
         }
+        free_space_map.set_segment(page_id, overflow_segment(segment_id));
+        page_ids.push_back(page_id);
+    }
 
-        page_id++;
-        std::cout << RM_DEBUG_PREFIX << "Moving to next page: " << page_id << std::endl;
+    for (size_t i = 0; i < page_count; ++i) {
+        PageGuard guard(buffer_pool, page_ids[i]);
+        char* page = guard.data();
+        size_t start = i * OVERFLOW_DATA_SIZE;
+        uint16_t used = static_cast<uint16_t>(min<size_t>(OVERFLOW_DATA_SIZE, value.size() - start));
+        int32_t next = i + 1 < page_count ? page_ids[i + 1] : INVALID_PAGE_ID;
+        memcpy(page, &next, sizeof(next));
+        memcpy(page + 4, &used, sizeof(used));
+        memcpy(page + OVERFLOW_HEADER_SIZE, value.data() + start, used);
+        guard.log_write(0, OVERFLOW_HEADER_SIZE + used);
     }
+    LOG_TRACE(RECORD, "Stored " << value.size() << " bytes in " << page_count << " overflow pages from page " << page_ids[0]);
+    return {page_ids[0], static_cast<uint32_t>(value.size())};
 }
 
-int RecordManager::insert_record(const Record& record) {
-    std::cout << RM_DEBUG_PREFIX << "Inserting record: " << record.to_string() << std::endl;
-    int page_id = find_free_page();
-    std::vector<char> page;
+string RecordManager::read_overflow(const OverflowPointer& pointer) {
+    string value;
+    value.reserve(pointer.length);
+    int page_id = pointer.first_page;
+    while (page_id != INVALID_PAGE_ID && value.size() < pointer.length) {
+        PageGuard guard(buffer_pool, page_id, LatchMode::SHARED);
+        const char* page = guard.data();
+        uint16_t used;
+        memcpy(&page_id, page, sizeof(page_id));
+        memcpy(&used, page + 4, sizeof(used));
+        value.append(page + OVERFLOW_HEADER_SIZE, used);
+    }
+    if (value.size() != pointer.length) {
+        LOG_ERROR(RECORD, "Overflow chain at page " << pointer.first_page << " is " << value.size() << " bytes, expected " << pointer.length);
+        throw std::runtime_error("Corrupt overflow chain");
+    }
+    return value;
+}
 
-    try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read successfully." << std::endl;
-    } catch (...) {
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " does not exist. Initializing new." << std::endl;
-        page = std::vector<char>(PAGE_SIZE, 0);
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-        header_ptr[0] = 0;          // slot_count
-        header_ptr[1] = PAGE_SIZE;  // free_offset
+vector<char> RecordManager::encode_row(int segment_id, const RowLayout& layout, const vector<Value>& values) {
+    vector<char> row = layout.encode(values);
+    if (row.size() <= ROW_INLINE_LIMIT) return row;
+
+    vector<OverflowPointer> external(layout.column_count());
+    while (row.size() > ROW_INLINE_LIMIT) {
+        size_t longest = layout.column_count();
+        for (size_t i = 0; i < layout.column_count(); ++i) {
+            const Value& value = values[i];
+            if (value.is_null || value.type != TypeId::VARCHAR || external[i].first_page >= 0) continue;
+            if (value.string_value.size() <= OVERFLOW_MIN_VALUE) continue;
+            if (longest == layout.column_count() || value.string_value.size() > values[longest].string_value.size()) longest = i;
+        }
+        if (longest == layout.column_count()) break;
+        external[longest] = store_overflow(segment_id, values[longest].string_value);
+        row = layout.encode(values, &external);
     }
+    return row;
+}
 
-    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-    uint16_t slot_count = header_ptr[0];
-    uint16_t free_offset = header_ptr[1];
+vector<Value> RecordManager::decode_row(const RowLayout& layout, const char* row, const vector<bool>* columns) {
+    vector<Value> values;
+    values.reserve(layout.column_count());
+    for (size_t i = 0; i < layout.column_count(); ++i) {
+        if (columns && !(*columns)[i]) {
+            values.push_back(Value::make_null(layout.column(i).type));
+        } else if (layout.is_external(row, i)) {
+            values.push_back(Value::make_string(read_overflow(layout.overflow_pointer(row, i))));
+        } else {
+            values.push_back(layout.get(row, i));
+        }
+    }
+    return values;
+}
 
-    std::cout << RM_DEBUG_PREFIX << "Current slot_count: " << slot_count << ", free_offset: " << free_offset << std::endl;
+void RecordManager::free_overflow(const RowLayout& layout, const char* row) {
+    for (size_t i = 0; i < layout.column_count(); ++i) {
+        if (!layout.is_external(row, i)) continue;
+        int page_id = layout.overflow_pointer(row, i).first_page;
+        while (page_id != INVALID_PAGE_ID) {
+            int next;
+            {
+                PageGuard guard(buffer_pool, page_id);
+                memcpy(&next, guard.data(), sizeof(next));
+            }
+            free_space_map.release_page(page_id);
+            page_id = next;
+        }
+    }
+}
 
-    uint16_t rec_size = static_cast<uint16_t>(record.data.size());
-    std::cout << RM_DEBUG_PREFIX << "Record size: " << rec_size << std::endl;
+// Hands the segment's pages back for reuse. Their contents are left as is;
+// a page is re-initialized when another segment picks it up.
+void RecordManager::drop_segment(int segment_id) {
+    LOG_DEBUG(RECORD, "Dropping segment " << segment_id);
+    free_space_map.release_segment(segment_id);
+    free_space_map.release_segment(overflow_segment(segment_id));
+}
 
-    int available = free_offset - (HEADER_SIZE + slot_count * SLOT_SIZE);
-    if (available < rec_size + SLOT_SIZE) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Not enough space in page " << page_id << " for record size " << rec_size << std::endl;
-        throw std::runtime_error("Page does not have enough space");
+vector<int> RecordManager::get_segment_pages(int segment_id) const {
+    return free_space_map.get_segment_pages(segment_id);
+}
+
+int RecordManager::find_free_page(int segment_id, int required_bytes) {
+    int page_id = free_space_map.find_page(segment_id, required_bytes);
+    if (page_id != INVALID_PAGE_ID) {
+        LOG_TRACE(RECORD, "Free-space map suggests page " << page_id << " for " << required_bytes << " bytes.");
+        return page_id;
     }
 
-    free_offset -= rec_size;
-    std::cout << RM_DEBUG_PREFIX << "Updated free_offset after inserting record data: " << free_offset << std::endl;
+    PageGuard guard;
+    page_id = free_space_map.take_free_page();
+    if (page_id != INVALID_PAGE_ID) {
+        LOG_DEBUG(RECORD, "No page with free space. Reusing released page " << page_id << ".");
+        guard = PageGuard(buffer_pool, page_id);
+    } else {
+        LOG_DEBUG(RECORD, "No page with free space. Allocating new page.");
+        guard = PageGuard(buffer_pool, buffer_pool.new_page(page_id));
+    }
+    init_heap_page(guard.data());
+    log_heap_change(guard, LogRecordType::HEAP_INIT, 0, nullptr, 0);
+    free_space_map.set_segment(page_id, segment_id);
+    free_space_map.update(page_id, page_free_space(guard.data()));
+    LOG_TRACE(RECORD, "Initialized header for new page " << page_id);
+    return page_id;
+}
 
-    // Copy record data
-    memcpy(&page[free_offset], record.data.data(), rec_size);
-    std::cout << RM_DEBUG_PREFIX << "Record data copied to page at offset " << free_offset << std::endl;
+int64_t RecordManager::insert_record(int segment_id, const Record& record) {
+    LOG_TRACE(RECORD, "Inserting record into segment " << segment_id);
+    uint16_t rec_size = static_cast<uint16_t>(record.data.size());
+    LOG_TRACE(RECORD, "Record size: " << rec_size);
 
-    // Write slot entry
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_count * SLOT_SIZE]);
-    slot_entry[0] = free_offset;
-    slot_entry[1] = rec_size;
-    std::cout << RM_DEBUG_PREFIX << "Slot entry written at index " << slot_count << ": offset=" << free_offset << ", size=" << rec_size << std::endl;
+    if (record.data.size() + SLOT_SIZE > static_cast<size_t>(PAGE_SIZE - HEADER_SIZE)) {
+        LOG_ERROR(RECORD, "Record of size " << record.data.size() << " cannot fit in a page");
+        throw std::runtime_error("Record too large for a page");
+    }
 
-    // Update header
-    slot_count++;
-    header_ptr[0] = slot_count;
-    header_ptr[1] = free_offset;
-    std::cout << RM_DEBUG_PREFIX << "Header updated: slot_count=" << slot_count << ", free_offset=" << free_offset << std::endl;
+    // The map may be stale after an unclean shutdown; if the suggested page
+    // turns out to be too full, correct its entry and ask again.
+    PageGuard guard;
+    int page_id;
+    uint16_t slot_id;
+    int required;
+    while (true) {
+        guard.release();
+        page_id = find_free_page(segment_id, rec_size + SLOT_SIZE);
+        guard = PageGuard(buffer_pool, page_id);
+        // A dead slot is reused before the slot array grows.
+        slot_id = find_free_slot(guard.data());
+        required = rec_size + (slot_id == reinterpret_cast<uint16_t*>(guard.data())[0] ? SLOT_SIZE : 0);
+        int available = page_free_space(guard.data());
+        if (available >= required) break;
+
+        LOG_DEBUG(RECORD, "Page " << page_id << " only has " << available << " bytes. Correcting free-space map.");
+        free_space_map.update(page_id, available);
+    }
+    char* page = guard.data();
 
-    bool success = disk.write_page(page_id, page);
-    if (!success) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << " to disk." << std::endl;
-        throw std::runtime_error("Failed to write page");
+    if (contiguous_free_space(page) < required) {
+        // Trimming can only drop the dead slot found above together with
+        // the slot entries after it, which pays for a new slot.
+        compact(guard, true);
+        slot_id = find_free_slot(page);
     }
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " written to disk." << std::endl;
+    LOG_TRACE(RECORD, "Using slot " << slot_id << ", free_offset: " << reinterpret_cast<uint16_t*>(page)[1]);
+
+    insert_into_page(page, slot_id, record.data.data(), rec_size);
+    log_heap_change(guard, LogRecordType::HEAP_INSERT, slot_id, record.data.data(), rec_size);
+    free_space_map.update(page_id, page_free_space(page));
 
-    std::cout << RM_DEBUG_PREFIX << "Record inserted at page " << page_id << " slot " << (slot_count - 1) << std::endl;
+    LOG_TRACE(RECORD, "Record inserted at page " << page_id << " slot " << slot_id);
 
-    RecordID rid(page_id, slot_count - 1);
-    int record_id = rid.encode();
+    RecordID rid(page_id, slot_id);
+    int64_t record_id = rid.encode();
     return record_id;
 }
 
-Record RecordManager::get_record(int record_id) {
-    RecordID decoded = RecordID::decode(record_id);
-    auto page_id = decoded.page_id;
-    auto slot_id = decoded.slot_id;
-    std::cout << RM_DEBUG_PREFIX << "Getting record at page " << page_id << ", slot " << slot_id << std::endl;
-
-    std::vector<char> page;
-    try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk." << std::endl;
-    } catch (...) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << std::endl;
-        throw std::runtime_error("Page read error");
+vector<int64_t> RecordManager::bulk_insert(int segment_id, const vector<Record>& records) {
+    LOG_DEBUG(RECORD, "Bulk inserting " << records.size() << " records into segment " << segment_id);
+    for (const Record& record : records) {
+        if (record.data.size() + SLOT_SIZE > static_cast<size_t>(PAGE_SIZE - HEADER_SIZE)) {
+            LOG_ERROR(RECORD, "Record of size " << record.data.size() << " cannot fit in a page");
+            throw std::runtime_error("Record too large for a page");
+        }
     }
 
-    if (page.size() < HEADER_SIZE + (slot_id + 1) * SLOT_SIZE) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Slot ID " << slot_id << " out of bounds in page " << page_id << std::endl;
-        throw std::runtime_error("Invalid slot ID");
+    vector<int64_t> record_ids(records.size());
+    vector<pair<int, int>> new_pages; // (page id, free bytes)
+    vector<char> batch(static_cast<size_t>(BULK_WRITE_PAGES) * PAGE_SIZE);
+    // (index into records, batch page, slot) of every row in the current batch
+    vector<tuple<size_t, int, uint16_t>> placed;
+    int batch_pages = 0;
+
+    auto write_batch = [&]() {
+        if (batch_pages == 0) return;
+        int first_page_id = buffer_pool.append_pages(batch.data(), batch_pages);
+        for (const auto& [index, batch_page, slot_id] : placed) {
+            record_ids[index] = RecordID(first_page_id + batch_page, slot_id).encode();
+        }
+        for (int i = 0; i < batch_pages; ++i) {
+            new_pages.push_back({first_page_id + i, contiguous_free_space(batch.data() + static_cast<size_t>(i) * PAGE_SIZE)});
+        }
+        placed.clear();
+        batch_pages = 0;
+    };
+
+    char* page = nullptr;
+    for (size_t i = 0; i < records.size(); ++i) {
+        uint16_t rec_size = static_cast<uint16_t>(records[i].data.size());
+        if (!page || contiguous_free_space(page) < rec_size + SLOT_SIZE) {
+            if (batch_pages == BULK_WRITE_PAGES) write_batch();
+            page = batch.data() + static_cast<size_t>(batch_pages) * PAGE_SIZE;
+            memset(page, 0, PAGE_SIZE);
+            init_heap_page(page);
+            batch_pages++;
+        }
+        uint16_t slot_id = reinterpret_cast<uint16_t*>(page)[0];
+        insert_into_page(page, slot_id, records[i].data.data(), rec_size);
+        placed.emplace_back(i, batch_pages - 1, slot_id);
     }
+    write_batch();
+    buffer_pool.sync_pages();
 
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
-    uint16_t offset = slot_entry[0];
-    uint16_t size = slot_entry[1];
-
-    std::cout << RM_DEBUG_PREFIX << "Slot entry: offset=" << offset << ", size=" << size << std::endl;
-
-    if (offset == INVALID_SLOT || size == 0 || offset + size > PAGE_SIZE) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Record not found or invalid range at page " << page_id << ", slot " << slot_id << std::endl;
-        throw std::runtime_error("Record not found or invalid range");
+    for (const auto& [page_id, free_bytes] : new_pages) {
+        free_space_map.set_segment(page_id, segment_id);
+        free_space_map.update(page_id, free_bytes);
     }
+    LOG_DEBUG(RECORD, "Bulk insert wrote " << new_pages.size() << " pages");
+    return record_ids;
+}
 
-    std::vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
-    std::cout << RM_DEBUG_PREFIX << "Record data retrieved successfully." << std::endl;
-    return Record(record_data);
+bool RecordManager::has_record(int segment_id, int64_t record_id) {
+    RecordID decoded = RecordID::decode(record_id);
+    if (!RecordID::in_range(record_id) || free_space_map.get_segment(decoded.page_id) != segment_id) return false;
+
+    PageGuard guard(buffer_pool, decoded.page_id, LatchMode::SHARED);
+    const char* page = guard.data();
+    uint16_t slot_count = reinterpret_cast<const uint16_t*>(page)[0];
+    if (decoded.slot_id >= slot_count) return false;
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + decoded.slot_id * SLOT_SIZE]);
+    return slot_entry[0] != INVALID_SLOT && slot_entry[1] != 0;
 }
 
-void RecordManager::delete_record(int record_id) {
+void RecordManager::delete_record(int64_t record_id) {
     RecordID decoded = RecordID::decode(record_id);
     auto page_id = decoded.page_id;
     auto slot_id = decoded.slot_id;
 
     // Add validation for page_id and slot_id
-    if (decoded.page_id == static_cast<uint16_t>(-1) || decoded.page_id >= disk.get_num_pages()) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Invalid page id " << decoded.page_id << " in delete_record." << std::endl;
+    if (decoded.page_id < 0 || decoded.page_id >= buffer_pool.get_num_pages()) {
+        LOG_ERROR(RECORD, "Invalid page id " << decoded.page_id << " in delete_record.");
         throw std::runtime_error("Invalid page id for deletion");
     }
     if (slot_id == UINT16_MAX || slot_id < 0) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Invalid slot_id " << slot_id << " in delete_record. Aborting deletion." << std::endl;
+        LOG_ERROR(RECORD, "Invalid slot_id " << slot_id << " in delete_record. Aborting deletion.");
         throw std::invalid_argument("Invalid slot_id in delete_record");
     }
 
-    std::cout << RM_DEBUG_PREFIX << "Deleting record at page " << page_id << ", slot " << slot_id << std::endl;
+    LOG_TRACE(RECORD, "Deleting record at page " << page_id << ", slot " << slot_id);
 
-    std::vector<char> page;
+    PageGuard guard;
     try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk for deletion." << std::endl;
+        guard = PageGuard(buffer_pool, page_id);
     } catch (...) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << " for deletion." << std::endl;
+        LOG_ERROR(RECORD, "Failed to read page " << page_id << " for deletion.");
         throw std::runtime_error("Page read error during deletion");
     }
+    char* page = guard.data();
 
-    if (page.size() < HEADER_SIZE + (slot_id + 1) * SLOT_SIZE) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Slot ID " << slot_id << " out of bounds in page " << page_id << std::endl;
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    if (slot_id >= slot_count) {
+        LOG_ERROR(RECORD, "Slot ID " << slot_id << " out of bounds in page " << page_id);
         throw std::runtime_error("Invalid slot ID for deletion");
     }
 
@@ -193,64 +438,135 @@ void RecordManager::delete_record(int record_id) {
     uint16_t size = slot_entry[1];
 
     if (offset == INVALID_SLOT || size == 0) {
-        std::cerr << "[WARNING][RECORD_MANAGER] Record at page " << page_id << ", slot " << slot_id << " is already deleted or invalid." << std::endl;
+        LOG_WARN(RECORD, "Record at page " << page_id << ", slot " << slot_id << " is already deleted or invalid.");
         // Optional: You could throw here or just log and return
         return; // Early return to avoid rewriting
     }
 
-    slot_entry[0] = INVALID_SLOT;
-    slot_entry[1] = 0;
-
-    std::cout << RM_DEBUG_PREFIX << "Slot entry marked as invalid." << std::endl;
+    delete_from_page(page, slot_id);
+    log_heap_change(guard, LogRecordType::HEAP_DELETE, slot_id, nullptr, 0);
+    free_space_map.update(page_id, page_free_space(page));
 
-    bool success = disk.write_page(page_id, page);
-    if (!success) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << " after deletion." << std::endl;
-        throw std::runtime_error("Failed to write page after deletion");
-    }
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " written after deletion." << std::endl;
+    LOG_TRACE(RECORD, "Slot entry marked as invalid.");
 }
 
 
-int RecordManager::update_record(int record_id, const Record& new_record) {
-    RecordID decoded = RecordID::decode(record_id);
-    auto page_id = decoded.page_id;
-    auto slot_id = decoded.slot_id;
-    std::cout << RM_DEBUG_PREFIX << "Updating record at page " << page_id << ", slot " << slot_id << std::endl;
+// ---------- Row versions ----------
 
-    std::vector<char> page = disk.read_page(page_id);
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk for update." << std::endl;
+Record RecordManager::new_version(const vector<char>& row) {
+    TxnId header[2] = {transactions.write_transaction(), 0};
+    vector<char> data(VERSION_HEADER_SIZE + row.size());
+    memcpy(data.data(), header, VERSION_HEADER_SIZE);
+    if (!row.empty()) memcpy(data.data() + VERSION_HEADER_SIZE, row.data(), row.size());
+    return Record(data);
+}
 
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
-    uint16_t offset = slot_entry[0];
-    uint16_t size = slot_entry[1];
+bool RecordManager::delete_version(int64_t record_id) {
+    RecordID decoded = RecordID::decode(record_id);
+    TxnId txn = transactions.write_transaction();
 
-    if (offset == INVALID_SLOT || size == 0) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Cannot update: Record not found or deleted." << std::endl;
+    PageGuard guard(buffer_pool, decoded.page_id);
+    char* page = guard.data();
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    if (decoded.slot_id >= slot_count) {
+        LOG_ERROR(RECORD, "Slot ID " << decoded.slot_id << " out of bounds in page " << decoded.page_id);
+        throw std::runtime_error("Invalid slot ID for deletion");
+    }
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + decoded.slot_id * SLOT_SIZE]);
+    if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) {
+        LOG_ERROR(RECORD, "No row version at page " << decoded.page_id << ", slot " << decoded.slot_id);
         throw std::runtime_error("Record not found or deleted");
     }
 
-    uint16_t new_size = static_cast<uint16_t>(new_record.data.size());
+    TxnId xmax;
+    memcpy(&xmax, page + slot_entry[0] + VERSION_XMAX_OFFSET, sizeof(xmax));
+    if (xmax != 0) {
+        LOG_TRACE(RECORD, "Version at page " << decoded.page_id << ", slot " << decoded.slot_id << " already deleted by " << xmax);
+        return false;
+    }
+    stamp_in_page(page, decoded.slot_id, txn);
+    log_heap_change(guard, LogRecordType::HEAP_STAMP, decoded.slot_id, reinterpret_cast<const char*>(&txn), sizeof(txn));
+    LOG_TRACE(RECORD, "Version at page " << decoded.page_id << ", slot " << decoded.slot_id << " deleted by " << txn);
+    return true;
+}
 
-    if (new_size <= size) {
-        // Overwrite in place
-        memcpy(&page[offset], new_record.data.data(), new_size);
-        slot_entry[1] = new_size;
+bool RecordManager::get_record(int segment_id, int64_t record_id, const Snapshot& snapshot, vector<char>& row) {
+    RecordID decoded = RecordID::decode(record_id);
+    if (!RecordID::in_range(record_id) || free_space_map.get_segment(decoded.page_id) != segment_id) return false;
+
+    PageGuard guard(buffer_pool, decoded.page_id, LatchMode::SHARED);
+    const char* page = guard.data();
+    uint16_t slot_count = reinterpret_cast<const uint16_t*>(page)[0];
+    if (decoded.slot_id >= slot_count) return false;
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + decoded.slot_id * SLOT_SIZE]);
+    if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) return false;
+
+    const char* version = page + slot_entry[0];
+    if (!snapshot.sees(version)) return false;
+    row.assign(version + VERSION_HEADER_SIZE, version + slot_entry[1]);
+    return true;
+}
 
-        std::cout << RM_DEBUG_PREFIX << "Record updated in place. New size: " << new_size << std::endl;
+vector<Record> RecordManager::expired_versions(int segment_id, int page_id, TxnId horizon, TxnId& pending) {
+    vector<Record> expired;
+    pending = 0;
+    if (free_space_map.get_segment(page_id) != segment_id) return expired;
+
+    PageGuard guard(buffer_pool, page_id, LatchMode::SHARED);
+    const char* page = guard.data();
+    uint16_t slot_count = reinterpret_cast<const uint16_t*>(page)[0];
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+        if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) continue;
+
+        const char* version = page + slot_entry[0];
+        TxnId xmax;
+        memcpy(&xmax, version + VERSION_XMAX_OFFSET, sizeof(xmax));
+        if (xmax == 0) continue;
+        if (xmax <= horizon) {
+            expired.emplace_back(vector<char>(version, version + slot_entry[1]), RecordID(page_id, slot_id));
+        } else if (pending == 0 || xmax < pending) {
+            pending = xmax;
+        }
+    }
+    return expired;
+}
 
-        bool success = disk.write_page(page_id, page);
-        if (!success) {
-            std::cerr << "[ERROR][RECORD_MANAGER] Failed to write updated page." << std::endl;
-            throw std::runtime_error("Failed to update record");
+VacuumStats RecordManager::vacuum_segment(int segment_id) {
+    VacuumStats stats;
+    size_t uncommitted = 0;
+    for (int page_id : free_space_map.get_segment_pages(segment_id)) {
+        stats.pages++;
+        PageGuard guard(buffer_pool, page_id);
+        char* page = guard.data();
+        uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+        int free_bytes = page_free_space(page);
+
+        if (free_bytes == PAGE_SIZE - HEADER_SIZE - slot_count * SLOT_SIZE) {
+            // No live record is left; the page goes back to the free pool
+            // and is re-initialized by whichever segment takes it next.
+            guard.release();
+            free_space_map.release_page(page_id);
+            stats.released++;
+            stats.bytes_reclaimed += PAGE_SIZE;
+        } else {
+            int garbage = free_bytes - contiguous_free_space(page);
+            if (garbage == 0) continue;
+            compact(guard, true);
+            free_space_map.update(page_id, page_free_space(page));
+            stats.compacted++;
+            stats.bytes_reclaimed += garbage;
         }
-        return record_id;
-    } else {
-        // Not enough space, delete old and insert new
-        std::cout << RM_DEBUG_PREFIX << "New record too large. Re-inserting in new page." << std::endl;
 
-        delete_record(record_id);
-        return insert_record(new_record);  // new record_id returned
+        if (++uncommitted == VACUUM_COMMIT_PAGES) {
+            guard.release();
+            commit();
+            uncommitted = 0;
+        }
     }
-}
+    if (uncommitted > 0) commit();
 
+    LOG_DEBUG(RECORD, "Vacuumed segment " << segment_id << ": " << stats.compacted << " pages compacted, "
+              << stats.released << " released, " << stats.bytes_reclaimed << " bytes reclaimed");
+    return stats;
+}
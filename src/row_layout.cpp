@@ -0,0 +1,148 @@
+#include "../include/row_layout.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+RowLayout::RowLayout(const vector<Column>& cols)
+    : columns(cols), offsets(cols.size()), null_bytes((cols.size() + 7) / 8), var_count(0) {
+    size_t pos = null_bytes;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].is_fixed_width()) {
+            offsets[i] = static_cast<uint16_t>(pos);
+            pos += columns[i].fixed_width();
+        } else {
+            offsets[i] = static_cast<uint16_t>(var_count++);
+        }
+    }
+    var_array_offset = pos;
+    var_data_offset = var_array_offset + var_count * sizeof(uint16_t);
+}
+
+vector<char> RowLayout::encode(const vector<Value>& values, const vector<OverflowPointer>* external) const {
+    if (values.size() != columns.size()) {
+        throw invalid_argument("Expected " + to_string(columns.size()) + " values, got " + to_string(values.size()));
+    }
+
+    vector<char> row(var_data_offset, 0);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const Column& col = columns[i];
+        const Value& value = values[i];
+        if (value.is_null) {
+            row[i / 8] |= static_cast<char>(1 << (i % 8));
+        } else if (value.type != col.type) {
+            throw invalid_argument("Value for column " + col.name + " is not of type " + col.type_name());
+        }
+
+        char* field = row.data() + offsets[i];
+        switch (col.type) {
+        case TypeId::INT: {
+            int32_t v = static_cast<int32_t>(value.int_value);
+            memcpy(field, &v, sizeof(v));
+            break;
+        }
+        case TypeId::BIGINT:
+            memcpy(field, &value.int_value, sizeof(int64_t));
+            break;
+        case TypeId::DOUBLE:
+            memcpy(field, &value.double_value, sizeof(double));
+            break;
+        case TypeId::BOOL:
+            *field = value.int_value ? 1 : 0;
+            break;
+        case TypeId::VARCHAR: {
+            uint16_t flag = 0;
+            if (!value.is_null) {
+                if (value.string_value.size() > col.length) {
+                    throw invalid_argument("Value for column " + col.name + " is longer than " + col.type_name());
+                }
+                if (external && (*external)[i].first_page >= 0) {
+                    const OverflowPointer& pointer = (*external)[i];
+                    size_t pos = row.size();
+                    row.resize(pos + OVERFLOW_POINTER_SIZE);
+                    memcpy(row.data() + pos, &pointer.first_page, sizeof(pointer.first_page));
+                    memcpy(row.data() + pos + 4, &pointer.length, sizeof(pointer.length));
+                    flag = VAR_EXTERNAL_FLAG;
+                } else {
+                    row.insert(row.end(), value.string_value.begin(), value.string_value.end());
+                }
+            }
+            if (row.size() >= VAR_EXTERNAL_FLAG) throw invalid_argument("Row too large");
+            uint16_t end = static_cast<uint16_t>(row.size()) | flag;
+            memcpy(row.data() + var_array_offset + offsets[i] * sizeof(uint16_t), &end, sizeof(end));
+            break;
+        }
+        }
+    }
+    return row;
+}
+
+bool RowLayout::is_null(const char* row, size_t i) const {
+    return (row[i / 8] >> (i % 8)) & 1;
+}
+
+uint16_t RowLayout::var_end(const char* row, size_t var_index) const {
+    uint16_t end;
+    memcpy(&end, row + var_array_offset + var_index * sizeof(uint16_t), sizeof(end));
+    return end;
+}
+
+// [start, end) of a VARCHAR column's data within the row.
+pair<uint16_t, uint16_t> RowLayout::var_range(const char* row, size_t i) const {
+    uint16_t start = offsets[i] > 0 ? var_end(row, offsets[i] - 1) & ~VAR_EXTERNAL_FLAG : static_cast<uint16_t>(var_data_offset);
+    uint16_t end = var_end(row, offsets[i]) & ~VAR_EXTERNAL_FLAG;
+    return {start, end};
+}
+
+bool RowLayout::is_external(const char* row, size_t i) const {
+    return !columns[i].is_fixed_width() && !is_null(row, i) && (var_end(row, offsets[i]) & VAR_EXTERNAL_FLAG);
+}
+
+OverflowPointer RowLayout::overflow_pointer(const char* row, size_t i) const {
+    OverflowPointer pointer;
+    const char* data = row + var_range(row, i).first;
+    memcpy(&pointer.first_page, data, sizeof(pointer.first_page));
+    memcpy(&pointer.length, data + 4, sizeof(pointer.length));
+    return pointer;
+}
+
+Value RowLayout::get(const char* row, size_t i) const {
+    const Column& col = columns[i];
+    if (is_null(row, i)) return Value::make_null(col.type);
+
+    const char* field = row + offsets[i];
+    switch (col.type) {
+    case TypeId::INT: {
+        int32_t v;
+        memcpy(&v, field, sizeof(v));
+        return Value::make_int(v, TypeId::INT);
+    }
+    case TypeId::BIGINT: {
+        int64_t v;
+        memcpy(&v, field, sizeof(v));
+        return Value::make_int(v, TypeId::BIGINT);
+    }
+    case TypeId::DOUBLE: {
+        double v;
+        memcpy(&v, field, sizeof(v));
+        return Value::make_double(v);
+    }
+    case TypeId::BOOL:
+        return Value::make_bool(*field != 0);
+    case TypeId::VARCHAR: {
+        if (is_external(row, i)) throw logic_error("Column " + col.name + " is stored out of line");
+        auto [start, end] = var_range(row, i);
+        return Value::make_string(string(row + start, end - start));
+    }
+    }
+    return Value::make_null(col.type);
+}
+
+vector<Value> RowLayout::decode(const char* row) const {
+    vector<Value> values;
+    values.reserve(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        values.push_back(get(row, i));
+    }
+    return values;
+}
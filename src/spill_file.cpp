@@ -0,0 +1,106 @@
+#include "../include/spill_file.h"
+#include "../include/logger.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+SpillFile::SpillFile(size_t run_count) : runs(run_count) {
+    char name[] = "limbodb_spill.XXXXXX";
+    fd = mkstemp(name);
+    if (fd < 0) {
+        LOG_ERROR(QUERY, "Cannot create a spill file: " << strerror(errno));
+        throw runtime_error("Cannot create a spill file");
+    }
+    unlink(name);
+    LOG_DEBUG(QUERY, "Spill file opened with " << run_count << " runs");
+}
+
+SpillFile::~SpillFile() {
+    close(fd);
+    LOG_DEBUG(QUERY, "Spill file of " << page_count << " pages closed");
+}
+
+void SpillFile::write_page(Run& run, const char* data) {
+    off_t offset = static_cast<off_t>(page_count) * PAGE_SIZE;
+    size_t done = 0;
+    while (done < static_cast<size_t>(PAGE_SIZE)) {
+        ssize_t written = pwrite(fd, data + done, PAGE_SIZE - done, offset + static_cast<off_t>(done));
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            LOG_ERROR(QUERY, "Write of spill page " << page_count << " failed: " << strerror(errno));
+            throw runtime_error("Cannot write to the spill file");
+        }
+        done += static_cast<size_t>(written);
+    }
+    run.pages.push_back(page_count++);
+}
+
+// Entries are stored as [uint32 length][bytes] and may span pages.
+void SpillFile::append(size_t run_index, const string& entry) {
+    Run& run = runs[run_index];
+    uint32_t length = static_cast<uint32_t>(entry.size());
+    run.tail.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    run.tail.append(entry);
+    run.bytes += sizeof(length) + entry.size();
+
+    size_t written = 0;
+    while (run.tail.size() - written >= static_cast<size_t>(PAGE_SIZE)) {
+        write_page(run, run.tail.data() + written);
+        written += PAGE_SIZE;
+    }
+    run.tail.erase(0, written);
+}
+
+void SpillFile::finish() {
+    for (Run& run : runs) {
+        if (run.tail.empty()) continue;
+        run.tail.resize(PAGE_SIZE, '\0');
+        write_page(run, run.tail.data());
+        string().swap(run.tail);
+    }
+}
+
+SpillFile::Reader::Reader(const SpillFile& spill, size_t run_index)
+    : file(spill), run(spill.runs[run_index]), remaining(run.bytes) {}
+
+// Makes `bytes` unreturned bytes available in `buffer`, reading pages as
+// needed; false if the run ends first.
+bool SpillFile::Reader::fill(size_t bytes) {
+    if (buffer.size() - offset >= bytes) return true;
+    buffer.erase(0, offset);
+    offset = 0;
+    char data[PAGE_SIZE];
+    while (buffer.size() < bytes && page < run.pages.size()) {
+        off_t position = static_cast<off_t>(run.pages[page++]) * PAGE_SIZE;
+        size_t done = 0;
+        while (done < static_cast<size_t>(PAGE_SIZE)) {
+            ssize_t count = pread(file.fd, data + done, PAGE_SIZE - done, position + static_cast<off_t>(done));
+            if (count <= 0) {
+                if (count < 0 && errno == EINTR) continue;
+                LOG_ERROR(QUERY, "Read of spill page " << run.pages[page - 1] << " failed: " << strerror(errno));
+                throw runtime_error("Cannot read the spill file");
+            }
+            done += static_cast<size_t>(count);
+        }
+        size_t used = min(remaining, static_cast<size_t>(PAGE_SIZE));
+        buffer.append(data, used);
+        remaining -= used;
+    }
+    return buffer.size() >= bytes;
+}
+
+bool SpillFile::Reader::next(string& entry) {
+    uint32_t length;
+    if (!fill(sizeof(length))) return false;
+    memcpy(&length, buffer.data() + offset, sizeof(length));
+    offset += sizeof(length);
+    if (!fill(length)) throw runtime_error("Spill run ends inside an entry");
+    entry.assign(buffer, offset, length);
+    offset += length;
+    return true;
+}
@@ -2,200 +2,642 @@
 #include "../include/catalog_manager.h"
 #include "../include/record_manager.h"
 #include "../include/record_iterator.h"
+#include "../include/query/planner.h"
+#include "../include/logger.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <unordered_set>
 #include "pretty.hpp"
 
 
-#define DEBUG_COLOR_RESET      "\033[0m"
-#define DEBUG_COLOR_YELLOW     "\033[33m"
-#define DEBUG_COLOR_CYAN       "\033[36m"
-#define DEBUG_DEBUG_LABEL      DEBUG_COLOR_YELLOW "[DEBUG]" DEBUG_COLOR_RESET
-#define DEBUG_TABLE_LABEL      DEBUG_COLOR_CYAN "[TABLE_MANAGER]" DEBUG_COLOR_RESET
-#define DEBUG_TABLE_MANAGER    std::cout << DEBUG_DEBUG_LABEL << DEBUG_TABLE_LABEL << " "
-
-TableManager::TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im)
-    : catalog(cat), record_mgr(rm), index_mgr(im) {
-    DEBUG_TABLE_MANAGER << "Initialized TableManager with IndexManager" << std::endl;
+#define DEBUG_TABLE_MANAGER(msg) LOG_DEBUG(TABLE, msg)
+#define TRACE_TABLE_MANAGER(msg) LOG_TRACE(TABLE, msg)
+
+const size_t PRINT_BLOCK_ROWS = 100;
+// Smaller batches are inserted row by row so they fill existing pages
+// instead of starting new ones.
+const size_t BULK_LOAD_MIN_PAGES = 4;
+// VACUUM collects dead versions and commits in batches of this many pages.
+const size_t VACUUM_GC_PAGES = 64;
+
+// Which pages hold versions deleted before the database was opened is not
+// recorded, so every heap page is queued for the first collection.
+TableManager::TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im, ColumnStore& cs)
+    : catalog(cat), record_mgr(rm), index_mgr(im), column_store(cs) {
+    for (const auto& table_name : catalog.list_tables()) {
+        TableSchema schema = catalog.get_schema(table_name);
+        if (schema.storage == TableStorage::COLUMN) continue;
+        for (int page_id : record_mgr.get_segment_pages(schema.segment_id)) {
+            garbage_pages[table_name][page_id] = 0;
+        }
+    }
+    DEBUG_TABLE_MANAGER("Initialized TableManager with IndexManager");
 }
 
-int TableManager::insert_into(const string& table_name, const vector<string>& values) {
-    DEBUG_TABLE_MANAGER << "insert_into called for table: " << table_name << std::endl;
+int64_t TableManager::insert_into(const string& table_name, const vector<Value>& values) {
+    TRACE_TABLE_MANAGER("insert_into called for table: " << table_name);
     TableSchema schema = catalog.get_schema(table_name);
-    if (values.size() != schema.columns.size()) {
-        DEBUG_TABLE_MANAGER << "Insert failed: value count does not match schema" << std::endl;
+    if (schema.table_name.empty() || values.size() != schema.columns.size()) {
+        DEBUG_TABLE_MANAGER("Insert failed: value count does not match schema");
         return -1;
     }
 
-    stringstream ss;
-    ss << table_name << "|";
-    for (size_t i = 0; i < values.size(); ++i) {
-        ss << values[i];
-        if (i < values.size() - 1) ss << "|";
+    if (schema.storage == TableStorage::COLUMN) {
+        int64_t row = static_cast<int64_t>(column_table(schema)->append({values}, record_mgr.get_transactions().write_transaction()));
+        record_mgr.commit();
+        return row;
     }
 
-    Record record(ss.str());
-    int record_id = record_mgr.insert_record(record);
-
-    for (size_t i = 0; i < schema.columns.size(); ++i) {
-        index_mgr.insert_entry(table_name, schema.columns[i], values[i], record_id);
-    }
+    check_unique(schema, {&values}, {});
+    Record record = record_mgr.new_version(record_mgr.encode_row(schema.segment_id, schema.layout(), values));
+    int64_t record_id = record_mgr.insert_record(schema.segment_id, record);
+    index_row(schema, indexed_columns(schema), values, record_id);
 
-    DEBUG_TABLE_MANAGER << "Inserted record_id: " << record_id << std::endl;
+    record_mgr.commit();
+    TRACE_TABLE_MANAGER("Inserted record_id: " << record_id);
     return record_id;
 }
 
-bool TableManager::delete_from(const std::string& table_name, int record_id) {
-    DEBUG_TABLE_MANAGER << "delete_from called for table: " << table_name 
-                         << ", record_id: " << record_id << std::endl;
+size_t TableManager::insert_rows(const string& table_name, const vector<vector<Value>>& rows) {
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) return 0;
 
-    if (record_id == -1) {
-        int deleted_count = 0;
-        std::vector<int> to_delete;
+    vector<const vector<Value>*> checked;
+    checked.reserve(rows.size());
+    for (const auto& values : rows) {
+        if (values.size() != schema.columns.size()) {
+            throw std::invalid_argument("Insert into table '" + table_name + "' has the wrong number of values");
+        }
+        checked.push_back(&values);
+    }
+    if (schema.storage == TableStorage::COLUMN) {
+        column_table(schema)->append(rows, record_mgr.get_transactions().write_transaction());
+        record_mgr.commit();
+        DEBUG_TABLE_MANAGER("Appended " << rows.size() << " rows to column table: " << table_name);
+        return rows.size();
+    }
+    check_unique(schema, checked, {});
 
-        RecordIterator iterator(record_mgr.get_disk());
-        const std::string table_prefix = table_name + "|";
-        const std::string schema_prefix = "SCHEMA|";
+    RowLayout layout = schema.layout();
+    vector<Record> records;
+    records.reserve(rows.size());
+    size_t total_bytes = 0;
+    for (const auto& values : rows) {
+        records.push_back(record_mgr.new_version(record_mgr.encode_row(schema.segment_id, layout, values)));
+        total_bytes += records.back().data.size() + SLOT_SIZE;
+    }
 
-        while (iterator.has_next()) {
-            auto [rec, page_id, slot_id] = iterator.next_with_location();
-            std::string rec_str = rec.to_string();
+    vector<int> indexed = indexed_columns(schema);
+    if (total_bytes < BULK_LOAD_MIN_PAGES * PAGE_SIZE) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            index_row(schema, indexed, rows[i], record_mgr.insert_record(schema.segment_id, records[i]));
+        }
+    } else {
+        vector<int64_t> record_ids = record_mgr.bulk_insert(schema.segment_id, records);
+        for (int c : indexed) {
+            vector<pair<string, int64_t>> entries;
+            entries.reserve(rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                if (rows[i][c].is_null) continue;
+                entries.push_back({rows[i][c].index_key(), record_ids[i]});
+            }
+            index_mgr.insert_entries(schema.table_name, schema.columns[c].name, entries);
+        }
+    }
+    record_mgr.commit();
 
-            if (rec_str.rfind(schema_prefix, 0) == 0) continue;
-            if (rec_str.rfind(table_prefix, 0) != 0) continue;
+    DEBUG_TABLE_MANAGER("Inserted " << rows.size() << " records into table: " << table_name);
+    return rows.size();
+}
 
-            RecordID rid(page_id, slot_id);
-            to_delete.push_back(rid.encode());
-        }
+vector<int> TableManager::indexed_columns(const TableSchema& schema) {
+    vector<int> columns;
+    for (const IndexInfo& index : catalog.get_indexes(schema.table_name)) {
+        int column = schema.column_index(index.column_name);
+        if (column >= 0) columns.push_back(column);
+    }
+    return columns;
+}
 
-        for (int rid_encoded : to_delete) {
-            delete_from(table_name, rid_encoded);
-            deleted_count++;
+// NULLs are not indexed; no predicate can match them.
+void TableManager::index_row(const TableSchema& schema, const vector<int>& indexed, const vector<Value>& values, int64_t record_id) {
+    for (int i : indexed) {
+        if (values[i].is_null) continue;
+        index_mgr.insert_entry(schema.table_name, schema.columns[i].name, values[i].index_key(), record_id);
+    }
+}
+
+void TableManager::unindex_row(const TableSchema& schema, const vector<int>& indexed, const vector<Value>& values, int64_t record_id) {
+    for (int i : indexed) {
+        if (values[i].is_null) continue;
+        index_mgr.delete_entry(schema.table_name, schema.columns[i].name, values[i].index_key(), record_id);
+    }
+}
+
+// Reads with the newest versions, so rows the running statement already
+// wrote or deleted count as such. Index keys may be truncated (see
+// INDEX_MAX_KEY_SIZE), hence the value is compared again.
+bool TableManager::key_in_use(const TableSchema& schema, int column, const string& key, const unordered_set<int64_t>& replaced) {
+    Snapshot latest = Snapshot::latest();
+    RowLayout layout = schema.layout();
+    vector<bool> mask(schema.columns.size(), false);
+    mask[column] = true;
+    vector<char> row;
+    for (int64_t record_id : index_mgr.search(schema.table_name, schema.columns[column].name, key)) {
+        if (replaced.count(record_id) || !record_mgr.get_record(schema.segment_id, record_id, latest, row)) continue;
+        if (record_mgr.decode_row(layout, row.data(), &mask)[column].index_key() == key) return true;
+    }
+    return false;
+}
+
+void TableManager::check_unique(const TableSchema& schema, const vector<const vector<Value>*>& rows,
+                                const unordered_set<int64_t>& replaced) {
+    for (const IndexInfo& index : catalog.get_indexes(schema.table_name)) {
+        if (!index.unique) continue;
+        int column = schema.column_index(index.column_name);
+        unordered_set<string> keys;
+        for (const vector<Value>* values : rows) {
+            const Value& value = (*values)[column];
+            if (value.is_null) continue;
+            string key = value.index_key();
+            if (!keys.insert(key).second || key_in_use(schema, column, key, replaced)) {
+                throw std::invalid_argument("Duplicate value " + value.to_string() + " in column '" + index.column_name +
+                                            "' violates unique index '" + index.index_name + "'");
+            }
         }
+    }
+}
+
+bool TableManager::delete_from(const std::string& table_name, int64_t record_id) {
+    TRACE_TABLE_MANAGER("delete_from called for table: " << table_name << ", record_id: " << record_id);
 
-        DEBUG_TABLE_MANAGER << "Deleted " << deleted_count 
-                            << " records from table: " << table_name << std::endl;
+    if (record_id == -1) {
+        TableSchema schema = catalog.get_schema(table_name);
+        if (schema.table_name.empty()) return false;
+
+        std::vector<int64_t> to_delete;
+        if (schema.storage == TableStorage::COLUMN) {
+            unique_ptr<Operator> plan = scan(table_name, nullptr, vector<bool>(schema.columns.size(), false));
+            Tuple tuple;
+            plan->open();
+            while (plan->next(tuple)) to_delete.push_back(tuple.record_id);
+            plan->close();
+        } else {
+            shared_ptr<const Snapshot> snapshot = record_mgr.get_transactions().open_snapshot();
+            RecordIterator iterator(record_mgr, schema.segment_id, snapshot.get());
+            while (iterator.has_next()) {
+                auto [rec, page_id, slot_id] = iterator.next_with_location();
+                to_delete.push_back(RecordID(page_id, slot_id).encode());
+            }
+        }
+        delete_rows(table_name, to_delete);
         return true;
     }
 
-    record_mgr.delete_record(record_id);
+    TableSchema schema = catalog.get_schema(table_name);
+    remove_row(schema, record_id);
+    record_mgr.commit();
     return true;
 }
 
-bool TableManager::update(const string& table_name, int record_id, const vector<string>& new_values) {
-    DEBUG_TABLE_MANAGER << "update called for table: " << table_name << std::endl;
+size_t TableManager::delete_rows(const string& table_name, const vector<int64_t>& record_ids) {
     TableSchema schema = catalog.get_schema(table_name);
-    if (new_values.size() != schema.columns.size()) {
-        DEBUG_TABLE_MANAGER << "Update failed: value count mismatch" << std::endl;
+    if (schema.table_name.empty()) return 0;
+
+    for (int64_t record_id : record_ids) {
+        remove_row(schema, record_id);
+    }
+    record_mgr.commit();
+
+    DEBUG_TABLE_MANAGER("Deleted " << record_ids.size() << " records from table: " << table_name);
+    return record_ids.size();
+}
+
+// Only marks the version deleted: snapshots taken earlier still read it
+// (and its overflow values) until collect_garbage removes it.
+bool TableManager::remove_row(const TableSchema& schema, int64_t record_id) {
+    if (schema.storage == TableStorage::COLUMN) {
+        TxnId txn = record_mgr.get_transactions().write_transaction();
+        return record_id >= 0 && column_table(schema)->remove(static_cast<uint64_t>(record_id), txn);
+    }
+    if (!record_mgr.delete_version(record_id)) return false;
+    TxnId txn = record_mgr.get_transactions().write_transaction();
+    auto [entry, added] = garbage_pages[schema.table_name].emplace(RecordID::decode(record_id).page_id, txn);
+    if (!added) entry->second = min(entry->second, txn);
+    return true;
+}
+
+bool TableManager::update(const string& table_name, int64_t record_id, const vector<Value>& new_values) {
+    TRACE_TABLE_MANAGER("update called for table: " << table_name);
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty() || new_values.size() != schema.columns.size()) {
+        DEBUG_TABLE_MANAGER("Update failed: value count mismatch");
         return false;
     }
 
-    Record old_record = record_mgr.get_record(record_id);
-    stringstream ss_old(old_record.to_string());
-    vector<string> old_tokens;
-    string token;
-    
-    // Extract table name and values
-    std::getline(ss_old, token, '|'); // Skip table name
-    while (std::getline(ss_old, token, '|')) {
-        old_tokens.push_back(token);
+    check_unique(schema, {&new_values}, {record_id});
+    replace_row(schema, indexed_columns(schema), record_id, new_values);
+    record_mgr.commit();
+    return true;
+}
+
+size_t TableManager::update_rows(const string& table_name, const vector<Tuple>& rows) {
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) return 0;
+
+    vector<const vector<Value>*> checked;
+    unordered_set<int64_t> replaced;
+    for (const auto& row : rows) {
+        if (row.values.size() != schema.columns.size()) {
+            throw std::invalid_argument("Update of table '" + table_name + "' has the wrong number of values");
+        }
+        checked.push_back(&row.values);
+        replaced.insert(row.record_id);
+    }
+    check_unique(schema, checked, replaced);
+
+    if (schema.storage == TableStorage::COLUMN) {
+        // The new versions are appended together, one pass per column.
+        vector<vector<Value>> changed;
+        for (const auto& row : rows) {
+            if (remove_row(schema, row.record_id)) changed.push_back(row.values);
+        }
+        column_table(schema)->append(changed, record_mgr.get_transactions().write_transaction());
+    } else {
+        vector<int> indexed = indexed_columns(schema);
+        for (const auto& row : rows) {
+            replace_row(schema, indexed, row.record_id, row.values);
+        }
     }
+    record_mgr.commit();
 
-    for (size_t i = 0; i < old_tokens.size(); ++i) {
-        index_mgr.delete_entry(table_name, schema.columns[i], old_tokens[i], record_id);
+    DEBUG_TABLE_MANAGER("Updated " << rows.size() << " records in table: " << table_name);
+    return rows.size();
+}
+
+// The new values become a new version with a record id of its own; the old
+// version keeps its index entries until it is collected.
+void TableManager::replace_row(const TableSchema& schema, const vector<int>& indexed, int64_t record_id,
+                               const vector<Value>& new_values) {
+    if (!remove_row(schema, record_id)) return;
+    if (schema.storage == TableStorage::COLUMN) {
+        column_table(schema)->append({new_values}, record_mgr.get_transactions().write_transaction());
+        return;
     }
+    Record new_record = record_mgr.new_version(record_mgr.encode_row(schema.segment_id, schema.layout(), new_values));
+    index_row(schema, indexed, new_values, record_mgr.insert_record(schema.segment_id, new_record));
+}
 
-    stringstream ss;
-    ss << table_name << "|";
-    for (size_t i = 0; i < new_values.size(); ++i) {
-        ss << new_values[i];
-        if (i < new_values.size() - 1) ss << "|";
+VacuumStats TableManager::vacuum(const string& table_name) {
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) {
+        throw std::runtime_error("Table '" + table_name + "' does not exist");
+    }
+    if (schema.storage == TableStorage::COLUMN) return VacuumStats{};
+
+    // Look at every page, not only the ones known to hold deleted versions.
+    map<int, TxnId>& pages = garbage_pages[table_name];
+    for (int page_id : record_mgr.get_segment_pages(schema.segment_id)) pages[page_id] = 0;
+    TxnId horizon = record_mgr.get_transactions().gc_horizon();
+    size_t removed = 0;
+    while (true) {
+        size_t budget = VACUUM_GC_PAGES;
+        removed += collect_table(schema, pages, horizon, budget);
+        record_mgr.commit();
+        if (budget > 0) break;
     }
+    if (pages.empty()) garbage_pages.erase(table_name);
 
-    Record new_record(ss.str());
-    record_mgr.update_record(record_id, new_record);
+    VacuumStats stats = record_mgr.vacuum_segment(schema.segment_id);
+    stats.versions_removed = removed;
+    return stats;
+}
 
-    for (size_t i = 0; i < new_values.size(); ++i) {
-        index_mgr.insert_entry(table_name, schema.columns[i], new_values[i], record_id);
+// Works through the queued pages in page order, skipping those whose
+// versions some snapshot may still read; `max_pages` is decremented for
+// every page looked at.
+size_t TableManager::collect_table(const TableSchema& schema, map<int, TxnId>& pages, TxnId horizon, size_t& max_pages) {
+    RowLayout layout = schema.layout();
+    vector<int> indexed = indexed_columns(schema);
+    vector<bool> mask(schema.columns.size(), false);
+    for (int column : indexed) mask[column] = true;
+    size_t removed = 0;
+    for (auto it = pages.begin(); it != pages.end() && max_pages > 0;) {
+        if (it->second > horizon) {
+            ++it;
+            continue;
+        }
+        max_pages--;
+        TxnId pending;
+        for (const Record& version : record_mgr.expired_versions(schema.segment_id, it->first, horizon, pending)) {
+            const char* row = version.data.data() + VERSION_HEADER_SIZE;
+            int64_t record_id = version.rid.encode();
+            unindex_row(schema, indexed, record_mgr.decode_row(layout, row, &mask), record_id);
+            record_mgr.free_overflow(layout, row);
+            record_mgr.delete_record(record_id);
+            removed++;
+        }
+        if (pending == 0) {
+            it = pages.erase(it);
+        } else {
+            it->second = pending;
+            ++it;
+        }
     }
+    return removed;
+}
 
-    return true;
+bool TableManager::collect_garbage(size_t max_pages) {
+    TxnId horizon = record_mgr.get_transactions().gc_horizon();
+    size_t removed = 0;
+    for (auto it = garbage_pages.begin(); it != garbage_pages.end() && max_pages > 0;) {
+        TableSchema schema = catalog.get_schema(it->first);
+        if (!schema.table_name.empty()) removed += collect_table(schema, it->second, horizon, max_pages);
+        if (schema.table_name.empty() || it->second.empty()) {
+            it = garbage_pages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (removed > 0) {
+        record_mgr.commit();
+        DEBUG_TABLE_MANAGER("Collected " << removed << " dead versions up to transaction " << horizon);
+    }
+    return max_pages == 0;
 }
 
-Record TableManager::select(const string& table_name, int record_id) {
-    DEBUG_TABLE_MANAGER << "select called for table: " << table_name 
-                         << ", record_id: " << record_id << std::endl;
-    return record_mgr.get_record(record_id);
+shared_ptr<ColumnTable> TableManager::column_table(const TableSchema& schema) {
+    return column_store.open_table(schema.segment_id, schema.column_meta_page);
 }
 
-vector<Record> TableManager::scan(const string& table_name) {
-    DEBUG_TABLE_MANAGER << "scan called for table: " << table_name << std::endl;
-    vector<Record> records;
-    RecordIterator it(record_mgr.get_disk());
-    const std::string schema_prefix = "SCHEMA|";
-    const std::string table_prefix = table_name + "|";
-    
-    while (it.has_next()) {
-        Record rec = it.next();
-        std::string rec_str(rec.data.begin(), rec.data.end());
-        
-        if (rec_str.rfind(schema_prefix, 0) == 0) continue;
-        if (rec_str.rfind(table_prefix, 0) != 0) continue;
-        
-        rec_str = rec_str.substr(table_prefix.size());
-        rec.data = std::vector<char>(rec_str.begin(), rec_str.end());
-        records.push_back(rec);
-    }
-    
-    DEBUG_TABLE_MANAGER << "Scanned " << records.size() 
-                        << " records from table: " << table_name << std::endl;
-    return records;
-}
-
-void TableManager::printTable(const std::string& tableName) {
-    TableSchema schema = catalog.get_schema(tableName);
+vector<char> TableManager::read_row(const TableSchema& schema, int64_t record_id) {
+    if (schema.storage == TableStorage::COLUMN) {
+        throw std::runtime_error("Table '" + schema.table_name + "' is stored by column and has no row records");
+    }
+    shared_ptr<const Snapshot> snapshot = record_mgr.get_transactions().open_snapshot();
+    vector<char> row;
+    if (!record_mgr.get_record(schema.segment_id, record_id, *snapshot, row)) {
+        throw std::runtime_error("Record not found or deleted");
+    }
+    return row;
+}
+
+Record TableManager::select(const string& table_name, int64_t record_id) {
+    TRACE_TABLE_MANAGER("select called for table: " << table_name << ", record_id: " << record_id);
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) {
+        throw std::runtime_error("Table '" + table_name + "' does not exist");
+    }
+    return Record(read_row(schema, record_id), RecordID::decode(record_id));
+}
+
+vector<Value> TableManager::select_values(const string& table_name, int64_t record_id) {
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) {
+        throw std::runtime_error("Table '" + table_name + "' does not exist");
+    }
+    if (schema.storage == TableStorage::COLUMN) {
+        shared_ptr<const Snapshot> snapshot = record_mgr.get_transactions().open_snapshot();
+        vector<Value> values;
+        if (record_id < 0 || !column_table(schema)->read_row(static_cast<uint64_t>(record_id), *snapshot, values)) {
+            throw std::runtime_error("Record not found or deleted");
+        }
+        return values;
+    }
+    return record_mgr.decode_row(schema.layout(), read_row(schema, record_id).data());
+}
+
+unique_ptr<Operator> TableManager::scan(const string& table_name, const Expr* where, const vector<bool>& columns) {
+    TRACE_TABLE_MANAGER("scan called for table: " << table_name);
+    TableSchema schema = catalog.get_schema(table_name);
+    if (schema.table_name.empty()) return nullptr;
+    return plan_scan(record_mgr, index_mgr, column_store, schema, record_mgr.get_transactions().open_snapshot(), where, columns);
+}
+
+unique_ptr<Operator> TableManager::join(const TableSchema& left, const TableSchema& right, int left_key, int right_key,
+                                        const Expr* left_where, const Expr* right_where,
+                                        const vector<bool>& left_columns, const vector<bool>& right_columns) {
+    TRACE_TABLE_MANAGER("join called for tables: " << left.table_name << ", " << right.table_name);
+    return plan_join(record_mgr, index_mgr, column_store, left, right, left_key, right_key,
+                     record_mgr.get_transactions().open_snapshot(), left_where, right_where, left_columns,
+                     right_columns);
+}
+
+size_t TableManager::scan_threads(const TableSchema& schema) {
+    return ::scan_threads(record_mgr, schema);
+}
+
+// The table's pages are split into contiguous ranges, one per
+// parallel_scan_threads() worker.
+vector<vector<pair<string, int64_t>>> TableManager::read_index_keys(const TableSchema& schema, const vector<int>& columns) {
+    vector<bool> mask(schema.columns.size(), false);
+    for (int column : columns) mask[column] = true;
+
+    RowLayout layout = schema.layout();
+    BufferPoolManager& buffer_pool = record_mgr.get_buffer_pool();
+    vector<int> pages = record_mgr.get_segment_pages(schema.segment_id);
+    size_t thread_count = max<size_t>(1, min(parallel_scan_threads(), pages.size()));
+    // found[worker][k] holds the keys of columns[k] the worker read.
+    vector<vector<vector<pair<string, int64_t>>>> found(thread_count, vector<vector<pair<string, int64_t>>>(columns.size()));
+    vector<exception_ptr> failures(thread_count);
+    vector<thread> workers;
+    for (size_t t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&, t] {
+            try {
+                size_t first = pages.size() * t / thread_count;
+                size_t last = pages.size() * (t + 1) / thread_count;
+                for (size_t i = first; i < last; ++i) {
+                    PageGuard page(buffer_pool, pages[i], LatchMode::SHARED);
+                    const char* data = page.data();
+                    uint16_t slot_count = reinterpret_cast<const uint16_t*>(data)[0];
+                    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+                        const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(data + HEADER_SIZE + slot_id * SLOT_SIZE);
+                        if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) continue;
+                        vector<Value> values = record_mgr.decode_row(layout, data + slot_entry[0] + VERSION_HEADER_SIZE, &mask);
+                        int64_t record_id = RecordID(pages[i], slot_id).encode();
+                        for (size_t k = 0; k < columns.size(); ++k) {
+                            const Value& value = values[columns[k]];
+                            if (!value.is_null) found[t][k].push_back({value.index_key(), record_id});
+                        }
+                    }
+                }
+            } catch (...) {
+                failures[t] = current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (const auto& failure : failures) {
+        if (failure) rethrow_exception(failure);
+    }
+
+    vector<vector<pair<string, int64_t>>> entries = std::move(found[0]);
+    for (size_t t = 1; t < thread_count; ++t) {
+        for (size_t k = 0; k < columns.size(); ++k) {
+            entries[k].insert(entries[k].end(), make_move_iterator(found[t][k].begin()), make_move_iterator(found[t][k].end()));
+        }
+    }
+    DEBUG_TABLE_MANAGER("Read index keys of " << columns.size() << " columns of table " << schema.table_name << " from "
+                                              << pages.size() << " pages on " << thread_count << " threads");
+    return entries;
+}
+
+size_t TableManager::create_index(const string& index_name, const string& table_name, const string& column_name, bool unique,
+                                  IndexType type) {
+    TableSchema schema = catalog.get_schema(table_name);
     if (schema.table_name.empty()) {
+        throw std::invalid_argument("Table '" + table_name + "' does not exist");
+    }
+    int column = schema.column_index(column_name);
+    if (column < 0) {
+        throw std::invalid_argument("Column '" + column_name + "' not found in table '" + table_name + "'");
+    }
+    if (schema.storage == TableStorage::COLUMN) {
+        throw std::invalid_argument("Table '" + table_name + "' is stored by column and cannot be indexed");
+    }
+    if (catalog.has_index(index_name)) {
+        throw std::invalid_argument("Index '" + index_name + "' already exists");
+    }
+    if (index_mgr.has_index(table_name, column_name)) {
+        throw std::invalid_argument("Column '" + column_name + "' of table '" + table_name + "' already has an index");
+    }
+
+    // Every version gets an entry, deleted ones included, until the garbage
+    // collector removes it.
+    vector<pair<string, int64_t>> entries = std::move(read_index_keys(schema, {column})[0]);
+    if (unique) {
+        // Old versions of a row repeat its key, so only live versions count.
+        vector<pair<string, int64_t>> sorted = entries;
+        sort(sorted.begin(), sorted.end());
+        Snapshot latest = Snapshot::latest();
+        vector<char> row;
+        for (size_t i = 0; i < sorted.size();) {
+            size_t end = i + 1;
+            while (end < sorted.size() && sorted[end].first == sorted[i].first) ++end;
+            size_t live = 0;
+            for (size_t j = i; end - i > 1 && j < end; ++j) {
+                if (!record_mgr.get_record(schema.segment_id, sorted[j].second, latest, row)) continue;
+                if (++live > 1) {
+                    throw std::invalid_argument("Column '" + column_name + "' of table '" + table_name +
+                                                "' has duplicate values; cannot create unique index '" + index_name + "'");
+                }
+            }
+            i = end;
+        }
+    }
+
+    IndexInfo info;
+    info.table_name = schema.table_name;
+    info.column_name = column_name;
+    info.index_name = index_name;
+    info.unique = unique;
+    info.type = type;
+    if (!catalog.create_index(info, entries)) {
+        throw std::runtime_error("Could not create index '" + index_name + "'");
+    }
+    DEBUG_TABLE_MANAGER("Created index " << index_name << " on " << table_name << "." << column_name << " with "
+                                         << entries.size() << " entries");
+    return entries.size();
+}
+
+// Only the trees recovery found stale are rebuilt: the table is read once
+// for all of them, then every index is bulk-loaded on a thread of its own.
+void TableManager::rebuild_indexes() {
+    map<string, vector<string>> stale;
+    for (const auto& [table_name, column_name] : index_mgr.stale_indexes()) {
+        stale[table_name].push_back(column_name);
+    }
+
+    for (const auto& [table_name, column_names] : stale) {
+        TableSchema schema = catalog.get_schema(table_name);
+        if (schema.table_name.empty()) continue;
+
+        vector<int> columns;
+        for (const auto& column_name : column_names) {
+            catalog.recreate_index(table_name, column_name);
+            int column = schema.column_index(column_name);
+            if (column >= 0) columns.push_back(column);
+        }
+
+        vector<vector<pair<string, int64_t>>> entries = read_index_keys(schema, columns);
+        vector<exception_ptr> failures(columns.size());
+        vector<thread> workers;
+        for (size_t k = 0; k < columns.size(); ++k) {
+            workers.emplace_back([&, k] {
+                try {
+                    index_mgr.insert_entries(table_name, schema.columns[columns[k]].name, entries[k]);
+                } catch (...) {
+                    failures[k] = current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        for (const auto& failure : failures) {
+            if (failure) rethrow_exception(failure);
+        }
+        DEBUG_TABLE_MANAGER("Rebuilt " << columns.size() << " indexes of table " << table_name);
+    }
+    if (!stale.empty()) record_mgr.commit();
+}
+
+void TableManager::printTable(const std::string& tableName, const Expr* where) {
+    std::unique_ptr<Operator> plan = scan(tableName, where);
+    if (!plan) {
         std::cerr << "[ERROR] Table '" << tableName << "' does not exist." << std::endl;
         return;
     }
+    print(*plan);
+}
 
-    std::vector<Record> records = scan(tableName);
-    pretty::Table table;
+// Rows are printed in blocks of PRINT_BLOCK_ROWS as they are scanned, so
+// printing a table needs memory for one block, not the whole table.
+void TableManager::print(Operator& plan) {
+    std::vector<std::string> header;
+    for (const auto& column : plan.output_columns()) {
+        header.push_back(column.name);
+    }
 
-    // Add header row
-    table.add_row(schema.columns);
+    pretty::Printer printer;
+    printer.frame(pretty::FrameStyle::Basic);
 
-    // Add data rows
-    for (const auto& rec : records) {
-        std::string recStr(rec.data.begin(), rec.data.end());
+    pretty::Table table;
+    table.add_row(header);
+    size_t block_rows = 0;
+    size_t total_rows = 0;
+
+    Tuple tuple;
+    plan.open();
+    while (plan.next(tuple)) {
         std::vector<std::string> values;
-        std::stringstream ss(recStr);
-        std::string field;
-        
-        while (std::getline(ss, field, '|')) {
-            values.push_back(field);
-        }
-        
-        // Pad with empty strings if needed
-        if (values.size() < schema.columns.size()) {
-            values.resize(schema.columns.size(), "");
+        for (const auto& value : tuple.values) {
+            values.push_back(value.to_string());
         }
         table.add_row(values);
+        total_rows++;
+        if (++block_rows == PRINT_BLOCK_ROWS) {
+            std::cout << printer(table) << std::flush;
+            table = pretty::Table();
+            table.add_row(header);
+            block_rows = 0;
+        }
     }
+    plan.close();
 
     // Handle empty table
-    if (records.empty()) {
-        std::vector<std::string> emptyRow(schema.columns.size(), "");
+    if (total_rows == 0) {
+        std::vector<std::string> emptyRow(header.size(), "");
         emptyRow[0] = "No records found";
         table.add_row(emptyRow);
     }
-
-    // Print table with enhanced formatting
-    pretty::Printer printer;
-    printer.frame(pretty::FrameStyle::Basic);
-    std::cout << printer(table) << std::endl;
+    if (block_rows > 0 || total_rows == 0) {
+        std::cout << printer(table);
+    }
+    std::cout << std::endl;
 }
\ No newline at end of file
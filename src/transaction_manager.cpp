@@ -0,0 +1,50 @@
+#include "../include/transaction_manager.h"
+#include "../include/header_page.h"
+#include "../include/logger.h"
+#include <cstddef>
+
+using namespace std;
+
+// Transactions that were running at a crash are not rolled back (there is
+// no undo), so whatever reached the log counts as committed.
+TransactionManager::TransactionManager(BufferPoolManager& bpm) : buffer_pool(bpm), writer(0) {
+    PageGuard header_guard(buffer_pool, HEADER_PAGE_ID, LatchMode::SHARED);
+    const DatabaseHeader* header = reinterpret_cast<const DatabaseHeader*>(header_guard.data());
+    last_committed = header->next_transaction_id - 1;
+    LOG_DEBUG(TXN, "Last committed transaction is " << last_committed);
+}
+
+TxnId TransactionManager::write_transaction() {
+    lock_guard<mutex> lock(latch);
+    if (writer == 0) {
+        PageGuard header_guard(buffer_pool, HEADER_PAGE_ID);
+        DatabaseHeader* header = reinterpret_cast<DatabaseHeader*>(header_guard.data());
+        writer = header->next_transaction_id++;
+        header_guard.log_write(offsetof(DatabaseHeader, next_transaction_id), sizeof(uint64_t));
+        LOG_TRACE(TXN, "Started transaction " << writer);
+    }
+    return writer;
+}
+
+void TransactionManager::commit() {
+    lock_guard<mutex> lock(latch);
+    if (writer == 0) return;
+    last_committed = writer;
+    writer = 0;
+    LOG_TRACE(TXN, "Committed transaction " << last_committed);
+}
+
+shared_ptr<const Snapshot> TransactionManager::open_snapshot() {
+    lock_guard<mutex> lock(latch);
+    auto registered = open_horizons.insert(last_committed);
+    return shared_ptr<const Snapshot>(new Snapshot{last_committed}, [this, registered](const Snapshot* snapshot) {
+        lock_guard<mutex> lock(latch);
+        open_horizons.erase(registered);
+        delete snapshot;
+    });
+}
+
+TxnId TransactionManager::gc_horizon() {
+    lock_guard<mutex> lock(latch);
+    return open_horizons.empty() ? last_committed : *open_horizons.begin();
+}
@@ -0,0 +1,262 @@
+#include "../include/types.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+string to_upper(string s) {
+    transform(s.begin(), s.end(), s.begin(), ::toupper);
+    return s;
+}
+
+string trimmed(const string& s) {
+    size_t start = s.find_first_not_of(" \t\n\r");
+    if (start == string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\n\r");
+    return s.substr(start, end - start + 1);
+}
+
+// Parses "TYPE" or "VARCHAR(n)".
+void parse_type(const string& text, Column& column) {
+    string type = to_upper(trimmed(text));
+    if (type == "INT" || type == "INTEGER") {
+        column.type = TypeId::INT;
+    } else if (type == "BIGINT") {
+        column.type = TypeId::BIGINT;
+    } else if (type == "DOUBLE" || type == "FLOAT" || type == "REAL") {
+        column.type = TypeId::DOUBLE;
+    } else if (type == "BOOL" || type == "BOOLEAN") {
+        column.type = TypeId::BOOL;
+    } else if (type.rfind("VARCHAR", 0) == 0) {
+        column.type = TypeId::VARCHAR;
+        column.length = DEFAULT_VARCHAR_LENGTH;
+        size_t open = type.find('(');
+        if (open != string::npos) {
+            size_t close = type.find(')', open);
+            if (close == string::npos) throw invalid_argument("Malformed type '" + text + "'");
+            string digits = trimmed(type.substr(open + 1, close - open - 1));
+            unsigned long length = 0;
+            try {
+                length = stoul(digits);
+            } catch (const exception&) {
+                throw invalid_argument("Malformed type '" + text + "'");
+            }
+            if (length == 0 || length > UINT16_MAX) throw invalid_argument("VARCHAR length out of range in '" + text + "'");
+            column.length = static_cast<uint16_t>(length);
+        } else if (type != "VARCHAR") {
+            throw invalid_argument("Unknown type '" + text + "'");
+        }
+    } else {
+        throw invalid_argument("Unknown type '" + text + "'");
+    }
+}
+
+// Big-endian, so byte order equals numeric order.
+void append_big_endian(string& out, uint64_t bits) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+    }
+}
+
+} // namespace
+
+// ---------- Column ----------
+
+size_t Column::fixed_width() const {
+    switch (type) {
+    case TypeId::INT: return 4;
+    case TypeId::BIGINT: return 8;
+    case TypeId::DOUBLE: return 8;
+    case TypeId::BOOL: return 1;
+    default: return 0;
+    }
+}
+
+string Column::type_name() const {
+    switch (type) {
+    case TypeId::INT: return "INT";
+    case TypeId::BIGINT: return "BIGINT";
+    case TypeId::DOUBLE: return "DOUBLE";
+    case TypeId::BOOL: return "BOOL";
+    case TypeId::VARCHAR: return "VARCHAR(" + std::to_string(length) + ")";
+    }
+    return "UNKNOWN";
+}
+
+Column Column::parse_definition(const string& definition) {
+    string text = trimmed(definition);
+    Column column;
+    size_t space = text.find_first_of(" \t");
+    if (space == string::npos) {
+        column.name = text;
+        return column;
+    }
+    column.name = text.substr(0, space);
+    parse_type(text.substr(space + 1), column);
+    return column;
+}
+
+string Column::serialize() const {
+    return name + ":" + type_name();
+}
+
+Column Column::deserialize(const string& text) {
+    Column column;
+    size_t colon = text.rfind(':');
+    if (colon == string::npos) {
+        column.name = text;
+        return column;
+    }
+    column.name = text.substr(0, colon);
+    parse_type(text.substr(colon + 1), column);
+    return column;
+}
+
+// ---------- Value ----------
+
+Value Value::make_null(TypeId type) {
+    Value v;
+    v.type = type;
+    v.is_null = true;
+    return v;
+}
+
+Value Value::make_int(int64_t i, TypeId type) {
+    Value v;
+    v.type = type;
+    v.is_null = false;
+    v.int_value = i;
+    return v;
+}
+
+Value Value::make_double(double d) {
+    Value v;
+    v.type = TypeId::DOUBLE;
+    v.is_null = false;
+    v.double_value = d;
+    return v;
+}
+
+Value Value::make_bool(bool b) {
+    return make_int(b ? 1 : 0, TypeId::BOOL);
+}
+
+Value Value::make_string(const string& s) {
+    Value v;
+    v.type = TypeId::VARCHAR;
+    v.is_null = false;
+    v.string_value = s;
+    return v;
+}
+
+Value Value::parse(const Column& column, const string& literal) {
+    string text = trimmed(literal);
+    if (to_upper(text) == "NULL") return make_null(column.type);
+
+    bool quoted = text.size() >= 2 && text.front() == '\'' && text.back() == '\'';
+    if (quoted) text = text.substr(1, text.size() - 2);
+
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    switch (column.type) {
+    case TypeId::INT:
+    case TypeId::BIGINT: {
+        int64_t i = 0;
+        auto [ptr, ec] = from_chars(begin, end, i);
+        if (ec != errc() || ptr != end || text.empty()) {
+            throw invalid_argument("'" + literal + "' is not a valid " + column.type_name() + " for column " + column.name);
+        }
+        if (column.type == TypeId::INT && (i < INT32_MIN || i > INT32_MAX)) {
+            throw invalid_argument("'" + literal + "' is out of range for INT column " + column.name);
+        }
+        return make_int(i, column.type);
+    }
+    case TypeId::DOUBLE: {
+        try {
+            size_t used = 0;
+            double d = stod(text, &used);
+            if (used == text.size()) return make_double(d);
+        } catch (const exception&) {
+        }
+        throw invalid_argument("'" + literal + "' is not a valid DOUBLE for column " + column.name);
+    }
+    case TypeId::BOOL: {
+        string upper = to_upper(text);
+        if (upper == "TRUE" || upper == "1") return make_bool(true);
+        if (upper == "FALSE" || upper == "0") return make_bool(false);
+        throw invalid_argument("'" + literal + "' is not a valid BOOL for column " + column.name);
+    }
+    case TypeId::VARCHAR:
+        if (text.size() > column.length) {
+            throw invalid_argument("Value for column " + column.name + " is longer than " + column.type_name());
+        }
+        return make_string(text);
+    }
+    throw invalid_argument("Unknown type for column " + column.name);
+}
+
+string Value::to_string() const {
+    if (is_null) return "NULL";
+    switch (type) {
+    case TypeId::INT:
+    case TypeId::BIGINT:
+        return std::to_string(int_value);
+    case TypeId::DOUBLE: {
+        char buf[32];
+        auto [ptr, ec] = to_chars(buf, buf + sizeof(buf), double_value);
+        return string(buf, ptr);
+    }
+    case TypeId::BOOL:
+        return int_value ? "true" : "false";
+    case TypeId::VARCHAR:
+        return string_value;
+    }
+    return "";
+}
+
+int Value::compare(const Value& other) const {
+    bool numeric = type != TypeId::VARCHAR && other.type != TypeId::VARCHAR;
+    if (numeric) {
+        if (type == TypeId::DOUBLE || other.type == TypeId::DOUBLE) {
+            double a = type == TypeId::DOUBLE ? double_value : static_cast<double>(int_value);
+            double b = other.type == TypeId::DOUBLE ? other.double_value : static_cast<double>(other.int_value);
+            return a < b ? -1 : (a > b ? 1 : 0);
+        }
+        return int_value < other.int_value ? -1 : (int_value > other.int_value ? 1 : 0);
+    }
+    int c = (type == TypeId::VARCHAR && other.type == TypeId::VARCHAR)
+        ? string_value.compare(other.string_value)
+        : to_string().compare(other.to_string());
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+string Value::index_key() const {
+    string key;
+    switch (type) {
+    case TypeId::INT:
+    case TypeId::BIGINT:
+        // Flipping the sign bit orders negative numbers before positive ones.
+        append_big_endian(key, static_cast<uint64_t>(int_value) ^ (1ULL << 63));
+        break;
+    case TypeId::DOUBLE: {
+        uint64_t bits;
+        memcpy(&bits, &double_value, sizeof(bits));
+        bits = (bits & (1ULL << 63)) ? ~bits : bits ^ (1ULL << 63);
+        append_big_endian(key, bits);
+        break;
+    }
+    case TypeId::BOOL:
+        key.push_back(int_value ? 1 : 0);
+        break;
+    case TypeId::VARCHAR:
+        key = string_value;
+        break;
+    }
+    return key;
+}